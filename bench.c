@@ -0,0 +1,1070 @@
+#include "src/internal.h"
+#include "src/raon.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#define KB ((size_t)1024)
+#define MB (1024 * KB)
+#define GB (1024 * MB)
+
+static double now_seconds(void) {
+   struct timespec ts;
+   timespec_get(&ts, TIME_UTC);
+   return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// parses sizes such as `4096`, `64K`, `256M` or `1G`
+static size_t parse_size(const char *str) {
+   char *end = NULL;
+   size_t size = strtoull(str, &end, 10);
+   switch (*end) {
+   case 'k':
+   case 'K':
+      return size * KB;
+   case 'm':
+   case 'M':
+      return size * MB;
+   case 'g':
+   case 'G':
+      return size * GB;
+   default:
+      return size;
+   }
+}
+
+/*
+   Generates a document of at most `size` bytes made out of many top-level blocks.
+   The buffer is deliberately not NUL terminated so that any read past `*len` is a bug.
+*/
+static char *generate_document(size_t size, size_t *len) {
+   char *buf = malloc(size);
+   if (!buf) {
+      return NULL;
+   }
+
+   char entry[256];
+   size_t used = 0;
+   for (size_t i = 0;; i++) {
+      int entry_len = snprintf(entry, sizeof(entry),
+          "entry_%zu = {\n"
+          "   name = \"a reasonably long string value #%zu\"\n"
+          "   id = %zu\n"
+          "   ratio = 0.25\n"
+          "   tags = [\"a\", \"b\", \"c\"]\n"
+          "   enabled = true # trailing comment\n"
+          "}\n",
+          i, i, i);
+      if (used + (size_t)entry_len > size) {
+         break;
+      }
+      memcpy(&buf[used], entry, entry_len);
+      used += entry_len;
+   }
+
+   *len = used;
+   return buf;
+}
+
+// parse time should grow linearly with the input, so ns/byte should stay flat across sizes
+static void bench_parse_scaling(size_t max_size) {
+   printf("=== raon_parse scaling ===\n");
+   printf("%12s %10s %12s %10s\n", "bytes", "runs", "MB/s", "ns/byte");
+
+   for (size_t size = KB; size <= max_size; size *= 4) {
+      size_t len = 0;
+      char *doc = generate_document(size, &len);
+      if (!doc) {
+         perror("Failed to generate document");
+         return;
+      }
+
+      // small inputs are parsed repeatedly so that every size gets a comparable amount of work
+      size_t runs = size < 64 * MB ? (64 * MB) / size : 1;
+      double start = now_seconds();
+      for (size_t i = 0; i < runs; i++) {
+         struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, len);
+         if (!entries) {
+            fprintf(stderr, "Failed to parse generated document\n");
+            free(doc);
+            return;
+         }
+         raon_free_entries(entries);
+      }
+      double elapsed = (now_seconds() - start) / runs;
+
+      printf("%12zu %10zu %12.1f %10.2f\n", len, runs, len / elapsed / MB, elapsed * 1e9 / len);
+      free(doc);
+   }
+}
+
+// parse + teardown through malloc'd vectors against an arena backed document
+static void bench_document_teardown(size_t size) {
+   printf("\n=== parse + free (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, len);
+   double parsed = now_seconds();
+   raon_free_entries(entries);
+   double freed = now_seconds();
+   printf("%-10s parse %8.3fs   free %8.3fs\n", "malloc", parsed - start, freed - parsed);
+
+   start = now_seconds();
+   struct raon_document *document = raon_parse_document(doc, len);
+   parsed = now_seconds();
+   raon_document_free(document);
+   freed = now_seconds();
+   printf("%-10s parse %8.3fs   free %8.3fs\n", "arena", parsed - start, freed - parsed);
+
+   free(doc);
+}
+
+// the speedup should follow the thread count up to the number of cores
+static void bench_parallel(size_t size) {
+   printf("\n=== raon_parse_document_parallel (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double single = 0;
+   for (size_t threads = 1; threads <= 16; threads *= 2) {
+      const double start = now_seconds();
+      struct raon_document *document = raon_parse_document_parallel(doc, len, threads);
+      const double elapsed = now_seconds() - start;
+      if (!document) {
+         fprintf(stderr, "Failed to parse generated document\n");
+         break;
+      }
+      raon_document_free(document);
+      if (threads == 1) {
+         single = elapsed;
+      }
+      printf("%2zu threads %8.3fs %10.1f MB/s %6.2fx\n", threads, elapsed, len / elapsed / MB,
+          single / elapsed);
+   }
+   free(doc);
+}
+
+// time until one nested value can be read, which a lazy document gets to without parsing the rest
+static void bench_lazy(size_t size) {
+   printf("\n=== time to first lookup (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   struct raon_document *eager = raon_parse_document(doc, len);
+   struct raon_value *entry = eager ? raon_block_get(eager->entries, "entry_1000", 10) : NULL;
+   bool found = entry && raon_block_get(entry->block_val, "id", 2);
+   const double eager_time = now_seconds() - start;
+   raon_document_free(eager);
+
+   start = now_seconds();
+   struct raon_document *lazy = raon_parse_document_lazy(doc, len);
+   entry = lazy ? raon_block_get(lazy->entries, "entry_1000", 10) : NULL;
+   found = found && entry && raon_block_get(raon_value_block(lazy, entry), "id", 2);
+   const double lazy_time = now_seconds() - start;
+   raon_document_free(lazy);
+
+   if (!found) {
+      fprintf(stderr, "Failed to look up generated document\n");
+   }
+   printf("%-12s %8.3fs\n", "eager", eager_time);
+   printf("%-12s %8.3fs %6.2fx\n", "lazy", lazy_time, eager_time / lazy_time);
+   free(doc);
+}
+
+// counts the bytes a tree holds on to, growing a buffer only counts what it grew by
+struct counting_allocator {
+   size_t bytes;
+};
+
+static void *counting_alloc(void *ctx, size_t size) {
+   ((struct counting_allocator *)ctx)->bytes += size;
+   return malloc(size);
+}
+
+static void *counting_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+   struct counting_allocator *self = ctx;
+   self->bytes += new_size - old_size;
+   return realloc(ptr, new_size);
+}
+
+static void counting_free(void *ctx, void *ptr) {
+   (void)ctx;
+   free(ptr);
+}
+
+// big numeric arrays, which are packed instead of holding a `raon_value` per item
+static void bench_packed_arrays(size_t size) {
+   printf("\n=== packed int arrays (%zu bytes) ===\n", size);
+
+   char *doc = malloc(size);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+   size_t len = 0, items = 0;
+   for (size_t row = 0; len + 8 * KB < size; row++) {
+      len += sprintf(&doc[len], "row_%zu = [", row);
+      for (size_t i = 0; i < 1000; i++) {
+         len += sprintf(&doc[len], "%zu, ", (row * 7919 + i) % 100000);
+      }
+      doc[len++] = ']';
+      doc[len++] = '\n';
+      items += 1000;
+   }
+
+   struct counting_allocator counter = { 0 };
+   const struct vec_allocator allocator = { .alloc = counting_alloc,
+      .free = counting_free,
+      .realloc = counting_realloc,
+      .ctx = &counter };
+   struct vector_of_raon_entry *entries = raon_parse(allocator, doc, len);
+   if (!entries) {
+      fprintf(stderr, "Failed to parse generated document\n");
+      free(doc);
+      return;
+   }
+   printf("%-12s %8.1f bytes/item (%zu bytes/item unpacked)\n", "tree",
+       (double)counter.bytes / items, sizeof(struct raon_value));
+
+   intptr_t sum = 0;
+   double start = now_seconds();
+   for (size_t row = 0; row < entries->len; row++) {
+      const struct vector_of_raon_value *array = entries->vec[row].value.array_val;
+      for (size_t i = 0; i < raon_array_len(array); i++) {
+         sum += raon_array_get(array, i).int_val;
+      }
+   }
+   const double get_time = now_seconds() - start;
+
+   start = now_seconds();
+   for (size_t row = 0; row < entries->len; row++) {
+      const intptr_t *ints;
+      size_t count;
+      if (raon_array_as_ints(entries->vec[row].value.array_val, &ints, &count)) {
+         for (size_t i = 0; i < count; i++) {
+            sum -= ints[i];
+         }
+      }
+   }
+   const double view_time = now_seconds() - start;
+
+   if (sum != 0) {
+      fprintf(stderr, "Packed views don't match the items\n");
+   }
+   printf("%-12s %8.3f ns/item\n", "array_get", get_time * 1e9 / items);
+   printf("%-12s %8.3f ns/item %6.2fx\n", "as_ints", view_time * 1e9 / items,
+       get_time / view_time);
+   raon_free_entries(entries);
+   free(doc);
+}
+
+// many small documents with the odd huge one, which is what keeps a static split of the inputs
+// from using every core
+static void bench_batch(size_t count) {
+   printf("\n=== raon_parse_batch (%zu documents) ===\n", count);
+
+   struct raon_batch_input *inputs = calloc(count, sizeof(*inputs));
+   struct raon_document **results = calloc(count, sizeof(*results));
+   size_t total = 0;
+   for (size_t i = 0; inputs && results && i < count; i++) {
+      inputs[i].str = generate_document(i % 1000 == 0 ? MB : 2 * KB, &inputs[i].len);
+      total += inputs[i].len;
+   }
+
+   // the documents are kept until the end either way, as they would be when loading them at startup
+   double start = now_seconds();
+   for (size_t i = 0; inputs && results && i < count; i++) {
+      results[i] = raon_parse_document(inputs[i].str, inputs[i].len);
+   }
+   const double sequential = now_seconds() - start;
+   for (size_t i = 0; inputs && results && i < count; i++) {
+      raon_document_free(results[i]);
+   }
+   printf("%-12s %8.3fs %10.1f MB/s\n", "sequential", sequential, total / sequential / MB);
+
+   start = now_seconds();
+   if (inputs && results) {
+      raon_parse_batch(inputs, count, results, (struct raon_batch_options) { 0 });
+   }
+   const double batch = now_seconds() - start;
+   printf("%-12s %8.3fs %10.1f MB/s %6.2fx\n", "batch", batch, total / batch / MB,
+       sequential / batch);
+
+   for (size_t i = 0; inputs && results && i < count; i++) {
+      raon_document_free(results[i]);
+      free(inputs[i].str);
+   }
+   free(results);
+   free(inputs);
+}
+
+static bool count_value(void *ctx, struct raon_value value) {
+   (void)value;
+   ++*(size_t *)ctx;
+   return true;
+}
+
+// a single pass over the document that only counts values, with and without building the AST
+static void bench_events(size_t size) {
+   printf("\n=== event parsing (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   raon_document_free(raon_parse_document(doc, len));
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "ast", len / elapsed / MB);
+
+   size_t values = 0;
+   const struct raon_handler handler = { .ctx = &values, .on_value = count_value };
+   start = now_seconds();
+   if (raon_parse_events(doc, len, &handler) != raon_parse_status_ok) {
+      fprintf(stderr, "Failed to parse generated document\n");
+   }
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s (%zu values)\n", "events", len / elapsed / MB, values);
+
+   free(doc);
+}
+
+// checking a document is valid with a full parse that gets freed right away, and without one
+static void bench_validate(size_t size) {
+   printf("\n=== validation (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, len);
+   if (entries) {
+      raon_free_entries(entries);
+   }
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "parse+free", len / elapsed / MB);
+
+   start = now_seconds();
+   struct raon_error error;
+   if (!raon_validate(doc, len, &error)) {
+      fprintf(stderr, "Generated document is invalid at byte %zu\n", error.offset);
+   }
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "validate", len / elapsed / MB);
+
+   free(doc);
+}
+
+// the same document parsed in one go and streamed through the incremental parser in 64K chunks
+static void bench_incremental(size_t size) {
+   printf("\n=== incremental parsing (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   raon_document_free(raon_parse_document(doc, len));
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "whole", len / elapsed / MB);
+
+   const size_t chunk_len = 64 * KB;
+   start = now_seconds();
+   struct raon_parser parser = raon_parser_init();
+   for (size_t i = 0; i < len; i += chunk_len) {
+      raon_parser_feed(&parser, &doc[i], len - i < chunk_len ? len - i : chunk_len);
+   }
+   struct raon_document *document = raon_parser_finish(&parser);
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "chunked", len / elapsed / MB);
+   if (!document) {
+      fprintf(stderr, "Failed to parse generated document\n");
+   }
+
+   raon_document_free(document);
+   free(doc);
+}
+
+// reading a file into a buffer before parsing it against mapping it and parsing in place
+static void bench_parse_file(size_t size) {
+   printf("\n=== file parsing (%zu bytes) ===\n", size);
+
+   const char *path = "./raon_bench.tmp";
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   FILE *file = doc ? fopen(path, "wb") : NULL;
+   if (!file) {
+      perror("Failed to write document");
+      free(doc);
+      return;
+   }
+   fwrite(doc, 1, len, file);
+   fclose(file);
+   free(doc);
+
+   double start = now_seconds();
+   file = fopen(path, "rb");
+   char *buf = malloc(len);
+   if (file && buf && fread(buf, 1, len, file) == len) {
+      raon_document_free(raon_parse_document(buf, len));
+   }
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "fread", len / elapsed / MB);
+   free(buf);
+   if (file) {
+      fclose(file);
+   }
+
+   start = now_seconds();
+   raon_document_free(raon_parse_file(path));
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s\n", "mmap", len / elapsed / MB);
+
+   remove(path);
+}
+
+// serializing a parsed document into memory, in both output modes
+static void bench_writer(size_t size) {
+   printf("\n=== writer (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   struct raon_document *document = doc ? raon_parse_document(doc, len) : NULL;
+   if (!document) {
+      fprintf(stderr, "Failed to parse generated document\n");
+      free(doc);
+      return;
+   }
+
+   const struct raon_write_options modes[] = { { .compact = false }, { .compact = true } };
+   for (size_t i = 0; i < 2; i++) {
+      struct raon_buffer buffer = { 0 };
+      double start = now_seconds();
+      raon_write(document->entries, raon_sink_buffer(&buffer), modes[i]);
+      double elapsed = now_seconds() - start;
+      printf("%-12s %10.1f MB/s (%zu bytes)\n", modes[i].compact ? "compact" : "pretty",
+          buffer.len / elapsed / MB, buffer.len);
+      free(buffer.data);
+   }
+
+   raon_document_free(document);
+   free(doc);
+}
+
+// the same document decoded from its binary encoding against parsing its text
+static void bench_binary(size_t size) {
+   printf("\n=== binary decoding (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   struct raon_document *document = doc ? raon_parse_document(doc, len) : NULL;
+   struct raon_buffer binary = { 0 };
+   if (!document || !raon_encode_binary(document->entries, raon_sink_buffer(&binary))) {
+      fprintf(stderr, "Failed to encode generated document\n");
+      raon_document_free(document);
+      free(doc);
+      return;
+   }
+   raon_document_free(document);
+
+   double start = now_seconds();
+   raon_document_free(raon_parse_document(doc, len));
+   const double text_elapsed = now_seconds() - start;
+   printf("%-12s %10.1f ms (%zu bytes)\n", "text", text_elapsed * 1e3, len);
+
+   start = now_seconds();
+   raon_document_free(raon_decode_binary(binary.data, binary.len));
+   const double binary_elapsed = now_seconds() - start;
+   printf("%-12s %10.1f ms (%zu bytes, %.1fx faster)\n", "binary", binary_elapsed * 1e3,
+       binary.len, text_elapsed / binary_elapsed);
+
+   free(binary.data);
+   free(doc);
+}
+
+// startup cost of a frozen snapshot against parsing the same document's text, then lookups in both
+static void bench_frozen(size_t size) {
+   printf("\n=== frozen snapshots (%zu bytes) ===\n", size);
+
+   const char *text_path = "./raon_bench.tmp";
+   const char *frozen_path = "./raon_bench_frozen.tmp";
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   struct raon_document *document = doc ? raon_parse_document(doc, len) : NULL;
+   FILE *text = document ? fopen(text_path, "wb") : NULL;
+   FILE *frozen = text ? fopen(frozen_path, "wb") : NULL;
+   if (!frozen || fwrite(doc, 1, len, text) != len
+       || !raon_freeze(document->entries, raon_sink_file(frozen))) {
+      perror("Failed to write documents");
+   }
+   if (text) {
+      fclose(text);
+   }
+   if (frozen) {
+      fclose(frozen);
+   }
+   raon_document_free(document);
+   free(doc);
+
+   double start = now_seconds();
+   document = raon_parse_file(text_path);
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.3f ms to open\n", "text", elapsed * 1e3);
+
+   struct raon_frozen snapshot;
+   start = now_seconds();
+   const bool opened = raon_frozen_open(&snapshot, frozen_path);
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.3f ms to open\n", "frozen", elapsed * 1e3);
+
+   if (document && opened) {
+      const size_t entries = document->entries->len;
+      const size_t lookups = 1000000;
+      char key[32];
+      size_t found = 0;
+      start = now_seconds();
+      for (size_t i = 0; i < lookups; i++) {
+         const int key_len = snprintf(key, sizeof(key), "entry_%zu", (i * 7919) % entries);
+         found += raon_block_get(document->entries, key, key_len) != NULL;
+      }
+      elapsed = now_seconds() - start;
+      printf("%-12s %10.1f ns/lookup (%zu found)\n", "text", elapsed * 1e9 / lookups, found);
+
+      const struct raon_frozen_value root = raon_frozen_root(&snapshot);
+      found = 0;
+      start = now_seconds();
+      for (size_t i = 0; i < lookups; i++) {
+         const int key_len = snprintf(key, sizeof(key), "entry_%zu", (i * 7919) % entries);
+         found += raon_frozen_get(root, key, key_len).cell != NULL;
+      }
+      elapsed = now_seconds() - start;
+      printf("%-12s %10.1f ns/lookup (%zu found)\n", "frozen", elapsed * 1e9 / lookups, found);
+   }
+
+   if (opened) {
+      raon_frozen_close(&snapshot);
+   }
+   raon_document_free(document);
+   remove(text_path);
+   remove(frozen_path);
+}
+
+static intptr_t sum_ints(struct raon_value value) {
+   intptr_t sum = value.type == raon_value_type_int ? value.int_val : 0;
+   if (value.type == raon_value_type_block) {
+      for (size_t i = 0; i < value.block_val->len; i++) {
+         sum += sum_ints(value.block_val->vec[i].value);
+      }
+   } else if (value.type == raon_value_type_array) {
+      for (size_t i = 0; i < raon_array_len(value.array_val); i++) {
+         sum += sum_ints(raon_array_get(value.array_val, i));
+      }
+   }
+   return sum;
+}
+
+static intptr_t sum_compact_ints(struct raon_compact_value value) {
+   switch (raon_compact_type(value)) {
+   case raon_value_type_int:
+      return raon_compact_int(value);
+   case raon_value_type_block:
+   case raon_value_type_array: {
+      intptr_t sum = 0;
+      const size_t len = raon_compact_len(value);
+      for (size_t i = 0; i < len; i++) {
+         sum += sum_compact_ints(raon_compact_at(value, i));
+      }
+      return sum;
+   }
+   default:
+      return 0;
+   }
+}
+
+// memory held by the tree and time to walk all of it
+/*
+   Resident memory of the process as reported by procfs, which only Linux has, so 0 is returned on
+   other systems. `VmHWM:` is the peak since the last `peak_memory_reset`.
+*/
+static size_t process_memory(const char *field) {
+   FILE *file = fopen("/proc/self/status", "r");
+   if (!file) {
+      return 0;
+   }
+   char line[256];
+   size_t kb = 0;
+   while (fgets(line, sizeof(line), file)) {
+      if (strncmp(line, field, strlen(field)) == 0) {
+         kb = strtoull(&line[strlen(field)], NULL, 10);
+         break;
+      }
+   }
+   fclose(file);
+   return kb * KB;
+}
+
+static bool peak_memory_reset(void) {
+   FILE *file = fopen("/proc/self/clear_refs", "w");
+   if (!file) {
+      return false;
+   }
+   const bool written = fputs("5", file) >= 0;
+   return fclose(file) == 0 && written;
+}
+
+static void bench_compact(size_t size) {
+   printf("\n=== compact documents (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_document(size, &len);
+   struct counting_allocator counter = { 0 };
+   const struct vec_allocator allocator = { .alloc = counting_alloc,
+      .free = counting_free,
+      .realloc = counting_realloc,
+      .ctx = &counter };
+   struct vector_of_raon_entry *entries = doc ? raon_parse(allocator, doc, len) : NULL;
+   // the compact document is built from a whole tree, which is alive until building is done
+   const size_t baseline = peak_memory_reset() ? process_memory("VmRSS:") : 0;
+   struct raon_compact *compact = doc ? raon_compact_parse(doc, len) : NULL;
+   const size_t peak = baseline ? process_memory("VmHWM:") - baseline : 0;
+   if (!entries || !compact) {
+      fprintf(stderr, "Failed to parse generated document\n");
+      free(doc);
+      return;
+   }
+   const size_t nodes = raon_compact_len(raon_compact_root(compact));
+
+   double start = now_seconds();
+   const struct raon_value root = { .type = raon_value_type_block, .block_val = entries };
+   const intptr_t sum = sum_ints(root);
+   const double tree_time = now_seconds() - start;
+
+   start = now_seconds();
+   const intptr_t compact_sum = sum_compact_ints(raon_compact_root(compact));
+   const double compact_time = now_seconds() - start;
+
+   if (sum != compact_sum) {
+      fprintf(stderr, "Compact document doesn't match the tree\n");
+   }
+   printf("%-12s %8.1f MB %8.1f bytes/entry %8.3f ms to walk\n", "tree", (double)counter.bytes / MB,
+       (double)counter.bytes / nodes, tree_time * 1e3);
+   printf("%-12s %8.1f MB %8.1f bytes/entry %8.3f ms to walk %6.2fx less memory\n", "compact",
+       (double)raon_compact_size(compact) / MB, (double)raon_compact_size(compact) / nodes,
+       compact_time * 1e3, (double)counter.bytes / raon_compact_size(compact));
+   if (peak) {
+      printf("%-12s %8.1f MB at peak while parsing, %.2fx the resident size\n", "compact",
+          (double)peak / MB, (double)peak / raon_compact_size(compact));
+   }
+
+   raon_compact_free(compact);
+   raon_free_entries(entries);
+   free(doc);
+}
+
+// one array of records, which is how services usually hold lists of things in their config
+static char *generate_record_array(size_t size, size_t *len) {
+   char *buf = malloc(size);
+   if (!buf) {
+      return NULL;
+   }
+
+   size_t used = (size_t)snprintf(buf, size, "records = [");
+   char record[256];
+   for (size_t i = 0;; i++) {
+      const int record_len = snprintf(record, sizeof(record),
+          "%s{ name = \"record #%zu\", id = %zu, ratio = 0.25, enabled = true, "
+          "tags = [\"a\", \"b\"], owner = { team = \"core\" } }",
+          i ? ", " : "", i, i);
+      if (used + (size_t)record_len + 1 > size) {
+         break;
+      }
+      memcpy(&buf[used], record, record_len);
+      used += record_len;
+   }
+   buf[used++] = ']';
+
+   *len = used;
+   return buf;
+}
+
+struct bench_record {
+   struct raon_str_slice name;
+   intptr_t id;
+   double ratio;
+   bool enabled;
+};
+
+struct bench_records {
+   struct bench_record *items;
+   size_t len;
+};
+
+static const struct raon_field bench_record_fields[] = {
+   { .key = "name", .type = raon_field_type_string, .offset = offsetof(struct bench_record, name) },
+   { .key = "id", .type = raon_field_type_int, .offset = offsetof(struct bench_record, id) },
+   {
+       .key = "ratio",
+       .type = raon_field_type_float,
+       .offset = offsetof(struct bench_record, ratio),
+   },
+   {
+       .key = "enabled",
+       .type = raon_field_type_bool,
+       .offset = offsetof(struct bench_record, enabled),
+   },
+};
+
+static const struct raon_schema bench_record_schema = {
+   .fields = bench_record_fields,
+   .field_count = sizeof(bench_record_fields) / sizeof(bench_record_fields[0]),
+   .size = sizeof(struct bench_record),
+};
+
+static const struct raon_field bench_records_fields[] = {
+   {
+       .key = "records",
+       .type = raon_field_type_dynamic_array,
+       .offset = offsetof(struct bench_records, items),
+       .schema = &bench_record_schema,
+       .item_type = raon_field_type_struct,
+       .len_offset = offsetof(struct bench_records, len),
+   },
+};
+
+static const struct raon_schema bench_records_schema = {
+   .fields = bench_records_fields,
+   .field_count = 1,
+   .size = sizeof(struct bench_records),
+};
+
+// copies records out of the AST by hand, the way code without a schema has to
+static bool bench_copy_records(struct raon_document *doc, struct bench_records *records) {
+   struct raon_value *array = raon_block_get(doc->entries, "records", 7);
+   if (!array || array->type != raon_value_type_array) {
+      return false;
+   }
+   records->len = raon_array_len(array->array_val);
+   records->items = malloc(records->len * sizeof(*records->items));
+   if (!records->items) {
+      return false;
+   }
+   for (size_t i = 0; i < records->len; i++) {
+      struct vector_of_raon_entry *block = raon_array_get(array->array_val, i).block_val;
+      struct bench_record *record = &records->items[i];
+      record->name = raon_block_get(block, "name", 4)->str_val;
+      record->id = raon_block_get(block, "id", 2)->int_val;
+      record->ratio = raon_block_get(block, "ratio", 5)->float_val;
+      record->enabled = raon_block_get(block, "enabled", 7)->bool_val;
+   }
+   return true;
+}
+
+// filling structs from a document through the AST and straight from the text
+static void bench_schema(size_t size) {
+   printf("\n=== schema decoding (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_record_array(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   double start = now_seconds();
+   struct raon_document *parsed = raon_parse_document(doc, len);
+   struct bench_records copied = { 0 };
+   if (!parsed || !bench_copy_records(parsed, &copied)) {
+      fprintf(stderr, "Failed to parse generated document\n");
+   }
+   raon_document_free(parsed);
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s (%zu records)\n", "ast+copy", len / elapsed / MB, copied.len);
+   free(copied.items);
+
+   start = now_seconds();
+   struct bench_records decoded = { 0 };
+   struct raon_decode_error error;
+   if (!raon_decode(doc, len, &bench_records_schema, &decoded, VEC_DEFAULT_ALLOCATOR, &error)) {
+      fprintf(stderr, "Failed to decode generated document at `%s`\n", error.path);
+   }
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s (%zu records)\n", "decode", len / elapsed / MB, decoded.len);
+   raon_schema_free(&bench_records_schema, &decoded, VEC_DEFAULT_ALLOCATOR);
+
+   free(doc);
+}
+
+// a handful of lookups into a block with thousands of keys, linear scan against the hash index
+static void bench_block_lookup(void) {
+   const size_t keys = 4096;
+   const size_t lookups = 1000000;
+   printf("\n=== block lookup (%zu keys, %zu lookups) ===\n", keys, lookups);
+
+   size_t len = 0;
+   char *doc = generate_document(keys * 200, &len);
+   struct raon_document *document = doc ? raon_parse_document(doc, len) : NULL;
+   if (!document) {
+      fprintf(stderr, "Failed to parse generated document\n");
+      free(doc);
+      return;
+   }
+
+   char key[32];
+   size_t found = 0;
+   double start = now_seconds();
+   for (size_t i = 0; i < lookups; i++) {
+      int key_len = snprintf(key, sizeof(key), "entry_%zu", (i * 7919) % keys);
+      struct raon_entry *entries = document->entries->vec;
+      for (size_t j = 0; j < document->entries->len; j++) {
+         if (entries[j].str_key.len == (size_t)key_len
+             && memcmp(entries[j].str_key.ptr, key, key_len) == 0) {
+            ++found;
+            break;
+         }
+      }
+   }
+   double elapsed = now_seconds() - start;
+   printf("%-10s %10.1f ns/lookup (%zu found)\n", "linear", elapsed * 1e9 / lookups, found);
+
+   found = 0;
+   start = now_seconds();
+   for (size_t i = 0; i < lookups; i++) {
+      int key_len = snprintf(key, sizeof(key), "entry_%zu", (i * 7919) % keys);
+      found += raon_block_get(document->entries, key, key_len) != NULL;
+   }
+   elapsed = now_seconds() - start;
+   printf("%-10s %10.1f ns/lookup (%zu found)\n", "indexed", elapsed * 1e9 / lookups, found);
+
+   raon_document_free(document);
+   free(doc);
+}
+
+// multi-kilobyte string values and heavy commenting, where the lexer spends its time skipping bytes
+static char *generate_text_heavy_document(size_t size, size_t *len) {
+   char *buf = malloc(size);
+   if (!buf) {
+      return NULL;
+   }
+
+   size_t used = 0;
+   for (size_t i = 0;; i++) {
+      char header[128];
+      int header_len = snprintf(header, sizeof(header),
+          "# ------------------------------------------------------------------------\n"
+          "description_%zu = \"",
+          i);
+      const size_t body_len = 4096;
+      if (used + header_len + body_len + 2 > size) {
+         break;
+      }
+      memcpy(&buf[used], header, header_len);
+      used += header_len;
+      for (size_t j = 0; j < body_len; j++) {
+         buf[used++] = j % 80 == 79 ? '\n' : "lorem ipsum dolor sit amet "[j % 27];
+      }
+      buf[used++] = '"';
+      buf[used++] = '\n';
+   }
+
+   *len = used;
+   return buf;
+}
+
+static double bench_lex_once(char *doc, size_t len) {
+   double start = now_seconds();
+   struct raon_lexer lexer = raon_lexer_init(doc, len);
+   while (raon_lexer_eat(&lexer).type != raon_token_type_eof) { }
+   return now_seconds() - start;
+}
+
+// raw lexer throughput with the scalar scanner against the SIMD one picked at runtime
+static void bench_lexer(size_t size) {
+   printf("\n=== lexer throughput (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *docs[2];
+   const char *names[2] = { "records", "text-heavy" };
+   docs[0] = generate_document(size, &len);
+   size_t lens[2] = { len, 0 };
+   docs[1] = generate_text_heavy_document(size, &lens[1]);
+   if (!docs[0] || !docs[1]) {
+      perror("Failed to generate document");
+      free(docs[0]);
+      free(docs[1]);
+      return;
+   }
+
+   const enum raon_scan_level levels[] = { raon_scan_level_scalar, raon_scan_level_auto };
+   for (size_t d = 0; d < 2; d++) {
+      for (size_t l = 0; l < 2; l++) {
+         raon_scan_force_level(levels[l]);
+         double elapsed = bench_lex_once(docs[d], lens[d]);
+         printf("%-12s %-8s %10.1f MB/s\n", names[d], l == 0 ? "scalar" : "simd",
+             lens[d] / elapsed / MB);
+      }
+   }
+   raon_scan_force_level(raon_scan_level_auto);
+
+   // positions are only worked out when asked for, here for every token of the document
+   double start = now_seconds();
+   struct raon_lexer lexer = raon_lexer_init(docs[0], lens[0]);
+   struct raon_line_table table = raon_line_table_init(docs[0], lens[0]);
+   size_t tokens = 0, lines = 0;
+   for (struct raon_token token = raon_lexer_eat(&lexer); token.type != raon_token_type_eof;
+       token = raon_lexer_eat(&lexer)) {
+      lines += raon_line_table_position(&table, token.start).line;
+      ++tokens;
+   }
+   raon_line_table_free(&table);
+   const double elapsed = now_seconds() - start;
+   printf("%-12s %-8s %10.1f MB/s (%zu tokens, checksum %zu)\n", names[0], "lines",
+       lens[0] / elapsed / MB, tokens, lines);
+
+   free(docs[0]);
+   free(docs[1]);
+}
+
+// large numeric arrays, where the lexer spends its time converting literals
+static char *generate_numeric_document(size_t size, size_t *len) {
+   char *buf = malloc(size);
+   if (!buf) {
+      return NULL;
+   }
+
+   size_t used = 0;
+   uint64_t state = 42;
+   for (size_t i = 0;; i++) {
+      char line[512];
+      int line_len = snprintf(line, sizeof(line), "samples_%zu = [", i);
+      for (size_t j = 0; j < 16; j++) {
+         state = state * 6364136223846793005u + 1442695040888963407u;
+         const unsigned long long random = state >> 24;
+         line_len += j % 2 == 0
+             ? snprintf(&line[line_len], sizeof(line) - line_len, "%llu, ", random % 1000000)
+             : snprintf(&line[line_len], sizeof(line) - line_len, "%.*g, ", (int)(random % 17) + 1,
+                   (double)random / 1e9);
+      }
+      line_len += snprintf(&line[line_len], sizeof(line) - line_len, "]\n");
+      if (used + line_len > size) {
+         break;
+      }
+      memcpy(&buf[used], line, line_len);
+      used += line_len;
+   }
+
+   *len = used;
+   return buf;
+}
+
+static void bench_numbers(size_t size) {
+   printf("\n=== number lexing (%zu bytes) ===\n", size);
+
+   size_t len = 0;
+   char *doc = generate_numeric_document(size, &len);
+   if (!doc) {
+      perror("Failed to generate document");
+      return;
+   }
+
+   size_t numbers = 0;
+   double start = now_seconds();
+   struct raon_lexer lexer = raon_lexer_init(doc, len);
+   for (struct raon_token token = raon_lexer_eat(&lexer); token.type != raon_token_type_eof;
+        token = raon_lexer_eat(&lexer)) {
+      numbers += token.type == raon_token_type_int || token.type == raon_token_type_float;
+   }
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f MB/s %10.1f ns/number\n", "numeric", len / elapsed / MB,
+       elapsed * 1e9 / numbers);
+
+   free(doc);
+}
+
+// shortest round trip formatting against the `%.17g` printf that the writer used before
+static void bench_float_formatting(void) {
+   const size_t count = 4000000;
+   printf("\n=== float formatting (%zu floats) ===\n", count);
+
+   double *values = malloc(count * sizeof(*values));
+   if (!values) {
+      perror("Failed to allocate floats");
+      return;
+   }
+   uint64_t state = 0x9E3779B97F4A7C15u;
+   for (size_t i = 0; i < count; i++) {
+      state = state * 6364136223846793005u + 1442695040888963407u;
+      values[i] = (double)(state >> 11) / (1u << 20) * (i % 2 ? 1e-3 : 1e3);
+   }
+
+   char buf[RAON_FORMAT_FLOAT_MAX];
+   size_t total = 0;
+   double start = now_seconds();
+   for (size_t i = 0; i < count; i++) {
+      total += raon_format_float(values[i], buf);
+   }
+   double elapsed = now_seconds() - start;
+   printf("%-12s %10.1f ns/float (%zu bytes)\n", "shortest", elapsed * 1e9 / count, total);
+
+   total = 0;
+   start = now_seconds();
+   for (size_t i = 0; i < count; i++) {
+      total += snprintf(buf, sizeof(buf), "%.17g", values[i]);
+   }
+   elapsed = now_seconds() - start;
+   printf("%-12s %10.1f ns/float (%zu bytes)\n", "printf", elapsed * 1e9 / count, total);
+
+   free(values);
+}
+
+int main(int argc, char **argv) {
+   size_t max_size = argc > 1 ? parse_size(argv[1]) : GB;
+   bench_parse_scaling(max_size);
+   bench_document_teardown(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_parallel(max_size < 256 * MB ? max_size : 256 * MB);
+   bench_batch(20000);
+   bench_lazy(max_size < 256 * MB ? max_size : 256 * MB);
+   bench_packed_arrays(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_incremental(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_events(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_validate(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_parse_file(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_writer(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_binary(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_frozen(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_compact(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_schema(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_block_lookup();
+   bench_lexer(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_numbers(max_size < 64 * MB ? max_size : 64 * MB);
+   bench_float_formatting();
+   return 0;
+}
@@ -13,20 +13,36 @@ CMD:
   debug        - compile library with debug symbols
   test         - run tests
   test release - run tests with release mode
+  bench [size] - run benchmarks with release optimizations, inputs grow up to `size` (e.g. 64M)
 
 FLAGS:  
   -sanitize    - add sanitizers to the build
 """
 
 cflags = ["-Wall", "-Wextra", "-pedantic", "-std=c11"]
+cppflags = ["-Wall", "-Wextra", "-pedantic", "-std=c++20"]
 
 files = [
     "./src/parser.c",
+    "./src/array.c",
     "./src/lexer.c",
     "./src/str_slice.c",
+    "./src/arena.c",
+    "./src/block_index.c",
+    "./src/scan.c",
+    "./src/num.c",
+    "./src/incremental.c",
+    "./src/events.c",
+    "./src/file.c",
+    "./src/writer.c",
+    "./src/binary.c",
+    "./src/frozen.c",
+    "./src/compact.c",
+    "./src/schema.c",
+    "./src/parallel.c",
 ]
 
-libs = ["m"]
+libs = ["pthread"]
 
 sanitizers = [
     "address",
@@ -54,7 +70,7 @@ def find_cpp_compiler() -> str | None:
 
 def get_flags() -> list[str]:
     flags = [*cflags]
-    if "release" in sys.argv:
+    if "release" in sys.argv or "bench" in sys.argv:
         flags.append("-O2")
     else:
         if "-sanitize" in sys.argv or "debug" in sys.argv:
@@ -64,12 +80,14 @@ def get_flags() -> list[str]:
             for sanitizer in sanitizers:
                 flags.append(f"-fsanitize={sanitizer}")
 
-    for lib in libs:
-        flags.append(f"-l{lib}")
-
     return flags
 
 
+# libraries have to come after the objects that use them or the linker will drop them
+def get_link_flags() -> list[str]:
+    return [f"-l{lib}" for lib in libs]
+
+
 def build_library(cc: str, flags: list[str]) -> str | None:
     libname = "libraon.a"
 
@@ -88,14 +106,14 @@ def run_tests(cc: str, flags: list[str], lib_artifact: str):
     if "test" not in sys.argv:
         return
     
-    build_cmd = [cc, *flags, "test.c", lib_artifact, "-o", "raon_test"]
+    build_cmd = [cc, *flags, "test.c", lib_artifact, *get_link_flags(), "-o", "raon_test"]
     print(f"BUILDING WITH: {' '.join(build_cmd)}\n\n")
     res_c = subprocess.run(build_cmd)
 
     cpp = find_cpp_compiler()
     res_cpp = None
     if cpp is not None:
-        build_cpp_cmd = [cpp, "test.cpp", lib_artifact, "-o", "raon_test_cpp"]
+        build_cpp_cmd = [cpp, *cppflags, "test.cpp", lib_artifact, *get_link_flags(), "-o", "raon_test_cpp"]
         res_cpp = subprocess.run(build_cpp_cmd)
 
     if res_c.returncode == 0:
@@ -104,6 +122,18 @@ def run_tests(cc: str, flags: list[str], lib_artifact: str):
         subprocess.run("./raon_test_cpp")
 
 
+def run_benchmarks(cc: str, flags: list[str], lib_artifact: str):
+    if "bench" not in sys.argv:
+        return
+
+    build_cmd = [cc, *flags, "bench.c", lib_artifact, *get_link_flags(), "-o", "raon_bench"]
+    print(f"BUILDING WITH: {' '.join(build_cmd)}\n\n")
+    res = subprocess.run(build_cmd)
+    if res.returncode == 0:
+        bench_args = sys.argv[sys.argv.index("bench") + 1 :]
+        subprocess.run(["./raon_bench", *bench_args])
+
+
 def main() -> int:
     if len(sys.argv) == 1:
         print(HELP_MSG)
@@ -123,6 +153,7 @@ def main() -> int:
         return 1
 
     run_tests(cc, flags, lib_artifact)
+    run_benchmarks(cc, flags, lib_artifact)
 
     return 0
 
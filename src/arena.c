@@ -0,0 +1,132 @@
+#include "raon.h"
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define RAON_ARENA_DEFAULT_CHUNK_SIZE (64 * 1024)
+// chunks stop doubling once they reach this size so huge documents don't overshoot by gigabytes
+#define RAON_ARENA_MAX_CHUNK_SIZE (64 * 1024 * 1024)
+
+struct raon_arena_chunk {
+   struct raon_arena_chunk *next;
+   size_t used, capacity;
+   max_align_t data[];
+};
+
+struct raon_arena raon_arena_init(size_t chunk_size) {
+   return (struct raon_arena) {
+      .chunks = NULL,
+      .chunk_size = chunk_size ? chunk_size : RAON_ARENA_DEFAULT_CHUNK_SIZE,
+   };
+}
+
+static size_t raon_arena_align(size_t size) {
+   const size_t align = _Alignof(max_align_t);
+   return (size + align - 1) & ~(align - 1);
+}
+
+static struct raon_arena_chunk *raon_arena_new_chunk(size_t capacity) {
+   struct raon_arena_chunk *chunk = malloc(sizeof(*chunk) + capacity);
+   if (!chunk) {
+      return NULL;
+   }
+   chunk->next = NULL;
+   chunk->used = 0;
+   chunk->capacity = capacity;
+   return chunk;
+}
+
+void *raon_arena_alloc(struct raon_arena *self, size_t size) {
+   size = raon_arena_align(size ? size : 1);
+
+   struct raon_arena_chunk *head = self->chunks;
+   if (head && head->capacity - head->used >= size) {
+      void *ptr = (char *)head->data + head->used;
+      head->used += size;
+      return ptr;
+   }
+
+   // allocations bigger than a whole chunk get one to themselves, it's placed behind the current
+   // chunk so that the space left in it can still be used by the following allocations
+   if (size > self->chunk_size) {
+      struct raon_arena_chunk *chunk = raon_arena_new_chunk(size);
+      if (!chunk) {
+         return NULL;
+      }
+      chunk->used = size;
+      if (head) {
+         chunk->next = head->next;
+         head->next = chunk;
+      } else {
+         self->chunks = chunk;
+      }
+      return chunk->data;
+   }
+
+   struct raon_arena_chunk *chunk = raon_arena_new_chunk(self->chunk_size);
+   if (!chunk) {
+      return NULL;
+   }
+   chunk->next = head;
+   chunk->used = size;
+   self->chunks = chunk;
+   if (self->chunk_size < RAON_ARENA_MAX_CHUNK_SIZE) {
+      self->chunk_size *= 2;
+   }
+   return chunk->data;
+}
+
+void raon_arena_free(struct raon_arena *self) {
+   struct raon_arena_chunk *chunk = self->chunks;
+   while (chunk) {
+      struct raon_arena_chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+   }
+   self->chunks = NULL;
+}
+
+static void *raon_arena_allocator_alloc(void *ctx, size_t size) {
+   return raon_arena_alloc(ctx, size);
+}
+
+// memory is only given back when the whole arena is freed
+static void raon_arena_allocator_free(void *ctx, void *ptr) {
+   (void)ctx;
+   (void)ptr;
+}
+
+// a vector that's still the latest allocation grows in place instead of being copied
+static void *raon_arena_allocator_realloc(void *ctx, void *ptr, size_t old_size, size_t new_size) {
+   struct raon_arena *self = ctx;
+   struct raon_arena_chunk *head = self->chunks;
+   if (ptr && head) {
+      const size_t old_aligned = raon_arena_align(old_size ? old_size : 1);
+      const size_t new_aligned = raon_arena_align(new_size ? new_size : 1);
+      if (old_aligned <= head->used) {
+         const size_t last = head->used - old_aligned;
+         if ((char *)head->data + last == ptr && last + new_aligned <= head->capacity) {
+            head->used = last + new_aligned;
+            return ptr;
+         }
+      }
+   }
+
+   void *tmp = raon_arena_alloc(self, new_size);
+   if (!tmp) {
+      return NULL;
+   }
+   if (ptr) {
+      memcpy(tmp, ptr, old_size < new_size ? old_size : new_size);
+   }
+   return tmp;
+}
+
+struct vec_allocator raon_arena_allocator(struct raon_arena *self) {
+   return (struct vec_allocator) {
+      .alloc = raon_arena_allocator_alloc,
+      .free = raon_arena_allocator_free,
+      .realloc = raon_arena_allocator_realloc,
+      .ctx = self,
+   };
+}
@@ -0,0 +1,242 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdint.h>
+#include <string.h>
+
+// smallest number of items packed arrays allocate room for
+#define RAON_PACKED_MIN_CAPACITY 8
+
+static bool raon_value_is_packable(struct raon_value value) {
+   return value.type == raon_value_type_int || value.type == raon_value_type_float
+       || value.type == raon_value_type_bool;
+}
+
+static size_t raon_packed_size(enum raon_value_type type, size_t count) {
+   switch (type) {
+   case raon_value_type_int:
+      return count * sizeof(intptr_t);
+   case raon_value_type_float:
+      return count * sizeof(double);
+   default:
+      return (count + 7) / 8;
+   }
+}
+
+// grows a buffer of the array with its allocator, `ptr` is left alone on failure
+static void *raon_array_realloc(
+    struct vector_of_raon_value *array, void *ptr, size_t old_size, size_t new_size) {
+   if (array->allocator.realloc) {
+      return array->allocator.realloc(array->allocator.ctx, ptr, old_size, new_size);
+   }
+   void *grown = array->allocator.alloc(array->allocator.ctx, new_size);
+   if (grown && ptr) {
+      memcpy(grown, ptr, old_size);
+      array->allocator.free(array->allocator.ctx, ptr);
+   }
+   return grown;
+}
+
+// makes room for at least `additional` more packed items
+static bool raon_packed_reserve(struct vector_of_raon_value *array, size_t additional) {
+   struct raon_packed_items *packed = &array->packed;
+   if (additional <= packed->capacity - packed->len) {
+      return true;
+   }
+   if (additional > SIZE_MAX / sizeof(double) - packed->len) {
+      return false;
+   }
+
+   size_t capacity = packed->capacity * 2;
+   if (capacity < packed->len + additional) {
+      capacity = packed->len + additional;
+   }
+   if (capacity < RAON_PACKED_MIN_CAPACITY) {
+      capacity = RAON_PACKED_MIN_CAPACITY;
+   }
+   const size_t old_size = raon_packed_size(packed->type, packed->capacity);
+   const size_t new_size = raon_packed_size(packed->type, capacity);
+
+   void *items = raon_array_realloc(array, packed->ints, old_size, new_size);
+   if (!items) {
+      return false;
+   }
+   packed->ints = items;
+   if (packed->int_bases) {
+      uint8_t *bases = raon_array_realloc(array, packed->int_bases, packed->capacity, capacity);
+      // the items keep their bigger buffer, `capacity` only grows once both buffers did
+      if (!bases) {
+         return false;
+      }
+      packed->int_bases = bases;
+   }
+   packed->capacity = capacity;
+   return true;
+}
+
+void raon_packed_free(struct vector_of_raon_value *array) {
+   if (array->packed.capacity) {
+      array->allocator.free(array->allocator.ctx, array->packed.ints);
+      array->allocator.free(array->allocator.ctx, array->packed.int_bases);
+   }
+   array->packed = (struct raon_packed_items) { 0 };
+}
+
+/*
+   Keeps one base per int from now on, for when an int written in another base than the ones
+   before it is packed with them.
+*/
+static bool raon_packed_split_bases(struct vector_of_raon_value *array) {
+   struct raon_packed_items *packed = &array->packed;
+   uint8_t *bases = array->allocator.alloc(array->allocator.ctx, packed->capacity);
+   if (!bases) {
+      return false;
+   }
+   memset(bases, packed->int_base, packed->capacity);
+   packed->int_bases = bases;
+   return true;
+}
+
+// moves packed items into `vec`, so that items which can't be packed can follow them
+static bool raon_array_unpack(struct vector_of_raon_value *array) {
+   struct raon_packed_items packed = array->packed;
+   if (packed.len == 0) {
+      return true;
+   }
+   if (!vec_reserve_raon_value(array, packed.len)) {
+      return false;
+   }
+
+   array->packed.len = 0;
+   for (size_t i = 0; i < packed.len; i++) {
+      struct raon_value item = { .type = packed.type };
+      switch (packed.type) {
+      case raon_value_type_int:
+         item.int_val = packed.ints[i];
+         item.int_base = packed.int_bases ? packed.int_bases[i] : packed.int_base;
+         break;
+      case raon_value_type_float:
+         item.float_val = packed.floats[i];
+         break;
+      default:
+         item.bool_val = packed.bools[i / 8] >> (i % 8) & 1;
+         break;
+      }
+      vec_push_raon_value(array, item);
+   }
+   raon_packed_free(array);
+   return true;
+}
+
+bool raon_array_push(struct vector_of_raon_value *array, struct raon_value item, size_t size_hint) {
+   struct raon_packed_items *packed = &array->packed;
+   if (array->len == 0 && raon_value_is_packable(item)) {
+      if (packed->len == 0) {
+         packed->type = item.type;
+         packed->int_base = item.int_base;
+      }
+      if (packed->type == item.type) {
+         if (!raon_packed_reserve(array, packed->len == 0 && size_hint ? size_hint : 1)) {
+            return false;
+         }
+         if (item.type == raon_value_type_int && item.int_base != packed->int_base
+             && !packed->int_bases && !raon_packed_split_bases(array)) {
+            return false;
+         }
+         const size_t i = packed->len++;
+         switch (item.type) {
+         case raon_value_type_int:
+            packed->ints[i] = item.int_val;
+            if (packed->int_bases) {
+               packed->int_bases[i] = item.int_base;
+            }
+            break;
+         case raon_value_type_float:
+            packed->floats[i] = item.float_val;
+            break;
+         default:
+            if (i % 8 == 0) {
+               packed->bools[i / 8] = 0;
+            }
+            packed->bools[i / 8] |= (uint8_t)(item.bool_val << (i % 8));
+            break;
+         }
+         return true;
+      }
+      if (!raon_array_unpack(array)) {
+         return false;
+      }
+   }
+
+   if (array->len == 0 && !vec_reserve_raon_value(array, size_hint)) {
+      return false;
+   }
+   return vec_push_raon_value(array, item);
+}
+
+size_t raon_array_len(const struct vector_of_raon_value *array) {
+   if (!array) {
+      return 0;
+   }
+   return array->packed.len ? array->packed.len : array->len;
+}
+
+struct raon_value raon_array_get(const struct vector_of_raon_value *array, size_t index) {
+   if (index >= raon_array_len(array)) {
+      return (struct raon_value) { .type = raon_value_type_error };
+   }
+   const struct raon_packed_items *packed = &array->packed;
+   if (packed->len == 0) {
+      return array->vec[index];
+   }
+
+   struct raon_value item = { .type = packed->type };
+   switch (packed->type) {
+   case raon_value_type_int:
+      item.int_val = packed->ints[index];
+      item.int_base = packed->int_bases ? packed->int_bases[index] : packed->int_base;
+      break;
+   case raon_value_type_float:
+      item.float_val = packed->floats[index];
+      break;
+   default:
+      item.bool_val = packed->bools[index / 8] >> (index % 8) & 1;
+      break;
+   }
+   return item;
+}
+
+// returns the packed items of `type`, an empty array is a view of no items of any type
+static const void *raon_array_view(
+    const struct vector_of_raon_value *array, enum raon_value_type type, size_t *len) {
+   static const double empty[1];
+   if (raon_array_len(array) == 0) {
+      *len = 0;
+      return empty;
+   }
+   if (array->packed.len == 0 || array->packed.type != type) {
+      return NULL;
+   }
+   *len = array->packed.len;
+   return array->packed.ints;
+}
+
+bool raon_array_as_ints(
+    const struct vector_of_raon_value *array, const intptr_t **items, size_t *len) {
+   const void *view = raon_array_view(array, raon_value_type_int, len);
+   *items = view;
+   return view != NULL;
+}
+
+bool raon_array_as_floats(
+    const struct vector_of_raon_value *array, const double **items, size_t *len) {
+   const void *view = raon_array_view(array, raon_value_type_float, len);
+   *items = view;
+   return view != NULL;
+}
+
+bool raon_array_as_bools(
+    const struct vector_of_raon_value *array, const uint8_t **bits, size_t *len) {
+   const void *view = raon_array_view(array, raon_value_type_bool, len);
+   *bits = view;
+   return view != NULL;
+}
@@ -0,0 +1,440 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   Layout, every count and length is an unsigned LEB128 varint:
+
+   document = "RAON" version:u8 block
+   block    = count [key_tag:u8 (key value)*count]
+   key      = string: len bytes | int: zigzag varint
+   value    = tag:u8 payload
+   array    = count [tag:u8 payload*count]
+
+   Payloads are the same for values and array elements: strings are a length and their bytes,
+   ints a zigzag varint, floats 8 little-endian bytes, bools a single byte, blocks a block and
+   arrays an array.
+*/
+
+#define RAON_BINARY_MAGIC "RAON"
+#define RAON_BINARY_VERSION 1
+
+enum raon_binary_tag {
+   raon_binary_tag_string = 1,
+   raon_binary_tag_int,
+   raon_binary_tag_float,
+   raon_binary_tag_bool,
+   raon_binary_tag_block,
+   raon_binary_tag_array,
+};
+
+static enum raon_binary_tag raon_binary_value_tag(enum raon_value_type type) {
+   switch (type) {
+   case raon_value_type_string:
+      return raon_binary_tag_string;
+   case raon_value_type_int:
+      return raon_binary_tag_int;
+   case raon_value_type_float:
+      return raon_binary_tag_float;
+   case raon_value_type_bool:
+      return raon_binary_tag_bool;
+   case raon_value_type_block:
+      return raon_binary_tag_block;
+   case raon_value_type_array:
+      return raon_binary_tag_array;
+   case raon_value_type_error:
+      break;
+   }
+   return 0;
+}
+
+// === Encoding ===
+
+static void raon_binary_put_byte(struct raon_writer *self, uint8_t byte) {
+   if (self->len == RAON_WRITER_BUFFER_SIZE) {
+      raon_writer_flush(self);
+   }
+   self->buf[self->len++] = (char)byte;
+}
+
+static void raon_binary_put_varint(struct raon_writer *self, uint64_t value) {
+   char bytes[10];
+   size_t len = 0;
+   while (value >= 0x80) {
+      bytes[len++] = (char)(value | 0x80);
+      value >>= 7;
+   }
+   bytes[len++] = (char)value;
+   raon_writer_put(self, bytes, len);
+}
+
+// small negative numbers get short varints too
+static void raon_binary_put_int(struct raon_writer *self, intptr_t value) {
+   raon_binary_put_varint(self, ((uint64_t)value << 1) ^ (value < 0 ? UINT64_MAX : 0));
+}
+
+static void raon_binary_put_float(struct raon_writer *self, double value) {
+   uint64_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+   char bytes[8];
+   for (size_t i = 0; i < sizeof(bytes); i++) {
+      bytes[i] = (char)(bits >> (i * 8));
+   }
+   raon_writer_put(self, bytes, sizeof(bytes));
+}
+
+static void raon_binary_put_string(struct raon_writer *self, struct raon_str_slice str) {
+   raon_binary_put_varint(self, str.len);
+   raon_writer_put(self, str.ptr, str.len);
+}
+
+static void raon_binary_put_block(
+    struct raon_writer *self, const struct vector_of_raon_entry *entries);
+static void raon_binary_put_array(
+    struct raon_writer *self, const struct vector_of_raon_value *values);
+
+static void raon_binary_put_payload(struct raon_writer *self, struct raon_value value) {
+   if (value.lazy) {
+      self->failed = true;
+      return;
+   }
+   switch (value.type) {
+   case raon_value_type_string:
+      raon_binary_put_string(self, value.str_val);
+      break;
+   case raon_value_type_int:
+      raon_binary_put_int(self, value.int_val);
+      break;
+   case raon_value_type_float:
+      raon_binary_put_float(self, value.float_val);
+      break;
+   case raon_value_type_bool:
+      raon_binary_put_byte(self, value.bool_val);
+      break;
+   case raon_value_type_block:
+      raon_binary_put_block(self, value.block_val);
+      break;
+   case raon_value_type_array:
+      raon_binary_put_array(self, value.array_val);
+      break;
+   case raon_value_type_error:
+      self->failed = true;
+      break;
+   }
+}
+
+static void raon_binary_put_block(
+    struct raon_writer *self, const struct vector_of_raon_entry *entries) {
+   const size_t len = entries ? entries->len : 0;
+   raon_binary_put_varint(self, len);
+   if (len == 0) {
+      return;
+   }
+
+   const enum raon_key_type key_type = entries->vec[0].key_type;
+   if (key_type == raon_key_type_error) {
+      self->failed = true;
+      return;
+   }
+   raon_binary_put_byte(self,
+       key_type == raon_key_type_string ? raon_binary_tag_string : raon_binary_tag_int);
+   for (size_t i = 0; i < len && !self->failed; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      if (entry->key_type != key_type) {
+         self->failed = true;
+         return;
+      }
+      if (key_type == raon_key_type_string) {
+         raon_binary_put_string(self, entry->str_key);
+      } else {
+         raon_binary_put_int(self, entry->int_key);
+      }
+      raon_binary_put_byte(self, raon_binary_value_tag(entry->value.type));
+      raon_binary_put_payload(self, entry->value);
+   }
+}
+
+static void raon_binary_put_array(
+    struct raon_writer *self, const struct vector_of_raon_value *values) {
+   const size_t len = raon_array_len(values);
+   raon_binary_put_varint(self, len);
+   if (len == 0) {
+      return;
+   }
+
+   const enum raon_value_type type = raon_array_get(values, 0).type;
+   raon_binary_put_byte(self, raon_binary_value_tag(type));
+   for (size_t i = 0; i < len && !self->failed; i++) {
+      const struct raon_value item = raon_array_get(values, i);
+      if (item.type != type) {
+         self->failed = true;
+         return;
+      }
+      raon_binary_put_payload(self, item);
+   }
+}
+
+bool raon_encode_binary(const struct vector_of_raon_entry *entries, struct raon_sink sink) {
+   struct raon_writer *self = malloc(sizeof(*self));
+   if (!self) {
+      return false;
+   }
+   raon_writer_init(self, sink, (struct raon_write_options) { 0 });
+
+   raon_writer_put(self, RAON_BINARY_MAGIC, strlen(RAON_BINARY_MAGIC));
+   raon_binary_put_byte(self, RAON_BINARY_VERSION);
+   raon_binary_put_block(self, entries);
+   raon_writer_flush(self);
+
+   const bool success = !self->failed;
+   free(self);
+   return success;
+}
+
+// === Decoding ===
+
+struct raon_binary_reader {
+   char *data;
+   size_t len;
+   size_t idx;
+   // number of blocks and arrays the reader is inside of, see `RAON_BINARY_MAX_DEPTH`
+   size_t depth;
+   struct vec_allocator allocator;
+};
+
+static bool raon_binary_read_byte(struct raon_binary_reader *self, uint8_t *out) {
+   if (self->idx == self->len) {
+      return false;
+   }
+   *out = (uint8_t)self->data[self->idx++];
+   return true;
+}
+
+static bool raon_binary_read_varint(struct raon_binary_reader *self, uint64_t *out) {
+   uint64_t value = 0;
+   for (unsigned shift = 0; shift < 64; shift += 7) {
+      uint8_t byte;
+      if (!raon_binary_read_byte(self, &byte)) {
+         return false;
+      }
+      value |= (uint64_t)(byte & 0x7F) << shift;
+      if (byte < 0x80) {
+         // the tenth byte only has room for the top bit
+         if (shift == 63 && byte > 1) {
+            return false;
+         }
+         *out = value;
+         return true;
+      }
+   }
+   return false;
+}
+
+static bool raon_binary_read_int(struct raon_binary_reader *self, intptr_t *out) {
+   uint64_t zigzag;
+   if (!raon_binary_read_varint(self, &zigzag)) {
+      return false;
+   }
+   *out = (intptr_t)((zigzag >> 1) ^ (0 - (zigzag & 1)));
+   return true;
+}
+
+static bool raon_binary_read_float(struct raon_binary_reader *self, double *out) {
+   if (self->len - self->idx < 8) {
+      return false;
+   }
+   const unsigned char *bytes = (const unsigned char *)&self->data[self->idx];
+   uint64_t bits = 0;
+   for (size_t i = 0; i < 8; i++) {
+      bits |= (uint64_t)bytes[i] << (i * 8);
+   }
+   memcpy(out, &bits, sizeof(*out));
+   self->idx += 8;
+   return true;
+}
+
+static bool raon_binary_read_string(struct raon_binary_reader *self, struct raon_str_slice *out) {
+   uint64_t len;
+   if (!raon_binary_read_varint(self, &len) || len > self->len - self->idx) {
+      return false;
+   }
+   *out = (struct raon_str_slice) { .ptr = &self->data[self->idx], .len = len };
+   self->idx += len;
+   return true;
+}
+
+// every element takes at least a byte, so counts past the end of the data are rejected before
+// anything is allocated for them
+static bool raon_binary_read_count(struct raon_binary_reader *self, size_t *out) {
+   uint64_t count;
+   if (!raon_binary_read_varint(self, &count) || count > self->len - self->idx) {
+      return false;
+   }
+   *out = count;
+   return true;
+}
+
+static bool raon_binary_read_block(
+    struct raon_binary_reader *self, struct vector_of_raon_entry *entries);
+static struct vector_of_raon_value *raon_binary_read_array(struct raon_binary_reader *self);
+
+static bool raon_binary_read_payload(
+    struct raon_binary_reader *self, uint8_t tag, struct raon_value *out) {
+   switch (tag) {
+   case raon_binary_tag_string:
+      out->type = raon_value_type_string;
+      return raon_binary_read_string(self, &out->str_val);
+
+   case raon_binary_tag_int:
+      out->type = raon_value_type_int;
+      return raon_binary_read_int(self, &out->int_val);
+
+   case raon_binary_tag_float:
+      out->type = raon_value_type_float;
+      return raon_binary_read_float(self, &out->float_val);
+
+   case raon_binary_tag_bool: {
+      uint8_t byte;
+      if (!raon_binary_read_byte(self, &byte) || byte > 1) {
+         return false;
+      }
+      out->type = raon_value_type_bool;
+      out->bool_val = byte;
+      return true;
+   }
+
+   case raon_binary_tag_block: {
+      if (self->depth == RAON_BINARY_MAX_DEPTH) {
+         return false;
+      }
+      out->type = raon_value_type_block;
+      out->block_val = vec_new_raon_entry(self->allocator);
+      ++self->depth;
+      const bool valid = out->block_val && raon_binary_read_block(self, out->block_val);
+      --self->depth;
+      return valid;
+   }
+
+   case raon_binary_tag_array:
+      if (self->depth == RAON_BINARY_MAX_DEPTH) {
+         return false;
+      }
+      out->type = raon_value_type_array;
+      ++self->depth;
+      out->array_val = raon_binary_read_array(self);
+      --self->depth;
+      return out->array_val != NULL;
+   }
+   return false;
+}
+
+// the encoder never repeats a key, so blocks that do were made by hand or corrupted
+static bool raon_binary_keys_unique(struct vector_of_raon_entry *entries) {
+   if (entries->len >= RAON_BLOCK_INDEX_THRESHOLD) {
+      return raon_block_keys_unique(entries);
+   }
+   for (size_t i = 1; i < entries->len; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      for (size_t j = 0; j < i; j++) {
+         const struct raon_entry *other = &entries->vec[j];
+         if (entry->key_type == raon_key_type_string
+                 ? entry->str_key.len == other->str_key.len
+                     && memcmp(entry->str_key.ptr, other->str_key.ptr, entry->str_key.len) == 0
+                 : entry->int_key == other->int_key) {
+            return false;
+         }
+      }
+   }
+   return true;
+}
+
+static bool raon_binary_read_block(
+    struct raon_binary_reader *self, struct vector_of_raon_entry *entries) {
+   size_t count;
+   if (!raon_binary_read_count(self, &count)) {
+      return false;
+   }
+   if (count == 0) {
+      return true;
+   }
+
+   uint8_t key_tag;
+   if (!raon_binary_read_byte(self, &key_tag)
+       || (key_tag != raon_binary_tag_string && key_tag != raon_binary_tag_int)
+       || !vec_reserve_exact_raon_entry(entries, count)) {
+      return false;
+   }
+
+   for (size_t i = 0; i < count; i++) {
+      struct raon_entry entry = { 0 };
+      bool valid;
+      if (key_tag == raon_binary_tag_string) {
+         entry.key_type = raon_key_type_string;
+         valid = raon_binary_read_string(self, &entry.str_key);
+      } else {
+         entry.key_type = raon_key_type_num;
+         valid = raon_binary_read_int(self, &entry.int_key);
+      }
+
+      uint8_t tag;
+      if (!valid || !raon_binary_read_byte(self, &tag)
+          || !raon_binary_read_payload(self, tag, &entry.value)) {
+         return false;
+      }
+      vec_push_raon_entry(entries, entry);
+   }
+
+   // big blocks are indexed while checking their keys, which their lookups then go through
+   return raon_binary_keys_unique(entries);
+}
+
+static struct vector_of_raon_value *raon_binary_read_array(struct raon_binary_reader *self) {
+   size_t count;
+   struct vector_of_raon_value *values = vec_new_raon_value(self->allocator);
+   if (!values || !raon_binary_read_count(self, &count)) {
+      return NULL;
+   }
+   if (count == 0) {
+      return values;
+   }
+
+   uint8_t tag;
+   if (!raon_binary_read_byte(self, &tag)) {
+      return NULL;
+   }
+   // every item has the same tag, so arrays of ints, floats and bools are packed right away
+   for (size_t i = 0; i < count; i++) {
+      struct raon_value value = { 0 };
+      if (!raon_binary_read_payload(self, tag, &value) || !raon_array_push(values, value, count)) {
+         return NULL;
+      }
+   }
+   return values;
+}
+
+struct raon_document *raon_decode_binary(char *data, size_t len) {
+   const size_t magic_len = strlen(RAON_BINARY_MAGIC);
+   if (len <= magic_len || memcmp(data, RAON_BINARY_MAGIC, magic_len) != 0
+       || (uint8_t)data[magic_len] != RAON_BINARY_VERSION) {
+      return NULL;
+   }
+
+   struct raon_document *doc = raon_document_new(len);
+   if (!doc) {
+      return NULL;
+   }
+
+   // everything is allocated in the document's arena, so failing halfway only has to free it
+   struct raon_binary_reader reader = {
+      .data = data,
+      .len = len,
+      .idx = magic_len + 1,
+      .allocator = raon_arena_allocator(&doc->arena),
+   };
+   if (!raon_binary_read_block(&reader, doc->entries) || reader.idx != len) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
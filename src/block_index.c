@@ -0,0 +1,237 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdint.h>
+#include <string.h>
+
+// the hash table helpers are only used by this file so they're kept out of the library's symbols
+#define HT_PUBDEF static inline
+#define HT_IMPLEMENTATION
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wunused-function"
+#include "../vendor/ht.h"
+#pragma GCC diagnostic pop
+
+// string keys carry their hash so that lookups, inserts and rehashes only hash the key once
+struct raon_hashed_str {
+   struct raon_str_slice str;
+   uintptr_t hash;
+};
+
+typedef Ht(struct raon_hashed_str, size_t) raon_str_key_table;
+typedef Ht(intptr_t, size_t) raon_int_key_table;
+
+// maps keys to their position in the block, blocks only have one key type so only one table is used
+struct raon_block_index {
+   enum raon_key_type key_type;
+   // number of entries from the start of the block that are already in the table
+   size_t indexed_len;
+   union {
+      raon_str_key_table str_keys;
+      raon_int_key_table int_keys;
+   };
+};
+
+static uint64_t raon_hash_mix(uint64_t hash) {
+   hash ^= hash >> 32;
+   hash *= 0xd6e8feb86659fd93u;
+   hash ^= hash >> 32;
+   return hash;
+}
+
+// hashes a word at a time, keys are mostly short identifiers so this beats a byte-wise hash
+uint64_t raon_hash_bytes(const char *str, size_t len) {
+   uint64_t hash = len * 0x9e3779b97f4a7c15u;
+   for (; len >= sizeof(uint64_t); str += sizeof(uint64_t), len -= sizeof(uint64_t)) {
+      uint64_t word;
+      memcpy(&word, str, sizeof(word));
+      hash = (hash ^ word) * 0xbf58476d1ce4e5b9u;
+      hash ^= hash >> 31;
+   }
+   if (len) {
+      uint64_t word = 0;
+      memcpy(&word, str, len);
+      hash = (hash ^ word) * 0x94d049bb133111ebu;
+   }
+   return raon_hash_mix(hash);
+}
+
+uint64_t raon_hash_int(intptr_t key) {
+   return raon_hash_mix((uint64_t)key * 0x9e3779b97f4a7c15u);
+}
+
+static struct raon_hashed_str raon_hash_str(struct raon_str_slice str) {
+   const uint64_t hash = raon_hash_bytes(str.ptr, str.len);
+   return (struct raon_hashed_str) { .str = str, .hash = (uintptr_t)hash };
+}
+
+static uintptr_t raon_hashed_str_hasheq(Ht_Op op, void const *a_, void const *b_, size_t n) {
+   (void)n;
+   const struct raon_hashed_str *a = a_;
+   const struct raon_hashed_str *b = b_;
+   switch (op) {
+   case HT_HASH:
+      return a->hash;
+   case HT_EQ:
+      return a->str.len == b->str.len && memcmp(a->str.ptr, b->str.ptr, a->str.len) == 0;
+   }
+   return 0;
+}
+
+static uintptr_t raon_int_key_hasheq(Ht_Op op, void const *a_, void const *b_, size_t n) {
+   (void)n;
+   const intptr_t *a = a_;
+   const intptr_t *b = b_;
+   switch (op) {
+   case HT_HASH:
+      return (uintptr_t)raon_hash_int(*a);
+   case HT_EQ:
+      return *a == *b;
+   }
+   return 0;
+}
+
+static Ht_Allocator raon_block_ht_allocator(struct vector_of_raon_entry *block) {
+   return (Ht_Allocator) {
+      .alloc = block->allocator.alloc,
+      .free = block->allocator.free,
+      .ctx = block->allocator.ctx,
+   };
+}
+
+bool raon_block_build_index(struct vector_of_raon_entry *block) {
+   if (vec_is_empty_raon_entry(block)) {
+      return true;
+   }
+
+   // blocks built by hand can mix key types, which a single table can't hold, so they're only
+   // ever scanned
+   const enum raon_key_type key_type = block->vec[0].key_type;
+   for (size_t i = block->index ? block->index->indexed_len : 1; i < block->len; i++) {
+      if (block->vec[i].key_type != key_type) {
+         raon_block_free_index(block);
+         return false;
+      }
+   }
+
+   struct raon_block_index *index = block->index;
+   if (!index) {
+      index = block->allocator.alloc(block->allocator.ctx, sizeof(*index));
+      if (!index) {
+         return false;
+      }
+      memset(index, 0, sizeof(*index));
+      index->key_type = key_type;
+      if (index->key_type == raon_key_type_string) {
+         index->str_keys.allocator = raon_block_ht_allocator(block);
+         index->str_keys.hasheq = raon_hashed_str_hasheq;
+      } else {
+         index->int_keys.allocator = raon_block_ht_allocator(block);
+         index->int_keys.hasheq = raon_int_key_hasheq;
+      }
+      block->index = index;
+   }
+
+   for (size_t i = index->indexed_len; i < block->len; i++) {
+      const struct raon_entry *entry = &block->vec[i];
+      // duplicated keys resolve to their first occurrence, the same as a linear scan would
+      if (index->key_type == raon_key_type_string) {
+         const size_t count = index->str_keys.count;
+         size_t *pos = ht_find_or_put(&index->str_keys, raon_hash_str(entry->str_key));
+         if (index->str_keys.count != count) {
+            *pos = i;
+         }
+      } else {
+         const size_t count = index->int_keys.count;
+         size_t *pos = ht_find_or_put(&index->int_keys, entry->int_key);
+         if (index->int_keys.count != count) {
+            *pos = i;
+         }
+      }
+   }
+   index->indexed_len = block->len;
+   return true;
+}
+
+bool raon_block_keys_unique(struct vector_of_raon_entry *block) {
+   if (vec_is_empty_raon_entry(block)) {
+      return true;
+   }
+   if (!raon_block_build_index(block)) {
+      return false;
+   }
+   const size_t count = block->index->key_type == raon_key_type_string
+       ? block->index->str_keys.count
+       : block->index->int_keys.count;
+   return count == block->len;
+}
+
+void raon_block_free_index(struct vector_of_raon_entry *block) {
+   struct raon_block_index *index = block->index;
+   if (!index) {
+      return;
+   }
+   if (index->key_type == raon_key_type_string) {
+      ht_free(&index->str_keys);
+   } else {
+      ht_free(&index->int_keys);
+   }
+   block->allocator.free(block->allocator.ctx, index);
+   block->index = NULL;
+}
+
+// makes sure that the index is up to date for blocks that need one
+static bool raon_block_use_index(struct vector_of_raon_entry *block) {
+   if (!block->index && block->len < RAON_BLOCK_INDEX_THRESHOLD) {
+      return false;
+   }
+   if (block->index && block->index->indexed_len == block->len) {
+      return true;
+   }
+   return raon_block_build_index(block);
+}
+
+struct raon_value *raon_block_get(struct vector_of_raon_entry *block, const char *key, size_t len) {
+   if (!block || vec_is_empty_raon_entry(block)) {
+      return NULL;
+   }
+
+   // only blocks that have a single key type are indexed
+   if (raon_block_use_index(block)) {
+      if (block->index->key_type != raon_key_type_string) {
+         return NULL;
+      }
+      const struct raon_str_slice slice = { .ptr = (char *)key, .len = len };
+      size_t *pos = ht_find(&block->index->str_keys, raon_hash_str(slice));
+      return pos ? &block->vec[*pos].value : NULL;
+   }
+
+   for (size_t i = 0; i < block->len; i++) {
+      struct raon_entry *entry = &block->vec[i];
+      if (entry->key_type == raon_key_type_string && entry->str_key.len == len
+          && memcmp(entry->str_key.ptr, key, len) == 0) {
+         return &entry->value;
+      }
+   }
+   return NULL;
+}
+
+struct raon_value *raon_block_get_int(struct vector_of_raon_entry *block, intptr_t key) {
+   if (!block || vec_is_empty_raon_entry(block)) {
+      return NULL;
+   }
+
+   if (raon_block_use_index(block)) {
+      if (block->index->key_type != raon_key_type_num) {
+         return NULL;
+      }
+      size_t *pos = ht_find(&block->index->int_keys, key);
+      return pos ? &block->vec[*pos].value : NULL;
+   }
+
+   for (size_t i = 0; i < block->len; i++) {
+      if (block->vec[i].key_type == raon_key_type_num && block->vec[i].int_key == key) {
+         return &block->vec[i].value;
+      }
+   }
+   return NULL;
+}
@@ -0,0 +1,560 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   A compact document is a single allocation holding the document followed by its pools, nodes
+   refer to the items of a pool by their position:
+   - words: items of packed arrays, ints and floats take a word each and bools a bit each
+   - entries: entries of blocks, a key followed by the node of its value
+   - items: items of arrays that aren't packed
+   - slots: hash tables of the keys of big blocks, which hold the position of an entry plus one
+     with 0 as an empty slot
+   - indexes: where the entries and table of every big block start, in the order of their entries
+
+   The entries of a block, or items of an array, are reserved before anything nested in them is
+   filled in, so they're always next to each other.
+*/
+
+struct raon_compact_entry {
+   // string keys are an offset and a length, int keys are split in two halves
+   uint32_t key[2];
+   struct raon_compact_node value;
+};
+
+struct raon_compact_index {
+   uint32_t first_entry;
+   uint32_t first_slot;
+};
+
+struct raon_compact {
+   char *text;
+   size_t text_len;
+   // size of the whole allocation
+   size_t size;
+   struct raon_compact_node root;
+   uint64_t *words;
+   struct raon_compact_entry *entries;
+   struct raon_compact_node *items;
+   uint32_t *slots;
+   struct raon_compact_index *indexes;
+   size_t index_count;
+};
+
+// number of elements of every pool, used to size them and then as the cursors that fill them
+struct raon_compact_counts {
+   size_t words, entries, items, slots, indexes;
+};
+
+struct raon_compact_builder {
+   struct raon_compact *doc;
+   struct raon_compact_counts next;
+};
+
+static uint64_t raon_compact_join(const uint32_t halves[2]) {
+   return halves[0] | (uint64_t)halves[1] << 32;
+}
+
+static void raon_compact_split(uint64_t value, uint32_t halves[2]) {
+   halves[0] = (uint32_t)value;
+   halves[1] = (uint32_t)(value >> 32);
+}
+
+// twice as many slots as entries rounded up to a power of two, the same as frozen snapshots
+static size_t raon_compact_slot_count(size_t count) {
+   size_t slots = 1;
+   while (slots < count * 2) {
+      slots *= 2;
+   }
+   return slots;
+}
+
+static bool raon_compact_is_indexed(size_t count) {
+   return count >= RAON_BLOCK_INDEX_THRESHOLD;
+}
+
+// === Building ===
+
+static bool raon_compact_count_value(struct raon_compact_counts *counts, struct raon_value value);
+
+static bool raon_compact_count_block(
+    struct raon_compact_counts *counts, const struct vector_of_raon_entry *entries) {
+   const size_t count = entries ? entries->len : 0;
+   counts->entries += count;
+   if (raon_compact_is_indexed(count)) {
+      counts->slots += raon_compact_slot_count(count);
+      counts->indexes++;
+   }
+   for (size_t i = 0; i < count; i++) {
+      if (!raon_compact_count_value(counts, entries->vec[i].value)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+// packed nodes have a single int base, ints in different bases get a node each instead
+static bool raon_compact_packs(const struct vector_of_raon_value *array) {
+   return array->packed.len && !array->packed.int_bases;
+}
+
+static bool raon_compact_count_value(struct raon_compact_counts *counts, struct raon_value value) {
+   if (value.lazy) {
+      return false;
+   }
+   if (value.type == raon_value_type_block) {
+      return raon_compact_count_block(counts, value.block_val);
+   }
+   if (value.type != raon_value_type_array || !value.array_val) {
+      return true;
+   }
+
+   const struct vector_of_raon_value *array = value.array_val;
+   if (raon_compact_packs(array)) {
+      counts->words += array->packed.type == raon_value_type_bool ? (array->packed.len + 63) / 64
+                                                                  : array->packed.len;
+      return true;
+   }
+   const size_t len = raon_array_len(array);
+   counts->items += len;
+   for (size_t i = 0; i < len; i++) {
+      if (!raon_compact_count_value(counts, raon_array_get(array, i))) {
+         return false;
+      }
+   }
+   return true;
+}
+
+// strings always point into the text for documents that come out of the parser
+static bool raon_compact_fill_string(
+    struct raon_compact_builder *self, struct raon_str_slice str, uint32_t halves[2]) {
+   const char *text = self->doc->text;
+   if (str.len == 0) {
+      halves[0] = halves[1] = 0;
+      return true;
+   }
+   if (str.ptr < text || str.len > self->doc->text_len
+       || (size_t)(str.ptr - text) > self->doc->text_len - str.len) {
+      return false;
+   }
+   halves[0] = (uint32_t)(str.ptr - text);
+   halves[1] = (uint32_t)str.len;
+   return true;
+}
+
+static uint64_t raon_compact_entry_hash(
+    const struct raon_compact *doc, const struct raon_compact_entry *entry, uint8_t key_type) {
+   return key_type == raon_key_type_string
+       ? raon_hash_bytes(&doc->text[entry->key[0]], entry->key[1])
+       : raon_hash_int((intptr_t)raon_compact_join(entry->key));
+}
+
+static bool raon_compact_same_key(const struct raon_compact *doc,
+    const struct raon_compact_entry *a, const struct raon_compact_entry *b, uint8_t key_type) {
+   if (key_type == raon_key_type_num) {
+      return a->key[0] == b->key[0] && a->key[1] == b->key[1];
+   }
+   return a->key[1] == b->key[1]
+       && memcmp(&doc->text[a->key[0]], &doc->text[b->key[0]], a->key[1]) == 0;
+}
+
+// fills in the table of a block, later duplicates of a key are left out of it
+static void raon_compact_fill_slots(struct raon_compact *doc, uint32_t first_entry, size_t count,
+    uint8_t key_type, uint32_t *slots) {
+   const size_t slot_count = raon_compact_slot_count(count);
+   memset(slots, 0, slot_count * sizeof(*slots));
+   const struct raon_compact_entry *entries = &doc->entries[first_entry];
+   for (size_t i = 0; i < count; i++) {
+      for (size_t slot = raon_compact_entry_hash(doc, &entries[i], key_type);; slot++) {
+         slot &= slot_count - 1;
+         if (slots[slot] == 0) {
+            slots[slot] = (uint32_t)i + 1;
+            break;
+         }
+         if (raon_compact_same_key(doc, &entries[slots[slot] - 1], &entries[i], key_type)) {
+            break;
+         }
+      }
+   }
+}
+
+static bool raon_compact_fill_value(
+    struct raon_compact_builder *self, struct raon_value value, struct raon_compact_node *node);
+
+static bool raon_compact_fill_block(struct raon_compact_builder *self,
+    const struct vector_of_raon_entry *entries, struct raon_compact_node *node) {
+   const size_t count = entries ? entries->len : 0;
+   const uint8_t key_type = count ? (uint8_t)entries->vec[0].key_type : raon_key_type_string;
+   const uint32_t first = (uint32_t)self->next.entries;
+   self->next.entries += count;
+   *node = (struct raon_compact_node) {
+      .type = raon_value_type_block,
+      .child_type = key_type,
+      .payload = { first, (uint32_t)count },
+   };
+
+   // the index is reserved along with the entries so that indexes stay sorted by their entries
+   struct raon_compact_index *index = NULL;
+   if (raon_compact_is_indexed(count)) {
+      index = &self->doc->indexes[self->next.indexes++];
+      index->first_entry = first;
+      index->first_slot = (uint32_t)self->next.slots;
+      self->next.slots += raon_compact_slot_count(count);
+   }
+
+   for (size_t i = 0; i < count; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      struct raon_compact_entry *out = &self->doc->entries[first + i];
+      if (entry->key_type != key_type) {
+         return false;
+      }
+      if (key_type == raon_key_type_string) {
+         if (!raon_compact_fill_string(self, entry->str_key, out->key)) {
+            return false;
+         }
+      } else {
+         raon_compact_split((uint64_t)entry->int_key, out->key);
+      }
+      if (!raon_compact_fill_value(self, entry->value, &out->value)) {
+         return false;
+      }
+   }
+
+   if (index) {
+      raon_compact_fill_slots(
+          self->doc, first, count, key_type, &self->doc->slots[index->first_slot]);
+   }
+   return true;
+}
+
+static bool raon_compact_fill_array(struct raon_compact_builder *self,
+    const struct vector_of_raon_value *array, struct raon_compact_node *node) {
+   const size_t len = raon_array_len(array);
+   *node = (struct raon_compact_node) {
+      .type = raon_value_type_array,
+      .child_type = len ? (uint8_t)raon_array_get(array, 0).type : raon_value_type_error,
+      .payload = { 0, (uint32_t)len },
+   };
+   if (len == 0) {
+      return true;
+   }
+
+   const struct raon_packed_items *packed = &array->packed;
+   if (raon_compact_packs(array)) {
+      uint64_t *words = &self->doc->words[self->next.words];
+      node->packed = true;
+      node->int_base = packed->int_base;
+      node->payload[0] = (uint32_t)self->next.words;
+      if (packed->type == raon_value_type_bool) {
+         const size_t word_count = (len + 63) / 64;
+         memset(words, 0, word_count * sizeof(*words));
+         for (size_t i = 0; i < len; i++) {
+            words[i / 64] |= (uint64_t)(packed->bools[i / 8] >> (i % 8) & 1) << (i % 64);
+         }
+         self->next.words += word_count;
+      } else if (packed->type == raon_value_type_int) {
+         for (size_t i = 0; i < len; i++) {
+            words[i] = (uint64_t)packed->ints[i];
+         }
+         self->next.words += len;
+      } else {
+         memcpy(words, packed->floats, len * sizeof(*words));
+         self->next.words += len;
+      }
+      return true;
+   }
+
+   const uint32_t first = (uint32_t)self->next.items;
+   node->payload[0] = first;
+   self->next.items += len;
+   for (size_t i = 0; i < len; i++) {
+      const struct raon_value item = raon_array_get(array, i);
+      if (item.type != node->child_type
+          || !raon_compact_fill_value(self, item, &self->doc->items[first + i])) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool raon_compact_fill_value(
+    struct raon_compact_builder *self, struct raon_value value, struct raon_compact_node *node) {
+   *node = (struct raon_compact_node) { .type = value.type };
+   switch (value.type) {
+   case raon_value_type_string:
+      return raon_compact_fill_string(self, value.str_val, node->payload);
+
+   case raon_value_type_int:
+      node->int_base = value.int_base;
+      raon_compact_split((uint64_t)value.int_val, node->payload);
+      return true;
+
+   case raon_value_type_float: {
+      uint64_t bits;
+      memcpy(&bits, &value.float_val, sizeof(bits));
+      raon_compact_split(bits, node->payload);
+      return true;
+   }
+
+   case raon_value_type_bool:
+      node->payload[0] = value.bool_val;
+      return true;
+
+   case raon_value_type_block:
+      return raon_compact_fill_block(self, value.block_val, node);
+
+   case raon_value_type_array:
+      return raon_compact_fill_array(self, value.array_val, node);
+
+   case raon_value_type_error:
+      break;
+   }
+   return false;
+}
+
+// allocates the document and its pools at once, the words come first since they need 8 bytes of
+// alignment and every other pool only needs 4
+static struct raon_compact *raon_compact_alloc(const struct raon_compact_counts *counts) {
+   const size_t sizes[] = {
+      sizeof(struct raon_compact),
+      counts->words * sizeof(uint64_t),
+      counts->entries * sizeof(struct raon_compact_entry),
+      counts->items * sizeof(struct raon_compact_node),
+      counts->slots * sizeof(uint32_t),
+      counts->indexes * sizeof(struct raon_compact_index),
+   };
+   size_t size = 0;
+   for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+      if (sizes[i] > SIZE_MAX - size) {
+         return NULL;
+      }
+      size += sizes[i];
+   }
+
+   char *data = malloc(size);
+   if (!data) {
+      return NULL;
+   }
+   struct raon_compact *doc = (struct raon_compact *)data;
+   *doc = (struct raon_compact) { .size = size, .index_count = counts->indexes };
+   data += sizes[0];
+   doc->words = (uint64_t *)data;
+   data += sizes[1];
+   doc->entries = (struct raon_compact_entry *)data;
+   data += sizes[2];
+   doc->items = (struct raon_compact_node *)data;
+   data += sizes[3];
+   doc->slots = (uint32_t *)data;
+   data += sizes[4];
+   doc->indexes = (struct raon_compact_index *)data;
+   return doc;
+}
+
+struct raon_compact *raon_compact_parse(char *str, size_t len) {
+   if (len > UINT32_MAX) {
+      return NULL;
+   }
+   struct raon_document *parsed = raon_parse_document(str, len);
+   if (!parsed) {
+      return NULL;
+   }
+
+   // positions in every pool have to fit in 32 bits
+   struct raon_compact_counts counts = { 0 };
+   struct raon_compact *doc = NULL;
+   if (raon_compact_count_block(&counts, parsed->entries) && counts.words <= UINT32_MAX
+       && counts.entries <= UINT32_MAX && counts.items <= UINT32_MAX
+       && counts.slots <= UINT32_MAX) {
+      doc = raon_compact_alloc(&counts);
+   }
+   if (doc) {
+      doc->text = str;
+      doc->text_len = len;
+      struct raon_compact_builder builder = { .doc = doc };
+      if (!raon_compact_fill_block(&builder, parsed->entries, &doc->root)) {
+         raon_compact_free(doc);
+         doc = NULL;
+      }
+   }
+
+   raon_document_free(parsed);
+   return doc;
+}
+
+void raon_compact_free(struct raon_compact *self) {
+   free(self);
+}
+
+size_t raon_compact_size(const struct raon_compact *self) {
+   return self->size;
+}
+
+// === Reading ===
+
+static struct raon_compact_value raon_compact_missing(const struct raon_compact *doc) {
+   return (struct raon_compact_value) { .doc = doc, .node = { .type = raon_value_type_error } };
+}
+
+struct raon_compact_value raon_compact_root(const struct raon_compact *self) {
+   return (struct raon_compact_value) { .doc = self, .node = self->root };
+}
+
+enum raon_value_type raon_compact_type(struct raon_compact_value value) {
+   return (enum raon_value_type)value.node.type;
+}
+
+intptr_t raon_compact_int(struct raon_compact_value value) {
+   if (value.node.type != raon_value_type_int) {
+      return 0;
+   }
+   return (intptr_t)raon_compact_join(value.node.payload);
+}
+
+uint8_t raon_compact_int_base(struct raon_compact_value value) {
+   return value.node.type == raon_value_type_int ? value.node.int_base : 0;
+}
+
+double raon_compact_float(struct raon_compact_value value) {
+   if (value.node.type != raon_value_type_float) {
+      return 0.0;
+   }
+   const uint64_t bits = raon_compact_join(value.node.payload);
+   double result;
+   memcpy(&result, &bits, sizeof(result));
+   return result;
+}
+
+bool raon_compact_bool(struct raon_compact_value value) {
+   return value.node.type == raon_value_type_bool && value.node.payload[0] != 0;
+}
+
+struct raon_str_slice raon_compact_string(struct raon_compact_value value) {
+   if (value.node.type != raon_value_type_string) {
+      return (struct raon_str_slice) { 0 };
+   }
+   return (struct raon_str_slice) {
+      .ptr = &value.doc->text[value.node.payload[0]],
+      .len = value.node.payload[1],
+   };
+}
+
+size_t raon_compact_len(struct raon_compact_value value) {
+   if (value.node.type != raon_value_type_block && value.node.type != raon_value_type_array) {
+      return 0;
+   }
+   return value.node.payload[1];
+}
+
+struct raon_compact_value raon_compact_at(struct raon_compact_value value, size_t index) {
+   const struct raon_compact *doc = value.doc;
+   if (index >= raon_compact_len(value)) {
+      return raon_compact_missing(doc);
+   }
+   const uint32_t first = value.node.payload[0];
+   if (value.node.type == raon_value_type_block) {
+      return (struct raon_compact_value) { .doc = doc, .node = doc->entries[first + index].value };
+   }
+   if (!value.node.packed) {
+      return (struct raon_compact_value) { .doc = doc, .node = doc->items[first + index] };
+   }
+
+   struct raon_compact_node item = { .type = value.node.child_type };
+   if (item.type == raon_value_type_bool) {
+      item.payload[0] = doc->words[first + index / 64] >> (index % 64) & 1;
+   } else {
+      item.int_base = item.type == raon_value_type_int ? value.node.int_base : 0;
+      raon_compact_split(doc->words[first + index], item.payload);
+   }
+   return (struct raon_compact_value) { .doc = doc, .node = item };
+}
+
+struct raon_key raon_compact_key_at(struct raon_compact_value block, size_t index) {
+   if (block.node.type != raon_value_type_block || index >= block.node.payload[1]) {
+      return (struct raon_key) { .type = raon_key_type_error };
+   }
+   const struct raon_compact_entry *entry = &block.doc->entries[block.node.payload[0] + index];
+   if (block.node.child_type == raon_key_type_num) {
+      return (struct raon_key) {
+         .type = raon_key_type_num,
+         .int_key = (intptr_t)raon_compact_join(entry->key),
+      };
+   }
+   return (struct raon_key) {
+      .type = raon_key_type_string,
+      .str_key = { .ptr = &block.doc->text[entry->key[0]], .len = entry->key[1] },
+   };
+}
+
+static bool raon_compact_key_matches(const struct raon_compact *doc,
+    const struct raon_compact_entry *entry, uint8_t key_type, const char *key, size_t len,
+    intptr_t int_key) {
+   if (key_type == raon_key_type_num) {
+      return (intptr_t)raon_compact_join(entry->key) == int_key;
+   }
+   return entry->key[1] == len && (len == 0 || memcmp(&doc->text[entry->key[0]], key, len) == 0);
+}
+
+// the table of a big block, found by where its entries start
+static const uint32_t *raon_compact_block_slots(const struct raon_compact *doc, uint32_t first) {
+   size_t low = 0, high = doc->index_count;
+   while (low < high) {
+      const size_t mid = low + (high - low) / 2;
+      if (doc->indexes[mid].first_entry < first) {
+         low = mid + 1;
+      } else {
+         high = mid;
+      }
+   }
+   if (low == doc->index_count || doc->indexes[low].first_entry != first) {
+      return NULL;
+   }
+   return &doc->slots[doc->indexes[low].first_slot];
+}
+
+static struct raon_compact_value raon_compact_search(struct raon_compact_value block,
+    uint8_t key_type, const char *key, size_t len, intptr_t int_key) {
+   const struct raon_compact *doc = block.doc;
+   if (block.node.type != raon_value_type_block || block.node.child_type != key_type) {
+      return raon_compact_missing(doc);
+   }
+   const uint32_t first = block.node.payload[0];
+   const size_t count = block.node.payload[1];
+   const struct raon_compact_entry *entries = &doc->entries[first];
+
+   if (!raon_compact_is_indexed(count)) {
+      for (size_t i = 0; i < count; i++) {
+         if (raon_compact_key_matches(doc, &entries[i], key_type, key, len, int_key)) {
+            return (struct raon_compact_value) { .doc = doc, .node = entries[i].value };
+         }
+      }
+      return raon_compact_missing(doc);
+   }
+
+   const uint32_t *slots = raon_compact_block_slots(doc, first);
+   if (!slots) {
+      return raon_compact_missing(doc);
+   }
+   const size_t slot_count = raon_compact_slot_count(count);
+   const uint64_t hash
+       = key_type == raon_key_type_string ? raon_hash_bytes(key, len) : raon_hash_int(int_key);
+   for (size_t slot = hash;; slot++) {
+      slot &= slot_count - 1;
+      if (slots[slot] == 0) {
+         return raon_compact_missing(doc);
+      }
+      const struct raon_compact_entry *entry = &entries[slots[slot] - 1];
+      if (raon_compact_key_matches(doc, entry, key_type, key, len, int_key)) {
+         return (struct raon_compact_value) { .doc = doc, .node = entry->value };
+      }
+   }
+}
+
+struct raon_compact_value raon_compact_get(
+    struct raon_compact_value block, const char *key, size_t len) {
+   return raon_compact_search(block, raon_key_type_string, key, len, 0);
+}
+
+struct raon_compact_value raon_compact_get_int(struct raon_compact_value block, intptr_t key) {
+   return raon_compact_search(block, raon_key_type_num, NULL, 0, key);
+}
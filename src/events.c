@@ -0,0 +1,292 @@
+#include "raon.h"
+#include <stdbool.h>
+#include <stddef.h>
+
+// the event parser mirrors the recursive descent in parser.c, but keeps nothing but the C stack
+struct raon_event_parser {
+   struct raon_lexer lexer;
+   const struct raon_handler *handler;
+   enum raon_parse_status status;
+   // blocks and arrays that are open, capped so deep text can't overflow the stack
+   size_t depth;
+   // first error found, parsing stops right after it so it's never overwritten
+   struct raon_error error;
+};
+
+static bool raon_events_entry(
+    struct raon_event_parser *self, struct raon_token first_token, enum raon_key_type *key_type);
+static bool raon_events_value(
+    struct raon_event_parser *self, struct raon_token first_token, enum raon_value_type *type);
+
+// calls one of the callbacks that take no arguments
+static bool raon_events_emit(struct raon_event_parser *self, bool (*callback)(void *ctx)) {
+   if (callback && !callback(self->handler->ctx)) {
+      self->status = raon_parse_status_stopped;
+      return false;
+   }
+   return true;
+}
+
+static bool raon_events_fail(
+    struct raon_event_parser *self, struct raon_token token, enum raon_error_kind kind) {
+   self->error = (struct raon_error) { .kind = kind, .offset = token.start };
+   return false;
+}
+
+// a token that isn't allowed where it is, which says more about the error when it's malformed
+static bool raon_events_unexpected(struct raon_event_parser *self, struct raon_token token) {
+   switch (token.type) {
+   case raon_token_type_error:
+      return raon_events_fail(self, token, raon_error_kind_invalid_token);
+   case raon_token_type_eof:
+      return raon_events_fail(self, token, raon_error_kind_unexpected_end);
+   default:
+      return raon_events_fail(self, token, raon_error_kind_unexpected_token);
+   }
+}
+
+// called on the token that opens a block or an array, `depth` goes back down once it's closed
+static bool raon_events_descend(struct raon_event_parser *self, struct raon_token token) {
+   if (self->depth == RAON_EVENTS_MAX_DEPTH) {
+      return raon_events_fail(self, token, raon_error_kind_too_deep);
+   }
+   ++self->depth;
+   return true;
+}
+
+static bool raon_events_is_separator(struct raon_token token, enum raon_token_type end) {
+   return token.type == raon_token_type_newline || token.type == raon_token_type_comma
+       || token.type == end;
+}
+
+static bool raon_events_block(struct raon_event_parser *self) {
+   if (!raon_events_emit(self, self->handler->on_block_begin)) {
+      return false;
+   }
+
+   // the first key decides the key type of the whole block
+   enum raon_key_type block_key_type = raon_key_type_error;
+   for (;;) {
+      struct raon_token token = raon_lexer_eat(&self->lexer);
+      if (token.type == raon_token_type_block_close) {
+         break;
+      }
+      if (token.type == raon_token_type_newline) {
+         continue;
+      }
+
+      enum raon_key_type key_type;
+      if (!raon_events_entry(self, token, &key_type)) {
+         return false;
+      }
+      if (block_key_type != raon_key_type_error && key_type != block_key_type) {
+         return raon_events_fail(self, token, raon_error_kind_mixed_keys);
+      }
+      block_key_type = key_type;
+
+      token = raon_lexer_eat(&self->lexer);
+      if (!raon_events_is_separator(token, raon_token_type_block_close)) {
+         return raon_events_unexpected(self, token);
+      }
+      if (token.type == raon_token_type_block_close) {
+         break;
+      }
+   }
+
+   return raon_events_emit(self, self->handler->on_block_end);
+}
+
+static bool raon_events_array(struct raon_event_parser *self) {
+   if (!raon_events_emit(self, self->handler->on_array_begin)) {
+      return false;
+   }
+
+   // arrays are homogeneous, the first item decides the type of every other one
+   enum raon_value_type array_type = raon_value_type_error;
+   for (;;) {
+      struct raon_token token = raon_lexer_eat(&self->lexer);
+      if (token.type == raon_token_type_array_close) {
+         break;
+      }
+
+      enum raon_value_type type;
+      if (!raon_events_value(self, token, &type)) {
+         return false;
+      }
+      if (array_type != raon_value_type_error && type != array_type) {
+         return raon_events_fail(self, token, raon_error_kind_mixed_array);
+      }
+      array_type = type;
+
+      token = raon_lexer_eat(&self->lexer);
+      if (!raon_events_is_separator(token, raon_token_type_array_close)) {
+         return raon_events_unexpected(self, token);
+      }
+      if (token.type == raon_token_type_array_close) {
+         break;
+      }
+   }
+
+   return raon_events_emit(self, self->handler->on_array_end);
+}
+
+static bool raon_events_value(
+    struct raon_event_parser *self, struct raon_token first_token, enum raon_value_type *type) {
+   struct raon_value value = { 0 };
+   switch (first_token.type) {
+   case raon_token_type_string:
+      value.type = raon_value_type_string;
+      value.str_val = first_token.str_val;
+      break;
+
+   case raon_token_type_bool:
+      value.type = raon_value_type_bool;
+      value.bool_val = first_token.bool_val;
+      break;
+
+   case raon_token_type_float:
+      value.type = raon_value_type_float;
+      value.float_val = first_token.float_val;
+      break;
+
+   case raon_token_type_int:
+      value.type = raon_value_type_int;
+      value.int_val = first_token.int_val;
+      value.int_base = first_token.int_base;
+      break;
+
+   case raon_token_type_block_open: {
+      if (!raon_events_descend(self, first_token)) {
+         return false;
+      }
+      *type = raon_value_type_block;
+      const bool valid = raon_events_block(self);
+      --self->depth;
+      return valid;
+   }
+
+   case raon_token_type_array_open: {
+      if (!raon_events_descend(self, first_token)) {
+         return false;
+      }
+      *type = raon_value_type_array;
+      const bool valid = raon_events_array(self);
+      --self->depth;
+      return valid;
+   }
+
+   default:
+      return raon_events_unexpected(self, first_token);
+   }
+
+   *type = value.type;
+   if (self->handler->on_value && !self->handler->on_value(self->handler->ctx, value)) {
+      self->status = raon_parse_status_stopped;
+      return false;
+   }
+   return true;
+}
+
+static bool raon_events_entry(
+    struct raon_event_parser *self, struct raon_token first_token, enum raon_key_type *key_type) {
+   struct raon_key key = { 0 };
+   switch (first_token.type) {
+   case raon_token_type_key:
+   case raon_token_type_string:
+      key.type = raon_key_type_string;
+      key.str_key = first_token.str_val;
+      break;
+
+   case raon_token_type_int:
+      key.type = raon_key_type_num;
+      key.int_key = first_token.int_val;
+      break;
+
+   default:
+      return raon_events_unexpected(self, first_token);
+   }
+
+   *key_type = key.type;
+   if (self->handler->on_key && !self->handler->on_key(self->handler->ctx, key)) {
+      self->status = raon_parse_status_stopped;
+      return false;
+   }
+
+   struct raon_token token = raon_lexer_eat(&self->lexer);
+   // `<key>.<subkey>` is a block holding a single entry
+   if (token.type == raon_token_type_dot) {
+      if (!raon_events_descend(self, token)) {
+         return false;
+      }
+      enum raon_key_type sub_key_type;
+      const bool valid = raon_events_emit(self, self->handler->on_block_begin)
+          && raon_events_entry(self, raon_lexer_eat(&self->lexer), &sub_key_type)
+          && raon_events_emit(self, self->handler->on_block_end);
+      --self->depth;
+      return valid;
+   }
+   if (token.type != raon_token_type_equal) {
+      return raon_events_unexpected(self, token);
+   }
+
+   enum raon_value_type type;
+   return raon_events_value(self, raon_lexer_eat(&self->lexer), &type);
+}
+
+// parses every top-level entry of the lexer's text
+static enum raon_parse_status raon_events_document(struct raon_event_parser *self) {
+   enum raon_key_type top_level_key_type = raon_key_type_error;
+   for (;;) {
+      struct raon_token token = raon_lexer_eat(&self->lexer);
+      if (token.type == raon_token_type_eof) {
+         return raon_parse_status_ok;
+      }
+      if (token.type == raon_token_type_newline) {
+         continue;
+      }
+
+      enum raon_key_type key_type;
+      if (!raon_events_entry(self, token, &key_type)) {
+         return self->status;
+      }
+      if (top_level_key_type != raon_key_type_error && key_type != top_level_key_type) {
+         raon_events_fail(self, token, raon_error_kind_mixed_keys);
+         return raon_parse_status_error;
+      }
+      top_level_key_type = key_type;
+
+      token = raon_lexer_eat(&self->lexer);
+      if (token.type == raon_token_type_eof) {
+         return raon_parse_status_ok;
+      }
+      if (!raon_events_is_separator(token, raon_token_type_newline)) {
+         raon_events_unexpected(self, token);
+         return raon_parse_status_error;
+      }
+   }
+}
+
+enum raon_parse_status raon_parse_events(
+    char *str, size_t len, const struct raon_handler *handler) {
+   struct raon_event_parser self = {
+      .lexer = raon_lexer_init(str, len),
+      .handler = handler,
+      .status = raon_parse_status_error,
+   };
+   return raon_events_document(&self);
+}
+
+bool raon_validate(const char *str, size_t len, struct raon_error *error) {
+   // without callbacks nothing can stop the parser, so it either finishes or finds an error
+   static const struct raon_handler no_callbacks = { 0 };
+   struct raon_event_parser self = {
+      .lexer = raon_lexer_init((char *)str, len),
+      .handler = &no_callbacks,
+      .status = raon_parse_status_error,
+   };
+   const bool valid = raon_events_document(&self) == raon_parse_status_ok;
+   if (error) {
+      *error = self.error;
+   }
+   return valid;
+}
@@ -0,0 +1,183 @@
+// mmap, posix_madvise and friends are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "internal.h"
+#include "raon.h"
+#include <stdio.h>
+#include <stdlib.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+   #define RAON_FILE_MMAP
+   #include <fcntl.h>
+   #include <sys/mman.h>
+   #include <sys/stat.h>
+   #include <unistd.h>
+#endif
+
+#define RAON_FILE_CHUNK_SIZE (64 * 1024)
+
+// reads the whole stream in chunks through the incremental parser
+static struct raon_document *raon_parse_stream(FILE *file) {
+   char *chunk = malloc(RAON_FILE_CHUNK_SIZE);
+   if (!chunk) {
+      return NULL;
+   }
+
+   struct raon_parser parser = raon_parser_init();
+   size_t read = 0;
+   while ((read = fread(chunk, 1, RAON_FILE_CHUNK_SIZE, file)) > 0) {
+      if (!raon_parser_feed(&parser, chunk, read)) {
+         break;
+      }
+   }
+   free(chunk);
+
+   struct raon_document *doc = raon_parser_finish(&parser);
+   if (ferror(file)) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
+
+#ifdef RAON_FILE_MMAP
+
+struct raon_document *raon_parse_file(const char *path) {
+   const int fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return NULL;
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) != 0) {
+      close(fd);
+      return NULL;
+   }
+
+   // empty files can't be mapped, and pipes or character devices have no size to map
+   if (!S_ISREG(st.st_mode) || st.st_size == 0 || (uintmax_t)st.st_size > SIZE_MAX) {
+      FILE *file = fdopen(fd, "rb");
+      if (!file) {
+         close(fd);
+         return NULL;
+      }
+      struct raon_document *doc = raon_parse_stream(file);
+      fclose(file);
+      return doc;
+   }
+
+   const size_t len = (size_t)st.st_size;
+   void *mapping = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+   // the mapping stays valid after its file descriptor is closed
+   close(fd);
+   if (mapping == MAP_FAILED) {
+      return NULL;
+   }
+
+   // the parser reads the file front to back exactly once, so aggressive read-ahead pays off
+   posix_madvise(mapping, len, POSIX_MADV_SEQUENTIAL);
+   struct raon_document *doc = raon_parse_document(mapping, len);
+   if (!doc) {
+      munmap(mapping, len);
+      return NULL;
+   }
+   // strings are read in whatever order the caller looks them up from here on
+   posix_madvise(mapping, len, POSIX_MADV_NORMAL);
+
+   doc->mapping = mapping;
+   doc->mapping_len = len;
+   return doc;
+}
+
+void *raon_file_map(const char *path, size_t *len) {
+   const int fd = open(path, O_RDONLY);
+   if (fd < 0) {
+      return NULL;
+   }
+
+   struct stat st;
+   if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size == 0
+       || (uintmax_t)st.st_size > SIZE_MAX) {
+      close(fd);
+      return NULL;
+   }
+
+   void *mapping = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+   if (mapping == MAP_FAILED) {
+      return NULL;
+   }
+   *len = (size_t)st.st_size;
+   return mapping;
+}
+
+void raon_file_unmap(void *mapping, size_t len) { munmap(mapping, len); }
+
+void raon_file_prefetch(const char *path) {
+#ifdef POSIX_FADV_WILLNEED
+   const int fd = open(path, O_RDONLY);
+   if (fd >= 0) {
+      // the read-ahead keeps going after the file descriptor is closed
+      posix_fadvise(fd, 0, 0, POSIX_FADV_WILLNEED);
+      close(fd);
+   }
+#else
+   (void)path;
+#endif
+}
+
+#else
+
+struct raon_document *raon_parse_file(const char *path) {
+   FILE *file = fopen(path, "rb");
+   if (!file) {
+      return NULL;
+   }
+   struct raon_document *doc = raon_parse_stream(file);
+   fclose(file);
+   return doc;
+}
+
+// without mmap the whole file is read into memory instead
+void *raon_file_map(const char *path, size_t *len) {
+   FILE *file = fopen(path, "rb");
+   if (!file) {
+      return NULL;
+   }
+   char *data = NULL;
+   size_t used = 0;
+   size_t capacity = 0;
+   for (;;) {
+      if (used == capacity) {
+         capacity = capacity ? capacity * 2 : RAON_FILE_CHUNK_SIZE;
+         char *tmp = realloc(data, capacity);
+         if (!tmp) {
+            break;
+         }
+         data = tmp;
+      }
+      const size_t read = fread(&data[used], 1, capacity - used, file);
+      used += read;
+      if (read == 0) {
+         break;
+      }
+   }
+   const bool failed = ferror(file) || !feof(file) || used == 0;
+   fclose(file);
+   if (failed) {
+      free(data);
+      return NULL;
+   }
+   *len = used;
+   return data;
+}
+
+// `raon_parse_file` never keeps a mapping without mmap, so this only frees `raon_file_map`'s copy
+void raon_file_unmap(void *mapping, size_t len) {
+   (void)len;
+   free(mapping);
+}
+
+void raon_file_prefetch(const char *path) { (void)path; }
+
+#endif
@@ -0,0 +1,525 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdlib.h>
+#include <string.h>
+
+/*
+   Layout, every number is little endian and every offset is from the start of the snapshot:
+
+   snapshot = "RAONFRZ" version:u8 data* root:cell
+   cell     = tag:u8 int_base:u8 pad:u16 len:u32 payload:u64
+   block    = key_tag:u32 count:u32 (key:cell value:cell)*count slot:u32*slot_count pad
+   array    = cell*count
+   string   = bytes NUL pad
+
+   Ints, floats and bools live in the payload of their cell. Strings, blocks and arrays store their
+   offset in it and their length or count in `len`. Keys are cells too.
+   Children are always written before their parent so the root cell ends up last.
+
+   The slots are an open addressing hash table with linear probing that maps keys to the position
+   of their first occurrence plus one, 0 is an empty slot. There are twice as many slots as entries
+   rounded up to a power of two, and keys are hashed with FNV-1a or a 64-bit integer mix.
+*/
+
+#define RAON_FROZEN_MAGIC "RAONFRZ"
+#define RAON_FROZEN_VERSION 1
+#define RAON_FROZEN_HEADER_SIZE 8
+#define RAON_FROZEN_CELL_SIZE 16
+#define RAON_FROZEN_BLOCK_HEADER_SIZE 8
+#define RAON_FROZEN_ENTRY_SIZE (2 * RAON_FROZEN_CELL_SIZE)
+// keeps the slots of the biggest block addressable with 32 bits
+#define RAON_FROZEN_MAX_ENTRIES (UINT32_MAX / 8)
+
+enum raon_frozen_tag {
+   raon_frozen_tag_string = 1,
+   raon_frozen_tag_int,
+   raon_frozen_tag_float,
+   raon_frozen_tag_bool,
+   raon_frozen_tag_block,
+   raon_frozen_tag_array,
+};
+
+static uint32_t raon_frozen_load32(const char *ptr) {
+   const unsigned char *bytes = (const unsigned char *)ptr;
+   return (uint32_t)bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16
+        | (uint32_t)bytes[3] << 24;
+}
+
+static uint64_t raon_frozen_load64(const char *ptr) {
+   return raon_frozen_load32(ptr) | (uint64_t)raon_frozen_load32(ptr + 4) << 32;
+}
+
+static void raon_frozen_store32(char *ptr, uint32_t value) {
+   for (size_t i = 0; i < 4; i++) {
+      ptr[i] = (char)(value >> (i * 8));
+   }
+}
+
+static void raon_frozen_store64(char *ptr, uint64_t value) {
+   raon_frozen_store32(ptr, (uint32_t)value);
+   raon_frozen_store32(ptr + 4, (uint32_t)(value >> 32));
+}
+
+static uint64_t raon_frozen_slot_count(uint64_t count) {
+   uint64_t slots = 1;
+   while (slots < count * 2) {
+      slots *= 2;
+   }
+   return slots;
+}
+
+// the hashes are part of the format, so they can't depend on the platform or the build
+static uint64_t raon_frozen_hash_str(const char *str, size_t len) {
+   uint64_t hash = 14695981039346656037u;
+   for (size_t i = 0; i < len; i++) {
+      hash ^= (unsigned char)str[i];
+      hash *= 1099511628211u;
+   }
+   return hash;
+}
+
+static uint64_t raon_frozen_hash_int(intptr_t key) {
+   uint64_t hash = (uint64_t)key;
+   hash = (hash ^ (hash >> 30)) * 0xBF58476D1CE4E5B9u;
+   hash = (hash ^ (hash >> 27)) * 0x94D049BB133111EBu;
+   return hash ^ (hash >> 31);
+}
+
+// === Freezing ===
+
+struct raon_freezer {
+   struct raon_writer writer;
+   // bytes written so far, which is the offset of whatever is written next
+   uint64_t pos;
+};
+
+static void raon_freezer_put(struct raon_freezer *self, const char *data, size_t len) {
+   raon_writer_put(&self->writer, data, len);
+   self->pos += len;
+}
+
+static void raon_freezer_pad(struct raon_freezer *self) {
+   static const char zeros[8] = { 0 };
+   raon_freezer_put(self, zeros, (8 - self->pos % 8) % 8);
+}
+
+static void raon_freezer_cell(char *cell, enum raon_frozen_tag tag, uint8_t int_base,
+    uint32_t len, uint64_t payload) {
+   cell[0] = (char)tag;
+   cell[1] = (char)int_base;
+   cell[2] = cell[3] = 0;
+   raon_frozen_store32(&cell[4], len);
+   raon_frozen_store64(&cell[8], payload);
+}
+
+static bool raon_freezer_string(struct raon_freezer *self, struct raon_str_slice str, char *cell) {
+   if (str.len > UINT32_MAX) {
+      return false;
+   }
+   raon_freezer_cell(cell, raon_frozen_tag_string, 0, (uint32_t)str.len, self->pos);
+   raon_freezer_put(self, str.ptr, str.len);
+   raon_freezer_put(self, "", 1);
+   raon_freezer_pad(self);
+   return true;
+}
+
+static bool raon_freezer_block(
+    struct raon_freezer *self, const struct vector_of_raon_entry *entries, char *cell);
+static bool raon_freezer_array(
+    struct raon_freezer *self, const struct vector_of_raon_value *values, char *cell);
+
+// writes whatever the value points to and fills in its cell
+static bool raon_freezer_value(struct raon_freezer *self, struct raon_value value, char *cell) {
+   if (value.lazy) {
+      return false;
+   }
+   switch (value.type) {
+   case raon_value_type_string:
+      return raon_freezer_string(self, value.str_val, cell);
+
+   case raon_value_type_int:
+      raon_freezer_cell(cell, raon_frozen_tag_int, value.int_base, 0, (uint64_t)value.int_val);
+      return true;
+
+   case raon_value_type_float: {
+      uint64_t bits;
+      memcpy(&bits, &value.float_val, sizeof(bits));
+      raon_freezer_cell(cell, raon_frozen_tag_float, 0, 0, bits);
+      return true;
+   }
+
+   case raon_value_type_bool:
+      raon_freezer_cell(cell, raon_frozen_tag_bool, 0, 0, value.bool_val);
+      return true;
+
+   case raon_value_type_block:
+      return raon_freezer_block(self, value.block_val, cell);
+
+   case raon_value_type_array:
+      return raon_freezer_array(self, value.array_val, cell);
+
+   case raon_value_type_error:
+      break;
+   }
+   return false;
+}
+
+static bool raon_freezer_same_key(const struct raon_entry *a, const struct raon_entry *b) {
+   if (a->key_type == raon_key_type_string) {
+      return a->str_key.len == b->str_key.len
+          && (a->str_key.len == 0 || memcmp(a->str_key.ptr, b->str_key.ptr, a->str_key.len) == 0);
+   }
+   return a->int_key == b->int_key;
+}
+
+// fills in the slots of a block's hash table, later duplicates of a key are left out of it
+static void raon_freezer_slots(
+    const struct vector_of_raon_entry *entries, char *slots, uint64_t slot_count) {
+   memset(slots, 0, slot_count * 4);
+   for (size_t i = 0; entries && i < entries->len; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      uint64_t slot = entry->key_type == raon_key_type_string
+          ? raon_frozen_hash_str(entry->str_key.ptr, entry->str_key.len)
+          : raon_frozen_hash_int(entry->int_key);
+      for (;; slot++) {
+         slot &= slot_count - 1;
+         const uint32_t taken = raon_frozen_load32(&slots[slot * 4]);
+         if (taken == 0) {
+            raon_frozen_store32(&slots[slot * 4], (uint32_t)i + 1);
+            break;
+         }
+         if (raon_freezer_same_key(&entries->vec[taken - 1], entry)) {
+            break;
+         }
+      }
+   }
+}
+
+static bool raon_freezer_block(
+    struct raon_freezer *self, const struct vector_of_raon_entry *entries, char *cell) {
+   const size_t count = entries ? entries->len : 0;
+   if (count > RAON_FROZEN_MAX_ENTRIES) {
+      return false;
+   }
+
+   // the table can only be written once every child has been, so it's assembled on the side
+   const uint64_t slot_count = raon_frozen_slot_count(count);
+   const size_t entries_size = RAON_FROZEN_BLOCK_HEADER_SIZE + count * RAON_FROZEN_ENTRY_SIZE;
+   const size_t table_size = entries_size + slot_count * 4;
+   char *table = malloc(table_size);
+   bool success = table != NULL;
+
+   const enum raon_key_type key_type = count ? entries->vec[0].key_type : raon_key_type_string;
+   for (size_t i = 0; i < count && success; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      char *key_cell = &table[RAON_FROZEN_BLOCK_HEADER_SIZE + i * RAON_FROZEN_ENTRY_SIZE];
+      if (entry->key_type != key_type) {
+         success = false;
+      } else if (key_type == raon_key_type_string) {
+         success = raon_freezer_string(self, entry->str_key, key_cell);
+      } else if (key_type == raon_key_type_num) {
+         raon_freezer_cell(key_cell, raon_frozen_tag_int, 0, 0, (uint64_t)entry->int_key);
+      } else {
+         success = false;
+      }
+      success = success
+             && raon_freezer_value(self, entry->value, key_cell + RAON_FROZEN_CELL_SIZE);
+   }
+
+   if (success) {
+      raon_frozen_store32(table,
+          key_type == raon_key_type_string ? raon_frozen_tag_string : raon_frozen_tag_int);
+      raon_frozen_store32(&table[4], (uint32_t)count);
+      raon_freezer_slots(entries, &table[entries_size], slot_count);
+
+      raon_freezer_cell(cell, raon_frozen_tag_block, 0, (uint32_t)count, self->pos);
+      raon_freezer_put(self, table, table_size);
+      raon_freezer_pad(self);
+   }
+
+   free(table);
+   return success;
+}
+
+static bool raon_freezer_array(
+    struct raon_freezer *self, const struct vector_of_raon_value *values, char *cell) {
+   const size_t count = raon_array_len(values);
+   if (count > UINT32_MAX / RAON_FROZEN_CELL_SIZE) {
+      return false;
+   }
+
+   char *cells = malloc(count ? count * RAON_FROZEN_CELL_SIZE : 1);
+   bool success = cells != NULL;
+   const enum raon_value_type type = count ? raon_array_get(values, 0).type : raon_value_type_error;
+   for (size_t i = 0; i < count && success; i++) {
+      const struct raon_value item = raon_array_get(values, i);
+      success = item.type == type
+             && raon_freezer_value(self, item, &cells[i * RAON_FROZEN_CELL_SIZE]);
+   }
+
+   if (success) {
+      raon_freezer_cell(cell, raon_frozen_tag_array, 0, (uint32_t)count, self->pos);
+      raon_freezer_put(self, cells, count * RAON_FROZEN_CELL_SIZE);
+   }
+   free(cells);
+   return success;
+}
+
+bool raon_freeze(const struct vector_of_raon_entry *entries, struct raon_sink sink) {
+   struct raon_freezer *self = malloc(sizeof(*self));
+   if (!self) {
+      return false;
+   }
+   raon_writer_init(&self->writer, sink, (struct raon_write_options) { 0 });
+   self->pos = 0;
+
+   const char header[RAON_FROZEN_HEADER_SIZE] = RAON_FROZEN_MAGIC "\x01";
+   raon_freezer_put(self, header, sizeof(header));
+   char root[RAON_FROZEN_CELL_SIZE];
+   if (raon_freezer_block(self, entries, root)) {
+      raon_freezer_put(self, root, sizeof(root));
+   } else {
+      self->writer.failed = true;
+   }
+   raon_writer_flush(&self->writer);
+
+   const bool success = !self->writer.failed;
+   free(self);
+   return success;
+}
+
+// === Reading ===
+
+bool raon_frozen_init(struct raon_frozen *self, const char *data, size_t len) {
+   *self = (struct raon_frozen) { 0 };
+   if (len < RAON_FROZEN_HEADER_SIZE + RAON_FROZEN_CELL_SIZE
+       || memcmp(data, RAON_FROZEN_MAGIC, strlen(RAON_FROZEN_MAGIC)) != 0
+       || (uint8_t)data[strlen(RAON_FROZEN_MAGIC)] != RAON_FROZEN_VERSION
+       || data[len - RAON_FROZEN_CELL_SIZE] != raon_frozen_tag_block) {
+      return false;
+   }
+   self->data = data;
+   self->len = len;
+   return true;
+}
+
+bool raon_frozen_open(struct raon_frozen *self, const char *path) {
+   size_t len;
+   void *mapping = raon_file_map(path, &len);
+   if (!mapping) {
+      *self = (struct raon_frozen) { 0 };
+      return false;
+   }
+   if (!raon_frozen_init(self, mapping, len)) {
+      raon_file_unmap(mapping, len);
+      return false;
+   }
+   self->mapping = mapping;
+   return true;
+}
+
+void raon_frozen_close(struct raon_frozen *self) {
+   if (self->mapping) {
+      raon_file_unmap(self->mapping, self->len);
+   }
+   *self = (struct raon_frozen) { 0 };
+}
+
+struct raon_frozen_value raon_frozen_root(const struct raon_frozen *self) {
+   if (!self->data) {
+      return (struct raon_frozen_value) { 0 };
+   }
+   return (struct raon_frozen_value) {
+      .snapshot = self,
+      .cell = &self->data[self->len - RAON_FROZEN_CELL_SIZE],
+   };
+}
+
+// returns the data a cell points to if `size` bytes of it are inside of the snapshot
+static const char *raon_frozen_data(struct raon_frozen_value value, uint64_t size) {
+   const uint64_t offset = raon_frozen_load64(&value.cell[8]);
+   const size_t len = value.snapshot->len;
+   if (offset > len || size > len - offset) {
+      return NULL;
+   }
+   return &value.snapshot->data[offset];
+}
+
+// the table of a block, NULL if the value isn't a block or its table is out of bounds
+static const char *raon_frozen_block(struct raon_frozen_value value, uint32_t *count) {
+   if (!value.cell || value.cell[0] != raon_frozen_tag_block) {
+      return NULL;
+   }
+   *count = raon_frozen_load32(&value.cell[4]);
+   if (*count > RAON_FROZEN_MAX_ENTRIES) {
+      return NULL;
+   }
+   return raon_frozen_data(value, RAON_FROZEN_BLOCK_HEADER_SIZE
+           + (uint64_t)*count * RAON_FROZEN_ENTRY_SIZE + raon_frozen_slot_count(*count) * 4);
+}
+
+enum raon_value_type raon_frozen_type(struct raon_frozen_value value) {
+   if (!value.cell) {
+      return raon_value_type_error;
+   }
+   switch ((enum raon_frozen_tag)value.cell[0]) {
+   case raon_frozen_tag_string:
+      return raon_value_type_string;
+   case raon_frozen_tag_int:
+      return raon_value_type_int;
+   case raon_frozen_tag_float:
+      return raon_value_type_float;
+   case raon_frozen_tag_bool:
+      return raon_value_type_bool;
+   case raon_frozen_tag_block:
+      return raon_value_type_block;
+   case raon_frozen_tag_array:
+      return raon_value_type_array;
+   }
+   return raon_value_type_error;
+}
+
+intptr_t raon_frozen_int(struct raon_frozen_value value) {
+   if (!value.cell || value.cell[0] != raon_frozen_tag_int) {
+      return 0;
+   }
+   return (intptr_t)raon_frozen_load64(&value.cell[8]);
+}
+
+uint8_t raon_frozen_int_base(struct raon_frozen_value value) {
+   return value.cell && value.cell[0] == raon_frozen_tag_int ? (uint8_t)value.cell[1] : 0;
+}
+
+double raon_frozen_float(struct raon_frozen_value value) {
+   if (!value.cell || value.cell[0] != raon_frozen_tag_float) {
+      return 0.0;
+   }
+   const uint64_t bits = raon_frozen_load64(&value.cell[8]);
+   double result;
+   memcpy(&result, &bits, sizeof(result));
+   return result;
+}
+
+bool raon_frozen_bool(struct raon_frozen_value value) {
+   return value.cell && value.cell[0] == raon_frozen_tag_bool
+       && raon_frozen_load64(&value.cell[8]) != 0;
+}
+
+struct raon_str_slice raon_frozen_string(struct raon_frozen_value value) {
+   if (!value.cell || value.cell[0] != raon_frozen_tag_string) {
+      return (struct raon_str_slice) { 0 };
+   }
+   const uint32_t len = raon_frozen_load32(&value.cell[4]);
+   const char *data = raon_frozen_data(value, (uint64_t)len + 1);
+   if (!data) {
+      return (struct raon_str_slice) { 0 };
+   }
+   return (struct raon_str_slice) { .ptr = (char *)data, .len = len };
+}
+
+size_t raon_frozen_len(struct raon_frozen_value value) {
+   if (!value.cell
+       || (value.cell[0] != raon_frozen_tag_block && value.cell[0] != raon_frozen_tag_array)) {
+      return 0;
+   }
+   return raon_frozen_load32(&value.cell[4]);
+}
+
+// the key or value cell of a block's entry
+static struct raon_frozen_value raon_frozen_entry_cell(
+    struct raon_frozen_value block, const char *table, size_t index, bool value) {
+   return (struct raon_frozen_value) {
+      .snapshot = block.snapshot,
+      .cell = &table[RAON_FROZEN_BLOCK_HEADER_SIZE + index * RAON_FROZEN_ENTRY_SIZE
+          + value * RAON_FROZEN_CELL_SIZE],
+   };
+}
+
+struct raon_frozen_value raon_frozen_at(struct raon_frozen_value value, size_t index) {
+   uint32_t count;
+   const char *table = raon_frozen_block(value, &count);
+   if (table) {
+      return index < count ? raon_frozen_entry_cell(value, table, index, true)
+                           : (struct raon_frozen_value) { 0 };
+   }
+
+   if (!value.cell || value.cell[0] != raon_frozen_tag_array) {
+      return (struct raon_frozen_value) { 0 };
+   }
+   count = raon_frozen_load32(&value.cell[4]);
+   const char *cells = raon_frozen_data(value, (uint64_t)count * RAON_FROZEN_CELL_SIZE);
+   if (!cells || index >= count) {
+      return (struct raon_frozen_value) { 0 };
+   }
+   return (struct raon_frozen_value) {
+      .snapshot = value.snapshot,
+      .cell = &cells[index * RAON_FROZEN_CELL_SIZE],
+   };
+}
+
+struct raon_key raon_frozen_key_at(struct raon_frozen_value block, size_t index) {
+   uint32_t count;
+   const char *table = raon_frozen_block(block, &count);
+   if (!table || index >= count) {
+      return (struct raon_key) { .type = raon_key_type_error };
+   }
+   const struct raon_frozen_value key = raon_frozen_entry_cell(block, table, index, false);
+   if (key.cell[0] == raon_frozen_tag_int) {
+      return (struct raon_key) { .type = raon_key_type_num, .int_key = raon_frozen_int(key) };
+   }
+   const struct raon_str_slice str = raon_frozen_string(key);
+   if (!str.ptr) {
+      return (struct raon_key) { .type = raon_key_type_error };
+   }
+   return (struct raon_key) { .type = raon_key_type_string, .str_key = str };
+}
+
+/*
+   Probes a block's hash table for a key. `matches` compares the key of an entry with the one
+   looked for.
+*/
+static struct raon_frozen_value raon_frozen_search(struct raon_frozen_value block,
+    enum raon_frozen_tag key_tag, uint64_t hash,
+    bool (*matches)(struct raon_key key, const void *ctx), const void *ctx) {
+   uint32_t count;
+   const char *table = raon_frozen_block(block, &count);
+   if (!table || count == 0 || raon_frozen_load32(table) != key_tag) {
+      return (struct raon_frozen_value) { 0 };
+   }
+   const char *slots = &table[RAON_FROZEN_BLOCK_HEADER_SIZE + count * RAON_FROZEN_ENTRY_SIZE];
+   const uint64_t slot_count = raon_frozen_slot_count(count);
+
+   // a corrupted table could be full, so probing stops after visiting every slot
+   for (uint64_t i = 0; i < slot_count; i++) {
+      const uint32_t taken = raon_frozen_load32(&slots[((hash + i) & (slot_count - 1)) * 4]);
+      if (taken == 0 || taken > count) {
+         break;
+      }
+      if (matches(raon_frozen_key_at(block, taken - 1), ctx)) {
+         return raon_frozen_entry_cell(block, table, taken - 1, true);
+      }
+   }
+   return (struct raon_frozen_value) { 0 };
+}
+
+static bool raon_frozen_matches_str(struct raon_key key, const void *ctx) {
+   const struct raon_str_slice *wanted = ctx;
+   return key.type == raon_key_type_string && key.str_key.len == wanted->len
+       && (wanted->len == 0 || memcmp(key.str_key.ptr, wanted->ptr, wanted->len) == 0);
+}
+
+static bool raon_frozen_matches_int(struct raon_key key, const void *ctx) {
+   return key.type == raon_key_type_num && key.int_key == *(const intptr_t *)ctx;
+}
+
+struct raon_frozen_value raon_frozen_get(
+    struct raon_frozen_value block, const char *key, size_t len) {
+   const struct raon_str_slice wanted = { .ptr = (char *)key, .len = len };
+   return raon_frozen_search(block, raon_frozen_tag_string, raon_frozen_hash_str(key, len),
+       raon_frozen_matches_str, &wanted);
+}
+
+struct raon_frozen_value raon_frozen_get_int(struct raon_frozen_value block, intptr_t key) {
+   return raon_frozen_search(
+       block, raon_frozen_tag_int, raon_frozen_hash_int(key), raon_frozen_matches_int, &key);
+}
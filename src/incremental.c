@@ -0,0 +1,170 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define RAON_PARSER_MIN_PENDING_CAPACITY 4096
+
+struct raon_parser raon_parser_init(void) {
+   return (struct raon_parser) { 0 };
+}
+
+/*
+   Walks the chunk the way the lexer would, just enough to know where top-level entries end, which
+   is at a newline or a comma outside of any block, array, string or comment.
+
+   Returns: the index right after the last entry that ended in the chunk, or 0 if none did
+*/
+static size_t raon_parser_scan(struct raon_parser *self, const char *chunk, size_t len) {
+   size_t boundary = 0;
+   size_t idx = 0;
+   while (idx < len) {
+      if (self->in_string) {
+         const size_t end = idx + raon_scan_find2(&chunk[idx], len - idx, '"', '"');
+         if (end == len) {
+            break;
+         }
+         self->in_string = false;
+         idx = end + 1;
+         continue;
+      }
+
+      if (self->in_comment) {
+         // the newline that ends the comment is left for the switch below, it still ends the entry
+         idx += raon_scan_find2(&chunk[idx], len - idx, '\n', '\n');
+         if (idx == len) {
+            break;
+         }
+         self->in_comment = false;
+         continue;
+      }
+
+      switch (chunk[idx++]) {
+      case '"':
+         self->in_string = true;
+         break;
+
+      case '#':
+         self->in_comment = true;
+         break;
+
+      case '{':
+      case '[':
+         ++self->depth;
+         break;
+
+      case '}':
+      case ']':
+         // unbalanced closes are left for the parser to reject
+         if (self->depth) {
+            --self->depth;
+         }
+         break;
+
+      case '\n':
+      case ',':
+         if (self->depth == 0) {
+            boundary = idx;
+         }
+         break;
+      }
+   }
+   return boundary;
+}
+
+// parses the pending text followed by `chunk`, which together hold nothing but complete entries
+static bool raon_parser_parse_segment(
+    struct raon_parser *self, const char *chunk, size_t chunk_len) {
+   // slices in the entries point into the segment, so it's kept alive by the document's arena
+   const size_t len = self->pending_len + chunk_len;
+   char *segment = raon_arena_alloc(&self->doc->arena, len);
+   if (!segment) {
+      return false;
+   }
+   if (self->pending_len) {
+      memcpy(segment, self->pending, self->pending_len);
+   }
+   // a big entry only grows the buffer for as long as it's incomplete
+   if (self->pending_capacity > RAON_PARSER_MIN_PENDING_CAPACITY) {
+      free(self->pending);
+      self->pending = NULL;
+      self->pending_capacity = 0;
+   }
+   if (chunk_len) {
+      memcpy(&segment[self->pending_len], chunk, chunk_len);
+   }
+
+   struct raon_lexer lexer = raon_lexer_init(segment, len);
+   self->pending_len = 0;
+   return raon_parse_entries_into(
+       raon_arena_allocator(&self->doc->arena), &lexer, self->doc->entries, true);
+}
+
+static bool raon_parser_buffer(struct raon_parser *self, const char *chunk, size_t len) {
+   if (self->pending_len + len > self->pending_capacity) {
+      size_t capacity = self->pending_capacity ? self->pending_capacity
+                                               : RAON_PARSER_MIN_PENDING_CAPACITY;
+      while (capacity < self->pending_len + len) {
+         capacity *= 2;
+      }
+      char *pending = realloc(self->pending, capacity);
+      if (!pending) {
+         return false;
+      }
+      self->pending = pending;
+      self->pending_capacity = capacity;
+   }
+   if (len) {
+      memcpy(&self->pending[self->pending_len], chunk, len);
+   }
+   self->pending_len += len;
+   return true;
+}
+
+bool raon_parser_feed(struct raon_parser *self, const char *chunk, size_t len) {
+   if (self->failed) {
+      return false;
+   }
+   if (!self->doc && !(self->doc = raon_document_new(0))) {
+      self->failed = true;
+      return false;
+   }
+
+   // everything up to the last entry that ends in this chunk is parsed right away
+   const size_t boundary = raon_parser_scan(self, chunk, len);
+   if (boundary && !raon_parser_parse_segment(self, chunk, boundary)) {
+      self->failed = true;
+      return false;
+   }
+
+   if (!raon_parser_buffer(self, &chunk[boundary], len - boundary)) {
+      self->failed = true;
+      return false;
+   }
+   return true;
+}
+
+struct raon_document *raon_parser_finish(struct raon_parser *self) {
+   bool success = !self->failed;
+   if (success && !self->doc) {
+      self->doc = raon_document_new(0);
+      success = self->doc != NULL;
+   }
+   // the last entry doesn't need a separator after it
+   if (success && self->pending_len) {
+      success = raon_parser_parse_segment(self, NULL, 0);
+   }
+   if (success) {
+      success = raon_finish_top_level(self->doc->entries);
+   }
+
+   struct raon_document *doc = self->doc;
+   free(self->pending);
+   *self = raon_parser_init();
+
+   if (!success) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
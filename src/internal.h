@@ -0,0 +1,210 @@
+#ifndef RAON_INTERNAL_H
+#define RAON_INTERNAL_H
+
+// Helpers shared between the library's translation units, they're not part of the public API.
+
+#include "raon.h"
+#include <stddef.h>
+#include <stdint.h>
+
+// === Character Classes ===
+
+enum raon_char_class {
+   // whitespace other than newlines, which are tokens
+   raon_char_class_blank = 1 << 0,
+   raon_char_class_ident_start = 1 << 1,
+   raon_char_class_ident = 1 << 2,
+   raon_char_class_digit = 1 << 3,
+   // anything that can show up after the start of a number literal
+   raon_char_class_num = 1 << 4,
+   // bytes that start or end a string, comment, block, array or entry, and the NUL that ends input
+   raon_char_class_structural = 1 << 5,
+};
+
+// `raon_char_class` flags of every byte, classification doesn't depend on the locale
+extern const uint8_t raon_char_classes[256];
+
+static inline bool raon_char_is(char c, enum raon_char_class char_class) {
+   return raon_char_classes[(unsigned char)c] & char_class;
+}
+
+// === Lexer ===
+
+/*
+   Skips over the rest of a block or array whose opening bracket was just eaten, without lexing what
+   is inside of it. Only strings and comments are looked into, so that their brackets don't count.
+
+   Returns: false if the input ends before the matching bracket, `text` is set to the whole value
+   including its brackets otherwise
+
+   Note: a bracket of the wrong kind is matched all the same, parsing the text later rejects it.
+*/
+bool raon_lexer_skip_nested(struct raon_lexer *self, struct raon_str_slice *text);
+
+// === Parser ===
+
+/*
+   Parses top-level entries until the end of the lexer's input and appends them to `entries`.
+
+   Inputs:
+   - `check_keys`: whether entries go through `raon_push_entry`, otherwise they're appended as they
+   are and checking their keys is left to the caller
+
+   Returns: false if parsing failed, the entries pushed up to that point are left in `entries`
+*/
+bool raon_parse_entries_into(struct vec_allocator allocator, struct raon_lexer *lexer,
+    struct vector_of_raon_entry *entries, bool check_keys);
+
+/*
+   Appends an entry to a block, merging it into an earlier block under the same key.
+
+   Returns: false if the key's type doesn't match the block's or the key is already taken
+*/
+bool raon_push_entry(struct vector_of_raon_entry *entries, struct raon_entry entry);
+
+// Indexes the top level once every entry is in if it's big enough.
+bool raon_finish_top_level(struct vector_of_raon_entry *entries);
+
+/*
+   Hashes of the keys of block indexes, they're only meant for in-memory tables since they depend
+   on the platform's byte order.
+*/
+uint64_t raon_hash_bytes(const char *str, size_t len);
+uint64_t raon_hash_int(intptr_t key);
+
+/*
+   Indexes `block` and tells whether all of its keys are different.
+
+   Returns: false if a key repeats or the index couldn't be allocated
+*/
+bool raon_block_keys_unique(struct vector_of_raon_entry *block);
+
+/*
+   Appends an item to an array. Ints, floats and bools are packed for as long as the array holds
+   nothing else, an int written in another base than the packed ones gives every int its own base.
+
+   Inputs:
+   - `size_hint`: number of items the array is expected to end up with, it's only used to size
+   the first allocation
+
+   Returns: false if allocation failed
+
+   Note: the item's type isn't checked against the array's, that's up to the caller.
+*/
+bool raon_array_push(struct vector_of_raon_value *array, struct raon_value item, size_t size_hint);
+
+// Frees the packed items of an array, if it has any.
+void raon_packed_free(struct vector_of_raon_value *array);
+
+/*
+   Creates an empty document with its entries vector allocated in the document's arena.
+
+   Inputs:
+   - `text_len`: size of the text that will be parsed into it, or 0 if it isn't known yet
+*/
+struct raon_document *raon_document_new(size_t text_len);
+
+/*
+   Maps a whole regular file read-only, where mmap isn't available it's read into memory instead.
+
+   Returns: NULL if the file couldn't be opened, isn't a regular file or is empty
+*/
+void *raon_file_map(const char *path, size_t *len);
+
+// Releases a mapping made by `raon_parse_file` or `raon_file_map`.
+void raon_file_unmap(void *mapping, size_t len);
+
+// Asks the OS to start reading a file in the background, where that's supported.
+void raon_file_prefetch(const char *path);
+
+// === Numbers ===
+
+// exponents are clamped at this size while being read, anything past it is 0 or infinity anyway
+#define RAON_FLOAT_EXPONENT_LIMIT 100000
+
+/*
+   Converts `mantissa * 10^exp10` to the closest double.
+   `truncated` means that nonzero digits that didn't fit in `mantissa` were dropped.
+
+   Returns: false if the dropped digits decide the rounding, the literal then has to be converted
+   with `raon_float_from_literal`
+*/
+bool raon_float_from_decimal(uint64_t mantissa, int64_t exp10, bool truncated, double *out);
+
+/*
+   Slow path for float literals that looks at every digit, `str` may contain `_` separators.
+   It doesn't allocate.
+*/
+double raon_float_from_literal(const char *str, size_t len);
+
+// longest output of `raon_format_float`, enough for its sign, digits, point and exponent
+#define RAON_FORMAT_FLOAT_MAX 32
+
+/*
+   Writes the shortest decimal that parses back to exactly `value`, it always has a `.` or an
+   exponent so that it's read back as a float.
+
+   Note: `value` has to be finite and `buf` at least `RAON_FORMAT_FLOAT_MAX` bytes long.
+*/
+size_t raon_format_float(double value, char *buf);
+
+// Writes `value` in base 2, 8, 10 or 16 without any prefix, `buf` needs up to 64 bytes.
+size_t raon_format_uint(uint64_t value, unsigned base, char *buf);
+
+// === Writer ===
+
+#define RAON_WRITER_BUFFER_SIZE (16 * 1024)
+
+// Buffers output in front of a sink, shared by the text and binary encoders.
+struct raon_writer {
+   struct raon_sink sink;
+   bool compact;
+   bool keep_int_base;
+   const char *indent;
+   size_t indent_len;
+   // set once the sink fails or something can't be written, everything after it is dropped
+   bool failed;
+   size_t len;
+   char buf[RAON_WRITER_BUFFER_SIZE];
+};
+
+void raon_writer_init(
+    struct raon_writer *self, struct raon_sink sink, struct raon_write_options options);
+void raon_writer_flush(struct raon_writer *self);
+void raon_writer_put(struct raon_writer *self, const char *data, size_t len);
+
+// === Scanning ===
+
+enum raon_scan_level {
+   // pick the best implementation the CPU supports
+   raon_scan_level_auto,
+   raon_scan_level_scalar,
+   raon_scan_level_sse2,
+   raon_scan_level_avx2,
+};
+
+/*
+   Overrides the runtime CPU detection, used by tests and benchmarks to compare implementations.
+   Levels the CPU doesn't support fall back to the best supported one.
+*/
+void raon_scan_force_level(enum raon_scan_level level);
+
+// Returns the implementation that the scanning functions currently dispatch to.
+enum raon_scan_level raon_scan_active_level(void);
+
+// Returns the index of the first `a` or `b` in `str`, or `len` if there are none.
+size_t raon_scan_find2(const char *str, size_t len, char a, char b);
+
+/*
+   Returns the index of the first byte that isn't a space, `\t`, `\r`, `\v` or `\f`, or `len`.
+   Newlines are not skipped because they are tokens.
+*/
+size_t raon_scan_skip_blank(const char *str, size_t len);
+
+/*
+   Counts the newlines in `str`.
+   `last` is set to the index of the last newline and is left untouched if there are none.
+*/
+size_t raon_scan_count_newlines(const char *str, size_t len, size_t *last);
+
+#endif
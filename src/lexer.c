@@ -1,12 +1,109 @@
+#include "internal.h"
 #include "raon.h"
-#include <ctype.h>
-#include <errno.h>
+#include <float.h>
 #include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+// smallest number of lines a line table allocates room for
+#define RAON_LINE_TABLE_MIN_CAPACITY 64
+// line tables search this many bytes past the position asked for, so that short searches add up
+#define RAON_LINE_TABLE_READ_AHEAD 4096
+
+#define BLANK raon_char_class_blank
+#define DIGIT (raon_char_class_digit | raon_char_class_ident | raon_char_class_num)
+#define ALPHA (raon_char_class_ident_start | raon_char_class_ident)
+#define HEX_ALPHA (ALPHA | raon_char_class_num)
+#define UNDERSCORE (raon_char_class_ident_start | raon_char_class_ident | raon_char_class_num)
+#define DASH raon_char_class_ident
+#define DOT raon_char_class_num
+#define STRUCTURAL raon_char_class_structural
+
+const uint8_t raon_char_classes[256] = {
+   [' '] = BLANK, ['\t'] = BLANK, ['\r'] = BLANK, ['\v'] = BLANK, ['\f'] = BLANK, ['0'] = DIGIT,
+   ['1'] = DIGIT, ['2'] = DIGIT, ['3'] = DIGIT, ['4'] = DIGIT, ['5'] = DIGIT, ['6'] = DIGIT,
+   ['7'] = DIGIT, ['8'] = DIGIT, ['9'] = DIGIT, ['A'] = HEX_ALPHA, ['B'] = HEX_ALPHA,
+   ['C'] = HEX_ALPHA, ['D'] = HEX_ALPHA, ['E'] = HEX_ALPHA, ['F'] = HEX_ALPHA, ['a'] = HEX_ALPHA,
+   ['b'] = HEX_ALPHA, ['c'] = HEX_ALPHA, ['d'] = HEX_ALPHA, ['e'] = HEX_ALPHA, ['f'] = HEX_ALPHA,
+   ['G'] = ALPHA, ['H'] = ALPHA, ['I'] = ALPHA, ['J'] = ALPHA, ['K'] = ALPHA, ['L'] = ALPHA,
+   ['M'] = ALPHA, ['N'] = ALPHA, ['O'] = ALPHA, ['P'] = ALPHA, ['Q'] = ALPHA, ['R'] = ALPHA,
+   ['S'] = ALPHA, ['T'] = ALPHA, ['U'] = ALPHA, ['V'] = ALPHA, ['W'] = ALPHA, ['X'] = ALPHA,
+   ['Y'] = ALPHA, ['Z'] = ALPHA, ['g'] = ALPHA, ['h'] = ALPHA, ['i'] = ALPHA, ['j'] = ALPHA,
+   ['k'] = ALPHA, ['l'] = ALPHA, ['m'] = ALPHA, ['n'] = ALPHA, ['o'] = ALPHA, ['p'] = ALPHA,
+   ['q'] = ALPHA, ['r'] = ALPHA, ['s'] = ALPHA, ['t'] = ALPHA, ['u'] = ALPHA, ['v'] = ALPHA,
+   ['w'] = ALPHA, ['x'] = ALPHA, ['y'] = ALPHA, ['z'] = ALPHA, ['_'] = UNDERSCORE, ['-'] = DASH,
+   ['.'] = DOT, ['\0'] = STRUCTURAL, ['"'] = STRUCTURAL, ['#'] = STRUCTURAL, ['{'] = STRUCTURAL,
+   ['}'] = STRUCTURAL, ['['] = STRUCTURAL, [']'] = STRUCTURAL, ['\n'] = STRUCTURAL,
+   [','] = STRUCTURAL,
+};
+
+#undef BLANK
+#undef DIGIT
+#undef ALPHA
+#undef HEX_ALPHA
+#undef UNDERSCORE
+#undef DASH
+#undef DOT
+#undef STRUCTURAL
+
+// what the lexer does when it sees a byte at the start of a token
+enum raon_lex_kind {
+   raon_lex_kind_invalid,
+   raon_lex_kind_end,
+   raon_lex_kind_blank,
+   raon_lex_kind_comment,
+   raon_lex_kind_symbol,
+   raon_lex_kind_string,
+   raon_lex_kind_num,
+   raon_lex_kind_ident,
+};
+
+#define END raon_lex_kind_end
+#define BLANK raon_lex_kind_blank
+#define COMMENT raon_lex_kind_comment
+#define SYMBOL raon_lex_kind_symbol
+#define STRING raon_lex_kind_string
+#define NUM raon_lex_kind_num
+#define IDENT raon_lex_kind_ident
+
+static const uint8_t raon_lex_kinds[256] = {
+   ['\0'] = END, [' '] = BLANK, ['\t'] = BLANK, ['\r'] = BLANK, ['\v'] = BLANK, ['\f'] = BLANK,
+   ['#'] = COMMENT, ['\n'] = SYMBOL, ['='] = SYMBOL, [','] = SYMBOL, ['.'] = SYMBOL, ['{'] = SYMBOL,
+   ['}'] = SYMBOL, ['['] = SYMBOL, [']'] = SYMBOL, ['"'] = STRING, ['0'] = NUM, ['1'] = NUM,
+   ['2'] = NUM, ['3'] = NUM, ['4'] = NUM, ['5'] = NUM, ['6'] = NUM, ['7'] = NUM, ['8'] = NUM,
+   ['9'] = NUM, ['-'] = NUM, ['A'] = IDENT, ['B'] = IDENT, ['C'] = IDENT, ['D'] = IDENT,
+   ['E'] = IDENT, ['F'] = IDENT, ['G'] = IDENT, ['H'] = IDENT, ['I'] = IDENT, ['J'] = IDENT,
+   ['K'] = IDENT, ['L'] = IDENT, ['M'] = IDENT, ['N'] = IDENT, ['O'] = IDENT, ['P'] = IDENT,
+   ['Q'] = IDENT, ['R'] = IDENT, ['S'] = IDENT, ['T'] = IDENT, ['U'] = IDENT, ['V'] = IDENT,
+   ['W'] = IDENT, ['X'] = IDENT, ['Y'] = IDENT, ['Z'] = IDENT, ['a'] = IDENT, ['b'] = IDENT,
+   ['c'] = IDENT, ['d'] = IDENT, ['e'] = IDENT, ['f'] = IDENT, ['g'] = IDENT, ['h'] = IDENT,
+   ['i'] = IDENT, ['j'] = IDENT, ['k'] = IDENT, ['l'] = IDENT, ['m'] = IDENT, ['n'] = IDENT,
+   ['o'] = IDENT, ['p'] = IDENT, ['q'] = IDENT, ['r'] = IDENT, ['s'] = IDENT, ['t'] = IDENT,
+   ['u'] = IDENT, ['v'] = IDENT, ['w'] = IDENT, ['x'] = IDENT, ['y'] = IDENT, ['z'] = IDENT,
+   ['_'] = IDENT,
+};
+
+#undef END
+#undef BLANK
+#undef COMMENT
+#undef SYMBOL
+#undef STRING
+#undef NUM
+#undef IDENT
+
+static const uint8_t raon_symbol_types[256] = {
+   ['\n'] = raon_token_type_newline,
+   ['='] = raon_token_type_equal,
+   [','] = raon_token_type_comma,
+   ['.'] = raon_token_type_dot,
+   ['{'] = raon_token_type_block_open,
+   ['}'] = raon_token_type_block_close,
+   ['['] = raon_token_type_array_open,
+   [']'] = raon_token_type_array_close,
+};
+
 struct raon_lexer raon_lexer_init(char *str, size_t len) {
-   return (struct raon_lexer) { .str = str, .str_len = len, .line = 1 };
+   return (struct raon_lexer) { .str = str, .str_len = len };
 }
 
 static char raon_lexer_peek_char(struct raon_lexer *self) {
@@ -16,21 +113,18 @@ static char raon_lexer_peek_char(struct raon_lexer *self) {
    return self->str[self->idx];
 }
 
+// the lexer only ever hands out slices that it already walked over, so bounds come from `idx`
+// instead of rescanning the input for a NUL terminator
+static struct raon_str_slice raon_lexer_slice(struct raon_lexer *self, size_t start, size_t end) {
+   return (struct raon_str_slice) { .ptr = &self->str[start], .len = end - start };
+}
+
 static char raon_lexer_eat_char(struct raon_lexer *self) {
    if (self->idx >= self->str_len) {
       return '\0';
    }
 
-   char curr = self->str[self->idx];
-   ++self->idx;
-
-   if (curr == '\n') {
-      ++self->line;
-      self->col = 0;
-   } else {
-      ++self->col;
-   }
-   return curr;
+   return self->str[self->idx++];
 }
 
 void raon_lexer_ignore_comment(struct raon_lexer *self) {
@@ -39,293 +133,466 @@ void raon_lexer_ignore_comment(struct raon_lexer *self) {
    }
    raon_lexer_eat_char(self);
 
-   for (;;) {
-      char curr = raon_lexer_peek_char(self);
-      if (curr == '\0' || curr == '\n') {
+   // a comment ends right before the newline (or the end of input), so it never spans lines
+   self->idx += raon_scan_find2(&self->str[self->idx], self->str_len - self->idx, '\n', '\0');
+}
+
+bool raon_lexer_skip_nested(struct raon_lexer *self, struct raon_str_slice *text) {
+   const size_t start = self->idx - 1;
+   size_t idx = self->idx;
+   size_t depth = 1;
+   while (depth > 0) {
+      while (idx < self->str_len && !raon_char_is(self->str[idx], raon_char_class_structural)) {
+         ++idx;
+      }
+      if (idx >= self->str_len) {
+         return false;
+      }
+
+      switch (self->str[idx++]) {
+      case '\0':
+         return false;
+
+      case '"': {
+         const size_t len = raon_scan_find2(&self->str[idx], self->str_len - idx, '"', '\0');
+         if (idx + len == self->str_len || self->str[idx + len] != '"') {
+            return false;
+         }
+         idx += len + 1;
+      } break;
+
+      case '#':
+         idx += raon_scan_find2(&self->str[idx], self->str_len - idx, '\n', '\0');
+         break;
+
+      case '{':
+      case '[':
+         ++depth;
+         break;
+
+      case '}':
+      case ']':
+         --depth;
          break;
       }
-      raon_lexer_eat_char(self);
    }
+
+   self->idx = idx;
+   *text = raon_lexer_slice(self, start, idx);
+   return true;
 }
 
 struct raon_token raon_lexer_lex_string(struct raon_lexer *self) {
-   struct raon_token error_val = { .type = raon_token_type_error };
+   struct raon_token error_val = {
+      .type = raon_token_type_error,
+      .start = self->idx,
+      .end = self->idx,
+   };
    if (raon_lexer_peek_char(self) != '"') {
       return error_val;
    }
+   struct raon_token token = { .type = raon_token_type_error, .start = self->idx };
    raon_lexer_eat_char(self);
 
-   struct raon_token token = {
-      .type = raon_token_type_error,
-      .start_line = self->line,
-      .start_col = self->col,
-   };
-
    const size_t start_str = self->idx;
-   while (raon_lexer_peek_char(self) != '\0') {
-      char curr = raon_lexer_eat_char(self);
-      if (curr == '"') {
-         token.type = raon_token_type_string;
-         break;
-      }
-   }
-   const size_t end_str = self->idx - 1;
-   const size_t str_len = end_str - start_str;
-   token.end_line = self->line;
-   token.end_col = self->col;
-   token.str_val = raon_slice_from_str(&self->str[start_str], str_len);
-   if (!token.str_val.ptr) {
-      return error_val;
+   self->idx += raon_scan_find2(&self->str[start_str], self->str_len - start_str, '"', '\0');
+   if (raon_lexer_peek_char(self) == '"') {
+      raon_lexer_eat_char(self);
+      token.type = raon_token_type_string;
    }
+   // the closing quote is not part of the slice, an unterminated string stops at the end of input
+   const size_t end_str = token.type == raon_token_type_string ? self->idx - 1 : self->idx;
+   token.end = self->idx;
+   token.str_val = raon_lexer_slice(self, start_str, end_str);
    return token;
 }
 
-static struct raon_token raon_lexer_lex_scientific_num(struct raon_lexer *self) {
-   // TODO
+// value of a digit in any of the supported bases, or 0xFF for anything that isn't one
+static unsigned raon_digit_value(char c) {
+   if (c >= '0' && c <= '9') {
+      return c - '0';
+   }
+   if (c >= 'a' && c <= 'f') {
+      return c - 'a' + 10;
+   }
+   if (c >= 'A' && c <= 'F') {
+      return c - 'A' + 10;
+   }
+   return 0xFF;
 }
 
-struct raon_token raon_lexer_lex_num(struct raon_lexer *self) {
-   struct raon_token error_val = { .type = raon_token_type_error };
-   char curr = raon_lexer_peek_char(self);
-   if (!isdigit(curr) && curr != '-') {
-      return error_val;
+// `0b`, `0o` and `0x` literals, each digit is a fixed number of bits so they're shifted in
+static bool raon_lex_based_int(
+    const char *str, size_t len, size_t *idx, unsigned base, intptr_t *out) {
+   const unsigned bits = base == 16 ? 4 : base == 8 ? 3 : 1;
+   uint64_t value = 0;
+   size_t digits = 0;
+   bool overflow = false;
+
+   size_t i = *idx;
+   for (; i < len; i++) {
+      const char c = str[i];
+      if (c == '_') {
+         continue;
+      }
+      const unsigned digit = raon_digit_value(c);
+      if (digit >= base) {
+         break;
+      }
+      overflow |= (value >> (64 - bits)) != 0;
+      value = value << bits | digit;
+      ++digits;
    }
+   *idx = i;
 
-   struct raon_token token = {
-      .type = raon_token_type_int,
-      .start_line = self->line,
-      .start_col = self->col,
-   };
-
-   size_t start_int = self->idx;
+   if (digits == 0 || overflow || value > (uint64_t)INTPTR_MAX) {
+      return false;
+   }
+   *out = (intptr_t)value;
+   return true;
+}
 
-   enum num_type {
-      num_type_hex,
-      num_type_decimal,
-      num_type_octal,
-      num_type_binary,
-      num_type_float,
-   } int_type = num_type_decimal;
+/*
+   Decimal integers and floats. The first 19 significant digits are accumulated in a single
+   integer, which is exact for every integer that fits in `intptr_t` and enough for
+   `raon_float_from_decimal` to round floats correctly in almost every case.
+*/
+static bool raon_lex_decimal(const char *str, size_t len, size_t *idx, struct raon_token *token) {
+   const size_t start = *idx;
+   size_t i = start;
+   const bool negative = str[i] == '-';
+   if (negative) {
+      ++i;
+   }
 
-   curr = raon_lexer_peek_char(self);
-   if (curr == '-') {
-      raon_lexer_eat_char(self);
-   } else if (curr == '0') {
-      raon_lexer_eat_char(self);
-      curr = raon_lexer_peek_char(self);
+   uint64_t mantissa = 0;
+   int64_t exp10 = 0;
+   size_t significant = 0, int_digits = 0;
+   bool truncated = false, is_float = false;
 
-      if (curr == 'b' || curr == 'o' || curr == 'x') {
-         raon_lexer_eat_char(self);
-         switch (curr) {
-         case 'b':
-            int_type = num_type_binary;
-            raon_lexer_eat_char(self);
-            break;
+   for (; i < len; i++) {
+      const char c = str[i];
+      if (c == '_') {
+         continue;
+      }
+      if (c < '0' || c > '9') {
+         break;
+      }
+      ++int_digits;
+      if (significant < 19) {
+         mantissa = mantissa * 10 + (c - '0');
+         significant += mantissa != 0;
+      } else {
+         ++exp10;
+         truncated |= c != '0';
+      }
+   }
 
-         case 'o':
-            int_type = num_type_octal;
-            raon_lexer_eat_char(self);
+   if (i < len && str[i] == '.') {
+      is_float = true;
+      size_t frac_digits = 0;
+      for (++i; i < len; i++) {
+         const char c = str[i];
+         if (c == '_') {
+            continue;
+         }
+         if (c < '0' || c > '9') {
             break;
+         }
+         ++frac_digits;
+         if (significant < 19) {
+            mantissa = mantissa * 10 + (c - '0');
+            significant += mantissa != 0;
+            --exp10;
+         } else {
+            truncated |= c != '0';
+         }
+      }
+      if (frac_digits == 0) {
+         *idx = i;
+         return false;
+      }
+   }
 
-         case 'x':
-            int_type = num_type_hex;
-            raon_lexer_eat_char(self);
-            break;
+   if (i < len && (str[i] == 'e' || str[i] == 'E')) {
+      is_float = true;
+      ++i;
+      bool exp_negative = false;
+      if (i < len && (str[i] == '+' || str[i] == '-')) {
+         exp_negative = str[i] == '-';
+         ++i;
+      }
+      int64_t exponent = 0;
+      size_t exp_digits = 0;
+      for (; i < len && str[i] >= '0' && str[i] <= '9'; i++) {
+         if (exponent < RAON_FLOAT_EXPONENT_LIMIT) {
+            exponent = exponent * 10 + (str[i] - '0');
          }
+         ++exp_digits;
+      }
+      if (exp_digits == 0) {
+         *idx = i;
+         return false;
       }
+      exp10 += exp_negative ? -exponent : exponent;
    }
+   *idx = i;
 
-   size_t dot_count = 0;
+   if (int_digits == 0) {
+      return false;
+   }
 
-   for (char next = raon_lexer_peek_char(self); isdigit(next) || next == '_'
-       || (next >= 'A' && next <= 'F' || next >= 'a' && next <= 'f' || next == '.');
-       next = raon_lexer_peek_char(self)) {
-      if (raon_lexer_eat_char(self) == '.') {
-         ++dot_count;
+   if (!is_float) {
+      // more than 19 significant digits can't fit either
+      const uint64_t limit = negative ? (uint64_t)INTPTR_MAX + 1 : (uint64_t)INTPTR_MAX;
+      if (exp10 != 0 || mantissa > limit) {
+         return false;
       }
+      token->type = raon_token_type_int;
+      token->int_val = negative && mantissa ? -(intptr_t)(mantissa - 1) - 1 : (intptr_t)mantissa;
+      return true;
    }
 
-   // floating points can only have one dot
-   if (dot_count > 1) {
-      return error_val;
+   double value;
+   if (raon_float_from_decimal(mantissa, exp10, truncated, &value)) {
+      value = negative ? -value : value;
+   } else {
+      value = raon_float_from_literal(&str[start], i - start);
    }
-   if (dot_count == 1) {
-      int_type = num_type_float;
-      token.type = raon_token_type_float;
+   if (value > DBL_MAX || value < -DBL_MAX) {
+      return false;
    }
+   token->type = raon_token_type_float;
+   token->float_val = value;
+   return true;
+}
 
-   // trailing number separators are not allowed
-   if (self->str[self->idx - 1] == '_') {
+/*
+   Numbers are read straight from the input: separators are skipped in place and values are built
+   while walking the digits, so lexing a number never copies or allocates.
+*/
+struct raon_token raon_lexer_lex_num(struct raon_lexer *self) {
+   struct raon_token error_val = {
+      .type = raon_token_type_error,
+      .start = self->idx,
+      .end = self->idx,
+   };
+   const char curr = raon_lexer_peek_char(self);
+   if (!raon_char_is(curr, raon_char_class_digit) && curr != '-') {
       return error_val;
    }
 
-   size_t end_int = self->idx;
-   size_t int_len = end_int - start_int + 1;
-   token.end_col = self->col;
-   token.end_line = self->line;
+   struct raon_token token = { .type = raon_token_type_int, .start = self->idx };
 
-   char *num_str = malloc(int_len + 1);
-   if (!num_str) {
-      return error_val;
-   }
+   const char *str = self->str;
+   const size_t len = self->str_len;
+   size_t end = self->idx;
 
-   // ignore number separators
-   char *int_slice = &self->str[start_int];
-   size_t int_str_idx = 0;
-   for (size_t i = 0; i < int_len; i++) {
-      if (int_slice[i] == '_') {
-         continue;
+   unsigned base = 10;
+   if (curr == '0' && end + 1 < len) {
+      switch (str[end + 1]) {
+      case 'b':
+         base = 2;
+         break;
+      case 'o':
+         base = 8;
+         break;
+      case 'x':
+         base = 16;
+         break;
       }
-      num_str[int_str_idx++] = int_slice[i];
    }
-   num_str[int_len] = '\0';
-
-   errno = 0;
-   switch (int_type) {
-   case num_type_binary:
-      token.int_val = strtoll(num_str + 2, NULL, 2);
-      break;
 
-   case num_type_octal:
-      token.int_val = strtoll(num_str + 2, NULL, 8);
-      break;
-
-   case num_type_decimal:
-      token.int_val = strtoll(num_str, NULL, 10);
-      break;
-
-   case num_type_hex:
-      token.int_val = strtoll(num_str + 2, NULL, 16);
-      break;
+   bool valid;
+   if (base == 10) {
+      valid = raon_lex_decimal(str, len, &end, &token);
+   } else {
+      end += 2;
+      valid = raon_lex_based_int(str, len, &end, base, &token.int_val);
+      token.int_base = (uint8_t)base;
+   }
 
-   case num_type_float:
-      token.float_val = strtod(num_str, NULL);
-      break;
+   // trailing separators are not allowed and a number can't run into an identifier or another dot
+   if (str[end - 1] == '_'
+       || (end < len && (raon_char_is(str[end], raon_char_class_ident) || str[end] == '.'))) {
+      valid = false;
    }
-   if (errno == EINVAL || errno == ERANGE) {
+
+   self->idx = end;
+   if (!valid) {
+      error_val.end = end;
       return error_val;
    }
-   free(num_str);
+   token.end = end;
    return token;
 }
 
 struct raon_token raon_lexer_lex_ident(struct raon_lexer *self) {
    char start_char = raon_lexer_peek_char(self);
-   if (!isalpha(start_char) && start_char != '_') {
-      return (struct raon_token) { .type = raon_token_type_error };
+   if (!raon_char_is(start_char, raon_char_class_ident_start)) {
+      return (struct raon_token) {
+         .type = raon_token_type_error,
+         .start = self->idx,
+         .end = self->idx,
+      };
    }
 
+   size_t start_ident = self->idx;
+   size_t end_ident = start_ident + 1;
+   while (end_ident < self->str_len && raon_char_is(self->str[end_ident], raon_char_class_ident)) {
+      ++end_ident;
+   }
+   self->idx = end_ident;
    struct raon_token token = {
       .type = raon_token_type_key,
-      .start_line = self->line,
-      .start_col = self->col,
+      .start = start_ident,
+      .end = end_ident,
    };
-
-   size_t start_ident = self->idx;
-   for (;;) {
-      char c = raon_lexer_peek_char(self);
-      if (c != '_' && c != '-' && !isalnum(c)) {
-         break;
-      }
-      raon_lexer_eat_char(self);
-   }
-   size_t end_ident = self->idx - 1;
-   size_t ident_len = end_ident - start_ident + 1;
+   size_t ident_len = end_ident - start_ident;
    char *ident = &self->str[start_ident];
 
-   if (strncmp(ident, "true", ident_len) == 0) {
+   // only identifiers of the right length are compared, so keys like `t` or `trueish` stay keys
+   if (ident_len == 4 && memcmp(ident, "true", 4) == 0) {
       token.type = raon_token_type_bool;
       token.bool_val = true;
       return token;
    }
 
-   if (strncmp(ident, "false", ident_len) == 0) {
+   if (ident_len == 5 && memcmp(ident, "false", 5) == 0) {
       token.type = raon_token_type_bool;
       token.bool_val = false;
       return token;
    }
 
    token.type = raon_token_type_key;
-   token.str_val = raon_slice_from_str(ident, ident_len);
-   if (!token.str_val.ptr) {
-      return (struct raon_token) { .type = raon_token_type_error };
-   }
+   token.str_val = raon_lexer_slice(self, start_ident, self->idx);
    return token;
 }
 
 struct raon_token raon_lexer_eat(struct raon_lexer *self) {
 #define RAON_ONE_CHAR_TOKEN(literal, enum_type)                                                    \
    (struct raon_token) {                                                                           \
-      .type = enum_type, .char_val = literal, .start_col = self->col, .start_line = self->line,    \
-      .end_line = self->line, .end_col = self->col,                                                \
+      .type = enum_type, .char_val = literal, .start = start, .end = self->idx,                    \
    }
 
-   struct raon_token curr_token = { 0 };
-   for (;;) {
-      char curr = raon_lexer_peek_char(self);
-      if (curr == '\0') {
-         break;
-      }
+   // every token kind is decided by its first byte, so each byte is classified exactly once
+   while (self->idx < self->str_len) {
+      const size_t start = self->idx;
+      const char curr = self->str[start];
+      switch ((enum raon_lex_kind)raon_lex_kinds[(unsigned char)curr]) {
+      case raon_lex_kind_end:
+         return RAON_ONE_CHAR_TOKEN('\0', raon_token_type_eof);
 
-      switch (curr) {
-      case '#':
+      case raon_lex_kind_blank:
+         self->idx += raon_scan_skip_blank(&self->str[start], self->str_len - start);
+         continue;
+
+      case raon_lex_kind_comment:
          raon_lexer_ignore_comment(self);
-         break;
+         continue;
 
-      case '\n':
+      case raon_lex_kind_symbol:
          raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('\n', raon_token_type_newline);
+         return RAON_ONE_CHAR_TOKEN(curr, raon_symbol_types[(unsigned char)curr]);
 
-      case '=':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('=', raon_token_type_equal);
+      case raon_lex_kind_string:
+         return raon_lexer_lex_string(self);
 
-      case '{':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('{', raon_token_type_block_open);
+      case raon_lex_kind_num:
+         return raon_lexer_lex_num(self);
 
-      case '}':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('}', raon_token_type_block_close);
+      case raon_lex_kind_ident:
+         return raon_lexer_lex_ident(self);
 
-      case '[':
+      case raon_lex_kind_invalid:
+         // the byte is consumed so that callers looping until EOF still make progress
          raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('[', raon_token_type_array_open);
+         return RAON_ONE_CHAR_TOKEN(curr, raon_token_type_error);
+      }
+   }
 
-      case ']':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN(']', raon_token_type_array_close);
+   const size_t start = self->idx;
+   return RAON_ONE_CHAR_TOKEN('\0', raon_token_type_eof);
+#undef RAON_ONE_CHAR_TOKEN
+}
 
-      case ',':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN(',', raon_token_type_comma);
+struct raon_position raon_lexer_position(const struct raon_lexer *self, size_t offset) {
+   if (offset > self->str_len) {
+      offset = self->str_len;
+   }
+   size_t last = 0;
+   const size_t newlines = raon_scan_count_newlines(self->str, offset, &last);
+   return (struct raon_position) {
+      .line = newlines + 1,
+      .col = newlines ? offset - (last + 1) : offset,
+   };
+}
 
-      case '.':
-         raon_lexer_eat_char(self);
-         return RAON_ONE_CHAR_TOKEN('.', raon_token_type_dot);
-      }
+struct raon_line_table raon_line_table_init(const char *str, size_t len) {
+   return (struct raon_line_table) { .str = str, .str_len = len };
+}
 
-      if (isspace(curr)) {
-         raon_lexer_eat_char(self);
-         continue;
+// records the start of every line up to `offset`, the first line always starts at 0
+static bool raon_line_table_scan(struct raon_line_table *self, size_t offset) {
+   if (self->len && offset < self->scanned) {
+      return true;
+   }
+   if (self->len == 0) {
+      self->starts = malloc(RAON_LINE_TABLE_MIN_CAPACITY * sizeof(size_t));
+      if (!self->starts) {
+         return false;
       }
+      self->capacity = RAON_LINE_TABLE_MIN_CAPACITY;
+      self->starts[self->len++] = 0;
+   }
 
-      curr_token = raon_lexer_lex_ident(self);
-      if (curr_token.type != raon_token_type_error) {
-         return curr_token;
+   const size_t end = self->str_len - offset > RAON_LINE_TABLE_READ_AHEAD
+       ? offset + RAON_LINE_TABLE_READ_AHEAD
+       : self->str_len;
+   while (self->scanned < end) {
+      const size_t newline = self->scanned
+          + raon_scan_find2(&self->str[self->scanned], end - self->scanned, '\n', '\n');
+      if (newline == end) {
+         self->scanned = end;
+         break;
       }
-
-      curr_token = raon_lexer_lex_num(self);
-      if (curr_token.type != raon_token_type_error) {
-         return curr_token;
+      if (self->len == self->capacity) {
+         size_t *starts = realloc(self->starts, self->capacity * 2 * sizeof(size_t));
+         if (!starts) {
+            return false;
+         }
+         self->starts = starts;
+         self->capacity *= 2;
       }
+      self->starts[self->len++] = newline + 1;
+      self->scanned = newline + 1;
+   }
+   return true;
+}
+
+struct raon_position raon_line_table_position(struct raon_line_table *self, size_t offset) {
+   if (offset > self->str_len) {
+      offset = self->str_len;
+   }
+   if (!raon_line_table_scan(self, offset)) {
+      const struct raon_lexer lexer = raon_lexer_init((char *)self->str, self->str_len);
+      return raon_lexer_position(&lexer, offset);
+   }
 
-      curr_token = raon_lexer_lex_string(self);
-      if (curr_token.type != raon_token_type_error) {
-         return curr_token;
+   // last line that starts at or before `offset`
+   size_t low = 0, high = self->len;
+   while (high - low > 1) {
+      const size_t mid = low + (high - low) / 2;
+      if (self->starts[mid] <= offset) {
+         low = mid;
+      } else {
+         high = mid;
       }
    }
+   return (struct raon_position) { .line = low + 1, .col = offset - self->starts[low] };
+}
 
-   return RAON_ONE_CHAR_TOKEN('\0', raon_token_type_eof);
-#undef RAON_ONE_CHAR_TOKEN
+void raon_line_table_free(struct raon_line_table *self) {
+   free(self->starts);
+   *self = raon_line_table_init(self->str, self->str_len);
 }
@@ -0,0 +1,457 @@
+// sysconf() and pthreads are POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "internal.h"
+#include "raon.h"
+#include <stdatomic.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+   #define RAON_PARALLEL_THREADS
+   #include <pthread.h>
+   #include <unistd.h>
+#endif
+
+// below this many bytes per thread, starting the threads costs more than it saves
+#define RAON_PARALLEL_MIN_SLICE (1024 * 1024)
+#define RAON_PARALLEL_MAX_THREADS 64
+
+// === Threads ===
+
+/*
+   Runs `task` once for each of the `count` items of `tasks`, which are `size` bytes apart.
+   The first item runs on the calling thread, items that can't get a thread run there as well.
+*/
+static void raon_parallel_run(void *(*task)(void *), void *tasks, size_t size, size_t count) {
+#ifdef RAON_PARALLEL_THREADS
+   pthread_t threads[RAON_PARALLEL_MAX_THREADS];
+   bool started[RAON_PARALLEL_MAX_THREADS] = { 0 };
+   for (size_t i = 1; i < count; i++) {
+      started[i] = pthread_create(&threads[i], NULL, task, (char *)tasks + i * size) == 0;
+   }
+   for (size_t i = 0; i < count; i++) {
+      if (!started[i]) {
+         task((char *)tasks + i * size);
+      }
+   }
+   for (size_t i = 1; i < count; i++) {
+      if (started[i]) {
+         pthread_join(threads[i], NULL);
+      }
+   }
+#else
+   for (size_t i = 0; i < count; i++) {
+      task((char *)tasks + i * size);
+   }
+#endif
+}
+
+static size_t raon_parallel_cpu_count(void) {
+#ifdef RAON_PARALLEL_THREADS
+   const long count = sysconf(_SC_NPROCESSORS_ONLN);
+   return count > 0 ? (size_t)count : 1;
+#else
+   return 1;
+#endif
+}
+
+// === Splitting ===
+
+/*
+   State of a walk over the text that follows the lexer just enough to know where top-level
+   entries end, which is at a newline or a comma outside of any block, array, string or comment.
+   The same walk is done by the incremental parser, see `raon_parser_feed`.
+*/
+struct raon_split_walk {
+   bool in_string;
+   // unbalanced closes can take it below 0, the parser rejects those anyway
+   ptrdiff_t depth;
+};
+
+/*
+   Walks `str` starting from the state in `walk`, which is updated along the way.
+   `str` has to start right after a newline, so that it never starts inside of a comment.
+
+   Inputs:
+   - `boundary`: if not NULL, the walk stops right after the first entry that ends and its index is
+   stored there
+
+   Returns: false if the walk went through the whole text without stopping
+*/
+static bool raon_split_walk(
+    struct raon_split_walk *walk, const char *str, size_t len, size_t *boundary) {
+   size_t idx = 0;
+   while (idx < len) {
+      if (walk->in_string) {
+         const size_t end = idx + raon_scan_find2(&str[idx], len - idx, '"', '"');
+         if (end == len) {
+            return false;
+         }
+         walk->in_string = false;
+         idx = end + 1;
+         continue;
+      }
+
+      while (idx < len && !raon_char_is(str[idx], raon_char_class_structural)) {
+         ++idx;
+      }
+      if (idx == len) {
+         break;
+      }
+
+      switch (str[idx++]) {
+      case '"':
+         walk->in_string = true;
+         break;
+
+      case '#':
+         // the newline that ends the comment still ends the entry, so it's left for the switch
+         idx += raon_scan_find2(&str[idx], len - idx, '\n', '\n');
+         break;
+
+      case '{':
+      case '[':
+         ++walk->depth;
+         break;
+
+      case '}':
+      case ']':
+         --walk->depth;
+         break;
+
+      case '\n':
+      case ',':
+         if (boundary && walk->depth == 0) {
+            *boundary = idx;
+            return true;
+         }
+         break;
+      }
+   }
+   return false;
+}
+
+/*
+   The text is cut into one slice per thread and each slice is walked twice at once, once as if it
+   started outside of a string and once as if it started inside of one. Chaining the results in
+   order then tells the actual state at the start of every slice without walking the text twice in a
+   row.
+*/
+struct raon_split_slice {
+   const char *str;
+   size_t len;
+   struct raon_split_walk from_text, from_string;
+   // the lexer ends the text at the first NUL, which the split doesn't account for
+   bool has_nul;
+};
+
+static void *raon_split_slice_task(void *arg) {
+   struct raon_split_slice *slice = arg;
+   slice->from_text = (struct raon_split_walk) { .in_string = false };
+   slice->from_string = (struct raon_split_walk) { .in_string = true };
+   raon_split_walk(&slice->from_text, slice->str, slice->len, NULL);
+   raon_split_walk(&slice->from_string, slice->str, slice->len, NULL);
+   slice->has_nul = memchr(slice->str, '\0', slice->len) != NULL;
+   return NULL;
+}
+
+// === Parsing ===
+
+// a run of whole top-level entries, parsed into an arena of its own
+struct raon_parse_range {
+   char *str;
+   size_t len;
+   struct raon_arena *arena;
+   struct vector_of_raon_entry *entries;
+   bool success;
+};
+
+// repeated keys are only looked for once every range is parsed, see `raon_stitch_ranges`
+static void *raon_parse_range_task(void *arg) {
+   struct raon_parse_range *range = arg;
+   const struct vec_allocator allocator = raon_arena_allocator(range->arena);
+   range->entries = vec_new_raon_entry(allocator);
+   if (!range->entries) {
+      range->success = false;
+      return NULL;
+   }
+   struct raon_lexer lexer = raon_lexer_init(range->str, range->len);
+   range->success = raon_parse_entries_into(allocator, &lexer, range->entries, false);
+   return NULL;
+}
+
+/*
+   Cuts the text into at most `count` ranges that start right after the end of a top-level entry.
+
+   Returns: the number of ranges, 0 if the text can't be split
+*/
+static size_t raon_split_ranges(
+    char *str, size_t len, size_t count, struct raon_parse_range *ranges) {
+   struct raon_split_slice slices[RAON_PARALLEL_MAX_THREADS];
+   size_t begin = 0;
+   for (size_t i = 0; i < count; i++) {
+      // slices start right after a newline, which can't be inside of a comment
+      size_t end = len;
+      if (i + 1 < count) {
+         const size_t target = len / count * (i + 1);
+         if (target > begin) {
+            end = target + raon_scan_find2(&str[target], len - target, '\n', '\n');
+            end += end < len;
+         } else {
+            end = begin;
+         }
+      }
+      slices[i] = (struct raon_split_slice) { .str = &str[begin], .len = end - begin };
+      begin = end;
+   }
+   raon_parallel_run(raon_split_slice_task, slices, sizeof(slices[0]), count);
+   for (size_t i = 0; i < count; i++) {
+      if (slices[i].has_nul) {
+         return 0;
+      }
+   }
+
+   // the first range starts at the top of the text, every other one at the first entry boundary
+   // inside of its slice, slices without any boundary are left to the range before them
+   size_t range_count = 1;
+   ranges[0] = (struct raon_parse_range) { .str = str };
+   struct raon_split_walk state = { 0 };
+   for (size_t i = 0; i < count; i++) {
+      const struct raon_split_slice *slice = &slices[i];
+      const struct raon_split_walk *result = state.in_string ? &slice->from_string
+                                                             : &slice->from_text;
+      struct raon_split_walk walk = state;
+      size_t boundary = 0;
+      if (i > 0 && raon_split_walk(&walk, slice->str, slice->len, &boundary)) {
+         ranges[range_count++] = (struct raon_parse_range) { .str = (char *)&slice->str[boundary] };
+      }
+      state.in_string = result->in_string;
+      state.depth += result->depth;
+   }
+
+   for (size_t i = 0; i < range_count; i++) {
+      const char *end = i + 1 < range_count ? ranges[i + 1].str : str + len;
+      ranges[i].len = (size_t)(end - ranges[i].str);
+   }
+   return range_count;
+}
+
+/*
+   Puts the entries of every range into the document in their original order.
+   Indexing the top level tells whether any key repeats, in which case the entries go through
+   `raon_push_entry` one by one instead, which merges repeated blocks or fails.
+*/
+static bool raon_stitch_ranges(
+    struct raon_document *doc, struct raon_parse_range *ranges, size_t range_count) {
+   size_t total = 0;
+   enum raon_key_type key_type = raon_key_type_error;
+   bool unique = true;
+   for (size_t i = 0; i < range_count; i++) {
+      const struct vector_of_raon_entry *entries = ranges[i].entries;
+      if (!ranges[i].success) {
+         return false;
+      }
+      for (size_t j = 0; j < entries->len && unique; j++) {
+         if (key_type == raon_key_type_error) {
+            key_type = entries->vec[j].key_type;
+         }
+         unique = entries->vec[j].key_type == key_type;
+      }
+      total += entries->len;
+   }
+
+   if (!vec_reserve_exact_raon_entry(doc->entries, total)) {
+      return false;
+   }
+   if (unique) {
+      for (size_t i = 0; i < range_count; i++) {
+         vec_append_raon_entry(doc->entries, ranges[i].entries);
+      }
+      // the index is kept so that lookups never have to build it, which would race when
+      // several threads read the document
+      unique = raon_block_keys_unique(doc->entries);
+      if (unique && doc->entries->len >= RAON_BLOCK_INDEX_THRESHOLD) {
+         return true;
+      }
+      raon_block_free_index(doc->entries);
+      if (unique) {
+         return true;
+      }
+      doc->entries->len = 0;
+   }
+
+   for (size_t i = 0; i < range_count; i++) {
+      for (size_t j = 0; j < ranges[i].entries->len; j++) {
+         if (!raon_push_entry(doc->entries, ranges[i].entries->vec[j])) {
+            return false;
+         }
+      }
+   }
+   return raon_finish_top_level(doc->entries);
+}
+
+struct raon_document *raon_parse_document_parallel(char *str, size_t len, size_t threads) {
+   if (threads == 0) {
+      threads = raon_parallel_cpu_count();
+   }
+   if (threads > len / RAON_PARALLEL_MIN_SLICE) {
+      threads = len / RAON_PARALLEL_MIN_SLICE;
+   }
+   if (threads > RAON_PARALLEL_MAX_THREADS) {
+      threads = RAON_PARALLEL_MAX_THREADS;
+   }
+
+   struct raon_parse_range ranges[RAON_PARALLEL_MAX_THREADS];
+   const size_t range_count = threads > 1 ? raon_split_ranges(str, len, threads, ranges) : 0;
+   if (range_count <= 1) {
+      return raon_parse_document(str, len);
+   }
+
+   struct raon_document *doc = raon_document_new(len);
+   if (!doc) {
+      return NULL;
+   }
+
+   // the first range is parsed into the document's arena, the others get arenas that the document
+   // keeps alive since their entries end up in it
+   doc->thread_arenas
+       = raon_arena_alloc(&doc->arena, (range_count - 1) * sizeof(struct raon_arena));
+   if (!doc->thread_arenas) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   ranges[0].arena = &doc->arena;
+   for (size_t i = 1; i < range_count; i++) {
+      doc->thread_arenas[doc->thread_arena_count++] = raon_arena_init(0);
+      ranges[i].arena = &doc->thread_arenas[i - 1];
+   }
+   raon_parallel_run(raon_parse_range_task, ranges, sizeof(ranges[0]), range_count);
+
+   if (!raon_stitch_ranges(doc, ranges, range_count)) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
+
+// === Batches ===
+
+// a thread's share of the inputs, their indices are packed in a single word so they can be taken
+// from either end with one atomic operation
+struct raon_batch_queue {
+   _Atomic uint64_t range;
+};
+
+static uint64_t raon_batch_range(uint32_t begin, uint32_t end) {
+   return (uint64_t)begin << 32 | end;
+}
+
+// the owner of the queue takes inputs from the front, threads stealing from it take them from the
+// back, so they only contend for the last one
+static bool raon_batch_take(struct raon_batch_queue *queue, bool from_back, size_t *index) {
+   uint64_t range = atomic_load(&queue->range);
+   for (;;) {
+      const uint32_t begin = (uint32_t)(range >> 32);
+      const uint32_t end = (uint32_t)range;
+      if (begin >= end) {
+         return false;
+      }
+      const uint64_t rest
+          = from_back ? raon_batch_range(begin, end - 1) : raon_batch_range(begin + 1, end);
+      if (atomic_compare_exchange_weak(&queue->range, &range, rest)) {
+         *index = from_back ? end - 1 : begin;
+         return true;
+      }
+   }
+}
+
+struct raon_batch_worker {
+   const struct raon_batch_input *inputs;
+   struct raon_document **results;
+   struct raon_batch_queue *queues;
+   size_t queue_count, self;
+   bool prefetch;
+   size_t failed;
+};
+
+static bool raon_batch_next(struct raon_batch_worker *worker, size_t *index) {
+   if (raon_batch_take(&worker->queues[worker->self], false, index)) {
+      return true;
+   }
+   for (size_t i = 1; i < worker->queue_count; i++) {
+      const size_t victim = (worker->self + i) % worker->queue_count;
+      if (raon_batch_take(&worker->queues[victim], true, index)) {
+         return true;
+      }
+   }
+   // inputs are never added back, so once every queue is empty the batch is done
+   return false;
+}
+
+static void *raon_batch_worker_task(void *arg) {
+   struct raon_batch_worker *worker = arg;
+   size_t index = 0;
+   while (raon_batch_next(worker, &index)) {
+      if (worker->prefetch) {
+         const uint64_t range = atomic_load(&worker->queues[worker->self].range);
+         const uint32_t next = (uint32_t)(range >> 32);
+         if (next < (uint32_t)range && worker->inputs[next].path) {
+            raon_file_prefetch(worker->inputs[next].path);
+         }
+      }
+
+      const struct raon_batch_input *input = &worker->inputs[index];
+      worker->results[index] = input->path ? raon_parse_file(input->path)
+                                           : raon_parse_document(input->str, input->len);
+      if (!worker->results[index]) {
+         ++worker->failed;
+      }
+   }
+   return NULL;
+}
+
+size_t raon_parse_batch(const struct raon_batch_input *inputs, size_t count,
+    struct raon_document **results, struct raon_batch_options options) {
+   // indices have to fit in half of a queue's word, bigger batches are done a part at a time
+   if (count > UINT32_MAX) {
+      return raon_parse_batch(inputs, UINT32_MAX, results, options)
+           + raon_parse_batch(&inputs[UINT32_MAX], count - UINT32_MAX, &results[UINT32_MAX],
+               options);
+   }
+
+   size_t threads = options.threads ? options.threads : raon_parallel_cpu_count();
+   if (threads > count) {
+      threads = count;
+   }
+   if (threads > RAON_PARALLEL_MAX_THREADS) {
+      threads = RAON_PARALLEL_MAX_THREADS;
+   }
+   if (threads == 0) {
+      return 0;
+   }
+
+   struct raon_batch_queue queues[RAON_PARALLEL_MAX_THREADS];
+   struct raon_batch_worker workers[RAON_PARALLEL_MAX_THREADS];
+   for (size_t i = 0; i < threads; i++) {
+      atomic_init(&queues[i].range,
+          raon_batch_range((uint32_t)((uint64_t)count * i / threads),
+              (uint32_t)((uint64_t)count * (i + 1) / threads)));
+      workers[i] = (struct raon_batch_worker) {
+         .inputs = inputs,
+         .results = results,
+         .queues = queues,
+         .queue_count = threads,
+         .self = i,
+         .prefetch = options.prefetch,
+      };
+   }
+   raon_parallel_run(raon_batch_worker_task, workers, sizeof(workers[0]), threads);
+
+   size_t failed = 0;
+   for (size_t i = 0; i < threads; i++) {
+      failed += workers[i].failed;
+   }
+   return failed;
+}
@@ -1,9 +1,15 @@
+#include "internal.h"
 #include "raon.h"
-#include <ctype.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <stdlib.h>
 
+// texts below this size get a document arena sized after them, see `raon_document_new`
+#define RAON_DOCUMENT_SMALL_TEXT (16 * 1024)
+// rough number of bytes of tree that every byte of text turns into
+#define RAON_DOCUMENT_TREE_RATIO 2
+#define RAON_DOCUMENT_MIN_CHUNK_SIZE 512
+
 #define VEC_IMPLEMENTATION
 #define VEC_ITEM_TYPE struct raon_value
 #define VEC_SUFFIX raon_value
@@ -13,6 +19,15 @@
 #define VEC_SUFFIX raon_entry
 #include "../vendor/vector.h"
 
+// the `_sized` variants take a hint of how many items the parsed vector is expected to hold
+static struct raon_value raon_parse_value_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint);
+static struct vector_of_raon_value *raon_parse_array_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint);
+static struct vector_of_raon_entry *raon_parse_block_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint);
+static void raon_free_value(struct raon_value value);
+
 // returns true on success
 bool raon_is_valid_separator(
     struct raon_token first_token, const enum raon_token_type *optional_separator) {
@@ -51,7 +66,16 @@ struct raon_entry raon_parse_entry(
       if (!entry.value.block_val) {
          return error_val;
       }
-      vec_push_raon_entry(entry.value.block_val, raon_parse_entry(allocator, lexer, token));
+      const struct raon_entry inner = raon_parse_entry(allocator, lexer, token);
+      if (inner.key_type == raon_key_type_error) {
+         raon_free_entries(entry.value.block_val);
+         return error_val;
+      }
+      if (!vec_push_raon_entry(entry.value.block_val, inner)) {
+         raon_free_value(inner.value);
+         raon_free_entries(entry.value.block_val);
+         return error_val;
+      }
       return entry;
    }
    if (token.type != raon_token_type_equal) {
@@ -68,7 +92,13 @@ struct raon_entry raon_parse_entry(
    return entry;
 }
 
-struct raon_value raon_parse_value(struct vec_allocator allocator, struct raon_lexer *lexer, struct raon_token first_token) {
+struct raon_value raon_parse_value(
+    struct vec_allocator allocator, struct raon_lexer *lexer, struct raon_token first_token) {
+   return raon_parse_value_sized(allocator, lexer, first_token, 0);
+}
+
+static struct raon_value raon_parse_value_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint) {
    const struct raon_value error_val = { .type = raon_value_type_error };
 
    struct raon_value val = { 0 };
@@ -92,16 +122,37 @@ struct raon_value raon_parse_value(struct vec_allocator allocator, struct raon_l
    case raon_token_type_int:
       val.type = raon_value_type_int;
       val.int_val = first_token.int_val;
+      val.int_base = first_token.int_base;
       break;
 
    case raon_token_type_block_open:
       val.type = raon_value_type_block;
-      val.block_val = raon_parse_block(allocator, lexer, first_token);
+      if (lexer->lazy) {
+         val.lazy = true;
+         if (!raon_lexer_skip_nested(lexer, &val.lazy_text)) {
+            return error_val;
+         }
+         break;
+      }
+      val.block_val = raon_parse_block_sized(allocator, lexer, first_token, size_hint);
+      if (!val.block_val) {
+         return error_val;
+      }
       break;
 
    case raon_token_type_array_open:
       val.type = raon_value_type_array;
-      val.array_val = raon_parse_array(allocator, lexer, first_token);
+      if (lexer->lazy) {
+         val.lazy = true;
+         if (!raon_lexer_skip_nested(lexer, &val.lazy_text)) {
+            return error_val;
+         }
+         break;
+      }
+      val.array_val = raon_parse_array_sized(allocator, lexer, first_token, size_hint);
+      if (!val.array_val) {
+         return error_val;
+      }
       break;
 
    default:
@@ -113,11 +164,24 @@ struct raon_value raon_parse_value(struct vec_allocator allocator, struct raon_l
 
 struct vector_of_raon_value *raon_parse_array(
     struct vec_allocator allocator, struct raon_lexer *lexer, struct raon_token first_token) {
+   return raon_parse_array_sized(allocator, lexer, first_token, 0);
+}
+
+static struct vector_of_raon_value *raon_parse_array_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint) {
    if (first_token.type != raon_token_type_array_open) {
       return NULL;
    }
 
+   // the hint only sizes the first allocation, which is packed or not depending on the first item
    struct vector_of_raon_value *values = vec_new_raon_value(allocator);
+   if (!values) {
+      return NULL;
+   }
+
+   // arrays are homogeneous, so nested blocks and arrays are usually shaped like their previous
+   // sibling (rows of a matrix, lists of records) and its length is used to presize the next one
+   size_t item_size_hint = 0;
 
    for (;;) {
       struct raon_token token = raon_lexer_eat(lexer);
@@ -125,17 +189,30 @@ struct vector_of_raon_value *raon_parse_array(
          break;
       }
 
-      struct raon_value val = raon_parse_value(allocator, lexer, token);
+      // arrays are homogeneous, so an item of another type than the first one fails right away
+      struct raon_value val = raon_parse_value_sized(allocator, lexer, token, item_size_hint);
       if (val.type == raon_value_type_error) {
-         vec_free_raon_value(values);
+         raon_free_values(values);
          return NULL;
       }
-      vec_push_raon_value(values, val);
+      if ((raon_array_len(values) > 0 && val.type != raon_array_get(values, 0).type)
+          || !raon_array_push(values, val, size_hint)) {
+         raon_free_value(val);
+         raon_free_values(values);
+         return NULL;
+      }
+      if (val.lazy) {
+         item_size_hint = 0;
+      } else if (val.type == raon_value_type_block) {
+         item_size_hint = vec_len_raon_entry(val.block_val);
+      } else if (val.type == raon_value_type_array) {
+         item_size_hint = raon_array_len(val.array_val);
+      }
 
       token = raon_lexer_eat(lexer);
       const enum raon_token_type array_close = raon_token_type_array_close;
       if (!raon_is_valid_separator(token, &array_close)) {
-         vec_free_raon_value(values);
+         raon_free_values(values);
          return NULL;
       }
       if (token.type == raon_token_type_array_close) {
@@ -143,27 +220,32 @@ struct vector_of_raon_value *raon_parse_array(
       }
    }
 
-   // do type checking
-   if (vec_len_raon_value(values) > 1) {
-      struct raon_value value1, value2;
-      vec_get_raon_value(values, 0, &value1);
-      for (size_t i = 1; i < vec_len_raon_value(values); i++) {
-         vec_get_raon_value(values, i, &value2);
-         if (value1.type != value2.type) {
-            vec_free_raon_value(values);
-            return NULL;
-         }
-      }
-   }
-
    return values;
 }
 
+// frees the block or array that a value holds, for values that were never put in a vector
+static void raon_free_value(struct raon_value value) {
+   switch (value.lazy ? raon_value_type_error : value.type) {
+   case raon_value_type_array:
+      raon_free_values(value.array_val);
+      break;
+
+   case raon_value_type_block:
+      raon_free_entries(value.block_val);
+      break;
+
+   default:
+      // do nothing
+      break;
+   }
+}
+
 void raon_free_values(struct vector_of_raon_value *values) {
    for (size_t i = 0; i < vec_len_raon_value(values); i++) {
-      struct raon_value value;
+      struct raon_value value = { 0 };
       vec_get_raon_value(values, i, &value);
-      switch (value.type) {
+      // lazy values are still text, there's nothing of theirs to free
+      switch (value.lazy ? raon_value_type_error : value.type) {
       case raon_value_type_array:
          raon_free_values(value.array_val);
          break;
@@ -177,14 +259,17 @@ void raon_free_values(struct vector_of_raon_value *values) {
          break;
       }
    }
+   if (values) {
+      raon_packed_free(values);
+   }
    vec_free_raon_value(values);
 }
 
 void raon_free_entries(struct vector_of_raon_entry *entries) {
    for (size_t i = 0; i < vec_len_raon_entry(entries); i++) {
-      struct raon_entry entry;
+      struct raon_entry entry = { 0 };
       vec_get_raon_entry(entries, i, &entry);
-      switch (entry.value.type) {
+      switch (entry.value.lazy ? raon_value_type_error : entry.value.type) {
       case raon_value_type_block:
          raon_free_entries(entry.value.block_val);
          break;
@@ -198,36 +283,177 @@ void raon_free_entries(struct vector_of_raon_entry *entries) {
          break;
       }
    }
+   raon_block_free_index(entries);
    vec_free_raon_entry(entries);
 }
 
-static bool raon_entry_types_match(struct vector_of_raon_entry *entries) {
-   if (vec_len_raon_entry(entries) <= 1) {
+/*
+   Parses a lazy value in place, values that aren't lazy are left alone.
+   With `lazy` set what is nested inside of it is skipped in turn, so that only one level is
+   parsed at a time, otherwise the whole value is parsed in one go.
+*/
+static bool raon_value_materialize(
+    struct vec_allocator allocator, struct raon_value *value, bool lazy) {
+   if (!value->lazy) {
+      return true;
+   }
+
+   struct raon_lexer lexer = raon_lexer_init(value->lazy_text.ptr, value->lazy_text.len);
+   lexer.lazy = lazy;
+   const struct raon_token open = raon_lexer_eat(&lexer);
+   struct raon_value parsed = { .type = value->type };
+   if (value->type == raon_value_type_block) {
+      parsed.block_val = raon_parse_block(allocator, &lexer, open);
+      if (!parsed.block_val) {
+         return false;
+      }
+   } else {
+      parsed.array_val = raon_parse_array(allocator, &lexer, open);
+      if (!parsed.array_val) {
+         return false;
+      }
+   }
+   // a mismatched bracket can close the value before the end of its text
+   if (raon_lexer_eat(&lexer).type != raon_token_type_eof) {
+      raon_free_value(parsed);
+      return false;
+   }
+   *value = parsed;
+   return true;
+}
+
+/*
+   Looks up the entry of `entries` that has the same key as `entry`, without adding anything.
+
+   Inputs:
+   - `existing`: set to the value of the earlier entry with that key, or to NULL if there's none
+
+   Returns: false if `entry` can't go into the block, because its key type differs from the
+   block's or its key is taken by a value that it can't be merged with. Blocks that can be merged
+   are materialized if they're lazy.
+*/
+static bool raon_push_target(struct vector_of_raon_entry *entries, struct raon_entry *entry,
+    struct raon_value **existing) {
+   *existing = NULL;
+   if (vec_is_empty_raon_entry(entries)) {
+      return true;
+   }
+   if (entries->vec[0].key_type != entry->key_type) {
+      return false;
+   }
+
+   *existing = entry->key_type == raon_key_type_string
+       ? raon_block_get(entries, entry->str_key.ptr, entry->str_key.len)
+       : raon_block_get_int(entries, entry->int_key);
+   if (!*existing) {
       return true;
    }
-   struct raon_entry entry1, entry2;
-   vec_get_raon_entry(entries, 0, &entry1);
-   for (size_t i = 1; i < vec_len_raon_entry(entries); i++) {
-      vec_get_raon_entry(entries, i, &entry2);
-      if (entry1.key_type != entry2.key_type) {
+   if ((*existing)->type != raon_value_type_block || entry->value.type != raon_value_type_block) {
+      return false;
+   }
+   // lazy blocks can't be merged without their entries
+   return raon_value_materialize(entries->allocator, *existing, true)
+       && raon_value_materialize(entries->allocator, &entry->value, true);
+}
+
+/*
+   Checks every entry of `merged` against `block` before anything is moved, and makes room in
+   `block` and in the blocks nested in it for the entries that are added to them, so that
+   `raon_merge_blocks` can't fail halfway through.
+*/
+static bool raon_merge_prepare(
+    struct vector_of_raon_entry *block, struct vector_of_raon_entry *merged) {
+   size_t added = 0;
+   for (size_t i = 0; i < merged->len; i++) {
+      struct raon_value *existing;
+      if (!raon_push_target(block, &merged->vec[i], &existing)) {
+         return false;
+      }
+      if (!existing) {
+         added++;
+      } else if (!raon_merge_prepare(existing->block_val, merged->vec[i].value.block_val)) {
          return false;
       }
    }
+   return vec_reserve_raon_entry(block, added);
+}
+
+// moves the entries of `merged` into `block` once `raon_merge_prepare` went through
+static void raon_merge_blocks(
+    struct vector_of_raon_entry *block, struct vector_of_raon_entry *merged) {
+   for (size_t i = 0; i < merged->len; i++) {
+      struct raon_value *existing;
+      raon_push_target(block, &merged->vec[i], &existing);
+      if (existing) {
+         raon_merge_blocks(existing->block_val, merged->vec[i].value.block_val);
+      } else {
+         vec_push_raon_entry(block, merged->vec[i]);
+      }
+   }
+   // only the block itself goes away, its entries now belong to the earlier one
+   raon_block_free_index(merged);
+   vec_free_raon_entry(merged);
+}
+
+/*
+   Appends an entry to a block after checking it against the entries that are already there, so
+   that a bad entry fails parsing as soon as it's read:
+   - every key of a block has the type of the first one
+   - keys are unique, except that a block assigned to the key of an earlier block is merged into
+     it, so `a.b = 1` followed by `a.c = 2` gives a single `a = { b = 1, c = 2 }`
+
+   Earlier keys are found through the block's key index, which keeps this linear.
+   Merges either go through whole or leave both blocks as they were, so that a rejected entry is
+   still the caller's to free.
+*/
+bool raon_push_entry(struct vector_of_raon_entry *entries, struct raon_entry entry) {
+   const struct raon_value original = entry.value;
+   struct raon_value *existing;
+   if (!raon_push_target(entries, &entry, &existing)) {
+      // a lazy block that was materialized here isn't the one the caller knows about
+      if (original.lazy && !entry.value.lazy) {
+         raon_free_value(entry.value);
+      }
+      return false;
+   }
+   if (!existing) {
+      return vec_push_raon_entry(entries, entry);
+   }
+
+   if (!raon_merge_prepare(existing->block_val, entry.value.block_val)) {
+      if (original.lazy) {
+         raon_free_value(entry.value);
+      }
+      return false;
+   }
+   raon_merge_blocks(existing->block_val, entry.value.block_val);
    return true;
 }
 
 struct vector_of_raon_entry *raon_parse_block(
     struct vec_allocator allocator, struct raon_lexer *lexer, struct raon_token first_token) {
+   return raon_parse_block_sized(allocator, lexer, first_token, 0);
+}
+
+static struct vector_of_raon_entry *raon_parse_block_sized(struct vec_allocator allocator,
+    struct raon_lexer *lexer, struct raon_token first_token, size_t size_hint) {
    if (first_token.type != raon_token_type_block_open) {
       return NULL;
    }
 
    struct vector_of_raon_entry *entries = vec_new_raon_entry(allocator);
+   if (!entries) {
+      return NULL;
+   }
+   if (!vec_reserve_raon_entry(entries, size_hint)) {
+      vec_free_raon_entry(entries);
+      return NULL;
+   }
 
    for (;;) {
       struct raon_token token = raon_lexer_eat(lexer);
       if (token.type == raon_token_type_error || token.type == raon_token_type_eof) {
-         vec_free_raon_entry(entries);
+         raon_free_entries(entries);
          return NULL;
       }
       if (token.type == raon_token_type_block_close) {
@@ -239,15 +465,19 @@ struct vector_of_raon_entry *raon_parse_block(
 
       struct raon_entry entry = raon_parse_entry(allocator, lexer, token);
       if (entry.key_type == raon_key_type_error) {
-         vec_free_raon_entry(entries);
+         raon_free_entries(entries);
+         return NULL;
+      }
+      if (!raon_push_entry(entries, entry)) {
+         raon_free_value(entry.value);
+         raon_free_entries(entries);
          return NULL;
       }
-      vec_push_raon_entry(entries, entry);
 
       token = raon_lexer_eat(lexer);
       const enum raon_token_type block_close = raon_token_type_block_close;
       if (!raon_is_valid_separator(token, &block_close)) {
-         vec_free_raon_entry(entries);
+         raon_free_entries(entries);
          return NULL;
       }
       if (token.type == raon_token_type_block_close) {
@@ -255,151 +485,175 @@ struct vector_of_raon_entry *raon_parse_block(
       }
    }
 
-   if (!raon_entry_types_match(entries)) {
-      vec_free_raon_entry(entries);
+   if (vec_len_raon_entry(entries) >= RAON_BLOCK_INDEX_THRESHOLD
+       && !raon_block_build_index(entries)) {
+      raon_free_entries(entries);
       return NULL;
    }
    return entries;
 }
 
-struct vector_of_raon_entry *raon_parse(struct vec_allocator allocator, char *str, size_t len) {
-   struct raon_lexer lexer = raon_lexer_init(str, len);
-
-   struct vector_of_raon_entry *entries = vec_new_raon_entry(allocator);
+bool raon_parse_entries_into(struct vec_allocator allocator, struct raon_lexer *lexer,
+    struct vector_of_raon_entry *entries, bool check_keys) {
    for (;;) {
-      struct raon_token token = raon_lexer_eat(&lexer);
+      struct raon_token token = raon_lexer_eat(lexer);
       if (token.type == raon_token_type_eof) {
-         break;
+         return true;
       }
       if (token.type == raon_token_type_newline) {
          continue;
       }
       if (token.type == raon_token_type_error) {
-         return NULL;
+         return false;
       }
 
-      struct raon_entry entry = raon_parse_entry(allocator, &lexer, token);
-      if (entry.value.type != raon_value_type_error) {
-         vec_push_raon_entry(entries, entry);
+      struct raon_entry entry = raon_parse_entry(allocator, lexer, token);
+      if (entry.key_type == raon_key_type_error) {
+         return false;
+      }
+      if (!(check_keys ? raon_push_entry(entries, entry) : vec_push_raon_entry(entries, entry))) {
+         raon_free_value(entry.value);
+         return false;
       }
 
-      token = raon_lexer_eat(&lexer);
-
+      token = raon_lexer_eat(lexer);
+      if (token.type == raon_token_type_eof) {
+         return true;
+      }
       if (!raon_is_valid_separator(token, NULL)) {
-         break;
+         return false;
       }
    }
+}
 
-   if (!raon_entry_types_match(entries)) {
+bool raon_finish_top_level(struct vector_of_raon_entry *entries) {
+   return vec_len_raon_entry(entries) < RAON_BLOCK_INDEX_THRESHOLD
+       || raon_block_build_index(entries);
+}
+
+struct vector_of_raon_entry *raon_parse(struct vec_allocator allocator, char *str, size_t len) {
+   struct raon_lexer lexer = raon_lexer_init(str, len);
+
+   struct vector_of_raon_entry *entries = vec_new_raon_entry(allocator);
+   if (!entries) {
+      return NULL;
+   }
+   if (!raon_parse_entries_into(allocator, &lexer, entries, true)
+       || !raon_finish_top_level(entries)) {
       raon_free_entries(entries);
       return NULL;
    }
-
    return entries;
 }
 
-static void raon_print_indentation(struct raon_print_ctx ctx) {
-   char *indent = ctx.indent ? ctx.indent : "   ";
-   for (size_t i = 0; i < ctx.indent_level; i++) {
-      printf("%s", indent);
+struct raon_document *raon_document_new(size_t text_len) {
+   // small documents start with an arena chunk about as big as their tree, instead of each one
+   // holding on to a whole default chunk
+   size_t chunk_size = 0;
+   if (text_len && text_len < RAON_DOCUMENT_SMALL_TEXT) {
+      chunk_size = RAON_DOCUMENT_TREE_RATIO * text_len + RAON_DOCUMENT_MIN_CHUNK_SIZE;
    }
-}
-
-void raon_print_value(struct raon_print_ctx ctx, struct raon_value value) {
-   switch (value.type) {
-   case raon_value_type_bool:
-      printf("%s", value.bool_val ? "true" : "false");
-      break;
+   // the document lives inside of its own arena, so the arena is moved into it right away
+   struct raon_arena arena = raon_arena_init(chunk_size);
+   struct raon_document *doc = raon_arena_alloc(&arena, sizeof(*doc));
+   if (!doc) {
+      raon_arena_free(&arena);
+      return NULL;
+   }
+   *doc = (struct raon_document) { .arena = arena };
 
-   case raon_value_type_int:
-      printf("%ld", value.int_val);
-      break;
+   doc->entries = vec_new_raon_entry(raon_arena_allocator(&doc->arena));
+   if (!doc->entries) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
 
-   case raon_value_type_float:
-      printf("%lf", value.float_val);
-      break;
+static struct raon_document *raon_parse_document_with(char *str, size_t len, bool lazy) {
+   struct raon_document *doc = raon_document_new(len);
+   if (!doc) {
+      return NULL;
+   }
 
-   case raon_value_type_string: {
-      struct raon_str_slice str = value.str_val;
-      printf("\"%.*s\"", (int)str.len, str.ptr);
-   } break;
+   struct raon_lexer lexer = raon_lexer_init(str, len);
+   lexer.lazy = lazy;
+   if (!raon_parse_entries_into(raon_arena_allocator(&doc->arena), &lexer, doc->entries, true)
+       || !raon_finish_top_level(doc->entries)) {
+      raon_document_free(doc);
+      return NULL;
+   }
+   return doc;
+}
 
-   case raon_value_type_array:
-      raon_print_array(ctx, value.array_val);
-      break;
+struct raon_document *raon_parse_document(char *str, size_t len) {
+   return raon_parse_document_with(str, len, false);
+}
 
-   case raon_value_type_block:
-      printf("{\n");
-      ++ctx.indent_level;
-      raon_print_entries(ctx, value.block_val);
-      --ctx.indent_level;
-      raon_print_indentation(ctx);
-      printf("}");
-      break;
+struct raon_document *raon_parse_document_lazy(char *str, size_t len) {
+   return raon_parse_document_with(str, len, true);
+}
 
-   case raon_value_type_error:
-      printf("(unsupported type)");
-      break;
+struct vector_of_raon_entry *raon_value_block(struct raon_document *doc, struct raon_value *value) {
+   if (value->type != raon_value_type_block
+       || !raon_value_materialize(raon_arena_allocator(&doc->arena), value, true)) {
+      return NULL;
    }
+   return value->block_val;
 }
 
-void raon_print_array(struct raon_print_ctx ctx, struct vector_of_raon_value *array) {
-   if (!array) {
-      printf("[]");
-      return;
+struct vector_of_raon_value *raon_value_array(struct raon_document *doc, struct raon_value *value) {
+   if (value->type != raon_value_type_array
+       || !raon_value_materialize(raon_arena_allocator(&doc->arena), value, true)) {
+      return NULL;
    }
+   return value->array_val;
+}
 
-   printf("[");
-   for (size_t i = 0; i < vec_len_raon_value(array); i++) {
-      struct raon_value val;
-      vec_get_raon_value(array, i, &val);
-      raon_print_value(ctx, val);
-      if (i < vec_len_raon_value(array) - 1) {
-         printf(", ");
-      }
+static bool raon_expand_value(struct raon_document *doc, struct raon_value *value) {
+   // a lazy value is parsed all the way down at once, parsing it one level at a time would lex
+   // what is nested deep inside of it again for every level above
+   if (value->lazy) {
+      return raon_value_materialize(raon_arena_allocator(&doc->arena), value, false);
    }
-   printf("]");
-}
 
-void raon_print_entry(struct raon_print_ctx ctx, struct raon_entry entry) {
-   raon_print_indentation(ctx);
-   switch (entry.key_type) {
-   case raon_key_type_string: {
-      struct raon_str_slice str = entry.str_key;
-      bool contains_whitespace = false;
-      for (size_t i = 0; i < entry.str_key.len; i++) {
-         if (isspace(str.ptr[i])) {
-            contains_whitespace = true;
+   // values that were already accessed can still hold lazy values further down
+   if (value->type == raon_value_type_block) {
+      for (size_t i = 0; i < value->block_val->len; i++) {
+         if (!raon_expand_value(doc, &value->block_val->vec[i].value)) {
+            return false;
          }
       }
-
-      if (contains_whitespace) {
-         printf("\"%.*s\" = ", (int)str.len, str.ptr);
-      } else {
-         printf("%.*s = ", (int)str.len, str.ptr);
+   } else if (value->type == raon_value_type_array) {
+      for (size_t i = 0; i < value->array_val->len; i++) {
+         if (!raon_expand_value(doc, &value->array_val->vec[i])) {
+            return false;
+         }
       }
-   } break;
-
-   case raon_key_type_num:
-      printf("%lu = ", entry.int_key);
-      break;
-
-   case raon_key_type_error:
-      printf("(unsupported type) = ");
    }
+   return true;
+}
 
-   raon_print_value(ctx, entry.value);
-   printf("\n");
+bool raon_document_expand(struct raon_document *self) {
+   for (size_t i = 0; i < self->entries->len; i++) {
+      if (!raon_expand_value(self, &self->entries->vec[i].value)) {
+         return false;
+      }
+   }
+   return true;
 }
 
-void raon_print_entries(struct raon_print_ctx ctx, struct vector_of_raon_entry *entries) {
-   if (!entries) {
-      printf("(null)");
+void raon_document_free(struct raon_document *self) {
+   if (!self) {
       return;
    }
-   for (size_t i = 0; i < vec_len_raon_entry(entries); i++) {
-      struct raon_entry entry;
-      vec_get_raon_entry(entries, i, &entry);
-      raon_print_entry(ctx, entry);
+   if (self->mapping) {
+      raon_file_unmap(self->mapping, self->mapping_len);
+   }
+   for (size_t i = 0; i < self->thread_arena_count; i++) {
+      raon_arena_free(&self->thread_arenas[i]);
    }
+   // `self` is allocated inside of the arena so it can't be touched once freeing starts
+   struct raon_arena arena = self->arena;
+   raon_arena_free(&arena);
 }
@@ -7,6 +7,7 @@ extern "C" {
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
 #include <string.h>
 
 // === String Slice ===
@@ -40,6 +41,9 @@ char *raon_str_from_slice(struct raon_str_slice slice);
 
    Returns: `{0}` if slice overflows string
 
+   Note: only the first `len` bytes of `str` are read, so `str` doesn't need to be NUL terminated
+   as long as it has at least `len` bytes.
+
    Example:
 
    char *str[] = "hello world";
@@ -78,10 +82,15 @@ enum raon_token_type {
    raon_token_type_error,
 };
 
+/*
+   Tokens only know where they are as byte offsets into the lexed text, going from their first byte
+   to right after their last one. See `raon_lexer_position` to turn them into lines and columns.
+*/
 struct raon_token {
-   size_t start_line, start_col;
-   size_t end_line, end_col;
+   size_t start, end;
    enum raon_token_type type;
+   // base an int was written in: 2, 8, 16, or 0 for decimal
+   uint8_t int_base;
    union {
       struct raon_str_slice str_val;
       intptr_t int_val;
@@ -92,14 +101,17 @@ struct raon_token {
 };
 
 struct raon_lexer {
-   size_t line, col;
    size_t idx, str_len;
    char *str;
+   // nested blocks and arrays are skipped instead of parsed, see `raon_parse_document_lazy`
+   bool lazy;
 };
 
 /*
    Inputs:
    - `str`: string to start of contents that will be lexed
+   - `len`: number of bytes in `str`, the lexer never reads past it so `str` doesn't have to be
+   NUL terminated
 */
 struct raon_lexer raon_lexer_init(char *str, size_t len);
 
@@ -109,15 +121,46 @@ struct raon_token raon_lexer_lex_string(struct raon_lexer *self);
 struct raon_token raon_lexer_lex_ident(struct raon_lexer *self);
 void raon_lexer_ignore_comment(struct raon_lexer *self);
 
-// === Parser ===
+// lines start at 1, columns count the bytes between the start of the line and the position
+struct raon_position {
+   size_t line, col;
+};
 
-#define VEC_ITEM_TYPE struct raon_value
-#define VEC_SUFFIX raon_value
-#include "../vendor/vector.h"
+/*
+   Finds the line and column of a byte offset, such as the start of a token.
+   The lexer doesn't keep track of lines, so the newlines before `offset` are counted every time.
+   Use a `raon_line_table` to look up many positions in the same text.
+*/
+struct raon_position raon_lexer_position(const struct raon_lexer *self, size_t offset);
 
-#define VEC_ITEM_TYPE struct raon_entry
-#define VEC_SUFFIX raon_entry
-#include "../vendor/vector.h"
+/*
+   Offsets of the lines of a text, used to look up many positions without counting newlines from
+   the start of the text each time.
+   The text is only searched for newlines up to the furthest position asked for so far.
+*/
+struct raon_line_table {
+   const char *str;
+   size_t str_len;
+   // offset of the first byte of every line found so far
+   size_t *starts;
+   size_t len, capacity;
+   // number of bytes already searched for newlines
+   size_t scanned;
+};
+
+// doesn't allocate, nothing is searched until the first lookup
+struct raon_line_table raon_line_table_init(const char *str, size_t len);
+
+/*
+   Inputs:
+   - `offset`: byte offset into the text, offsets past its end are clamped to the end
+
+   Note: if the table can't grow, the position is found the same way as `raon_lexer_position`.
+*/
+struct raon_position raon_line_table_position(struct raon_line_table *self, size_t offset);
+void raon_line_table_free(struct raon_line_table *self);
+
+// === Parser ===
 
 enum raon_value_type {
    raon_value_type_string,
@@ -129,15 +172,61 @@ enum raon_value_type {
    raon_value_type_error,
 };
 
+/*
+   Items of an array of ints, floats or bools, which are stored back to back instead of as
+   `raon_value`s, see `raon_array_as_ints`.
+*/
+struct raon_packed_items {
+   // type of every item, only meaningful when `len` isn't 0
+   enum raon_value_type type;
+   // base the ints were written in, as long as they were all written in the same one
+   uint8_t int_base;
+   // base of every int, only allocated once ints written in different bases are packed together
+   uint8_t *int_bases;
+   // number of items, 0 when the array keeps its items in `vec` instead
+   size_t len;
+   // number of items that fit before the items have to grow
+   size_t capacity;
+   union {
+      intptr_t *ints;
+      double *floats;
+      // bool `i` is bit `i % 8` of byte `i / 8`
+      uint8_t *bools;
+   };
+};
+
+#define VEC_ITEM_TYPE struct raon_value
+#define VEC_SUFFIX raon_value
+// packed items of the array, arrays only use either `vec` or `packed`, see `raon_array_get`
+#define VEC_EXTRA_FIELDS struct raon_packed_items packed;
+#include "../vendor/vector.h"
+
+struct raon_block_index;
+
+#define VEC_ITEM_TYPE struct raon_entry
+#define VEC_SUFFIX raon_entry
+// key index of the block, only present for blocks that are big enough, see `raon_block_get`
+#define VEC_EXTRA_FIELDS struct raon_block_index *index;
+#include "../vendor/vector.h"
+
 struct raon_value {
    enum raon_value_type type;
+   // base an int was written in: 2, 8, 16, or 0 for decimal
+   uint8_t int_base;
+   // a block or array that hasn't been parsed yet, see `raon_value_block`
+   bool lazy;
    union {
       struct raon_str_slice str_val;
       intptr_t int_val;
       bool bool_val;
       double float_val;
       struct vector_of_raon_entry *block_val;
+      // items are read with `raon_array_len` and `raon_array_get`: arrays of ints, floats and
+      // bools keep their items in `packed` and leave `vec` empty, so `vec_len_raon_value`,
+      // `vec_get_raon_value` and `->vec` see no items at all for them
       struct vector_of_raon_value *array_val;
+      // text of a lazy value, brackets included
+      struct raon_str_slice lazy_text;
    };
 };
 
@@ -163,9 +252,11 @@ struct vector_of_raon_entry *raon_parse_block(struct vec_allocator allocator, st
 
 /*
    Parses text into a Raon AST.
+   Blocks assigned to the same key of a block, such as those of `a.b = 1` and `a.c = 2`, are
+   merged into the first one. Any other repeated key is an error.
 
    Inputs:
-   - `str`: string buffer that should be parsed
+   - `str`: string buffer that should be parsed, it doesn't have to be NUL terminated
    - `len`:size of `str`
 
    Returns: NULL if parsing failed
@@ -175,6 +266,316 @@ struct vector_of_raon_entry *raon_parse(struct vec_allocator allocator, char *st
 void raon_free_values(struct vector_of_raon_value *values);
 void raon_free_entries(struct vector_of_raon_entry *entries);
 
+// === Events ===
+
+struct raon_key {
+   enum raon_key_type type;
+   union {
+      struct raon_str_slice str_key;
+      intptr_t int_key;
+   };
+};
+
+/*
+   Callbacks for `raon_parse_events`, any of them can be NULL.
+   Every callback returns false to stop parsing right away.
+
+   A dotted key such as `a.b = 1` is reported the same way as `a = { b = 1 }`. Nothing is kept
+   between events, so unlike the parsers, blocks repeated under the same key aren't merged and
+   repeated keys aren't an error.
+*/
+struct raon_handler {
+   // passed as the first argument of every callback
+   void *ctx;
+   bool (*on_key)(void *ctx, struct raon_key key);
+   // only strings, ints, bools and floats are reported here
+   bool (*on_value)(void *ctx, struct raon_value value);
+   bool (*on_block_begin)(void *ctx);
+   bool (*on_block_end)(void *ctx);
+   bool (*on_array_begin)(void *ctx);
+   bool (*on_array_end)(void *ctx);
+};
+
+enum raon_parse_status {
+   raon_parse_status_ok,
+   // a callback returned false
+   raon_parse_status_stopped,
+   raon_parse_status_error,
+};
+
+// deepest nesting of blocks and arrays that `raon_parse_events` and `raon_validate` accept, each
+// dot of a dotted key counts as one block
+#define RAON_EVENTS_MAX_DEPTH 512
+
+/*
+   Parses text without building an AST, the handler is called for every node as it's parsed.
+   The same documents as `raon_parse` are accepted, so type errors are still reported, but they
+   can be reported after callbacks already saw part of the offending block or array.
+
+   Inputs:
+   - `str`: string buffer that should be parsed, it doesn't have to be NUL terminated
+   - `len`: size of `str`
+
+   Returns: `raon_parse_status_error` for invalid text, which includes nesting deeper than
+   `RAON_EVENTS_MAX_DEPTH`
+
+   Note: memory use only grows with the nesting depth of the document, nothing is allocated.
+*/
+enum raon_parse_status raon_parse_events(
+    char *str, size_t len, const struct raon_handler *handler);
+
+enum raon_error_kind {
+   raon_error_kind_none,
+   // a token that can't be lexed, such as a malformed number or an unterminated string
+   raon_error_kind_invalid_token,
+   // a token that the grammar doesn't allow where it is
+   raon_error_kind_unexpected_token,
+   // the text ended in the middle of an entry, block or array
+   raon_error_kind_unexpected_end,
+   // an array item of another type than the first item of the array
+   raon_error_kind_mixed_array,
+   // a key of another type than the first key of its block
+   raon_error_kind_mixed_keys,
+   // a value of another type than the field it's decoded into, see `raon_decode`
+   raon_error_kind_type_mismatch,
+   // an array with more items than the fixed array it's decoded into has room for
+   raon_error_kind_too_many_items,
+   raon_error_kind_out_of_memory,
+   // blocks and arrays nested deeper than `RAON_EVENTS_MAX_DEPTH`, see `raon_validate`
+   raon_error_kind_too_deep,
+};
+
+struct raon_error {
+   enum raon_error_kind kind;
+   // byte offset of the token the error was found at, see `raon_lexer_position`
+   size_t offset;
+};
+
+/*
+   Checks whether text is a valid Raon document without building anything, which makes it a lot
+   cheaper than parsing it and freeing the result.
+
+   Inputs:
+   - `str`: string buffer that should be checked, it doesn't have to be NUL terminated
+   - `len`: size of `str`
+   - `error`: if not NULL, it's set to the first error found, or to `raon_error_kind_none`
+
+   Returns: false if the text isn't valid, including when it nests deeper than
+   `RAON_EVENTS_MAX_DEPTH`
+
+   Note: this goes through `raon_parse_events`, so nothing is allocated and memory use only grows
+   with the nesting depth. For the same reason repeated keys aren't an error, finding them would
+   mean keeping every key around. Blocks that dotted keys merge together are only known once
+   their keys are kept as well, so key types are checked within each block as it's written:
+   `a.b = 1` followed by `a.2 = 3` passes here, while parsing it fails on mixed keys.
+*/
+bool raon_validate(const char *str, size_t len, struct raon_error *error);
+
+// === Schemas ===
+
+enum raon_field_type {
+   // `intptr_t`
+   raon_field_type_int,
+   // `double`
+   raon_field_type_float,
+   // `bool`
+   raon_field_type_bool,
+   // `struct raon_str_slice` pointing into the decoded text
+   raon_field_type_string,
+   // a struct described by the field's `schema`, decoded from a block
+   raon_field_type_struct,
+   // an array of at most `capacity` items stored in the struct itself
+   raon_field_type_fixed_array,
+   // a pointer to items allocated while decoding, see `raon_decode`
+   raon_field_type_dynamic_array,
+};
+
+struct raon_schema;
+
+/*
+   Describes where the value of a key goes in a struct, for example:
+   `{ .key = "port", .type = raon_field_type_int, .offset = offsetof(struct server, port) }`
+*/
+struct raon_field {
+   const char *key;
+   enum raon_field_type type;
+   // position of the field in its struct, from `offsetof`
+   size_t offset;
+   // fields of structs, or of the items of arrays of structs
+   const struct raon_schema *schema;
+   // the rest is only used by arrays, whose items can't be arrays themselves
+   enum raon_field_type item_type;
+   // most items that fit in a fixed array
+   size_t capacity;
+   // position of the `size_t` that the number of items is stored in
+   size_t len_offset;
+};
+
+struct raon_schema {
+   const struct raon_field *fields;
+   size_t field_count;
+   // size of the struct, which is how far apart the items of arrays of this struct are
+   size_t size;
+};
+
+// longest key path stored in a `raon_decode_error`, longer ones are cut short
+#define RAON_DECODE_PATH_MAX 128
+
+struct raon_decode_error {
+   struct raon_error error;
+   // keys and array indices leading to the error, such as `servers[2].port`, or empty at the top
+   char path[RAON_DECODE_PATH_MAX];
+};
+
+/*
+   Decodes text straight into a struct described by `schema`, without building an AST.
+   Values are type checked against their fields, keys missing from the schema are skipped, and
+   keys missing from the text leave their fields as they were, so `target` can be filled with
+   default values first.
+
+   Inputs:
+   - `str`: string buffer that should be decoded, string fields point into it so it has to outlive
+   `target`. It doesn't have to be NUL terminated
+   - `len`: size of `str`
+   - `allocator`: used for the items of dynamic arrays
+   - `error`: if not NULL, it's set to the first error found, or to `raon_error_kind_none`
+
+   Returns: false if the text is invalid or doesn't match the schema
+
+   Note: dynamic array fields have to start out as NULL, an array that's already in one is freed
+   when the key repeats. Fixed arrays only have their items freed when the key repeats within the
+   same call, so their counts don't have to be initialized. Even when decoding fails, `target` can still be given to
+   `raon_schema_free`. Skipped values are only checked for balanced brackets and strings, and
+   repeated keys overwrite what was decoded before.
+*/
+bool raon_decode(char *str, size_t len, const struct raon_schema *schema, void *target,
+    struct vec_allocator allocator, struct raon_decode_error *error);
+
+// Frees the dynamic arrays that `raon_decode` allocated in `target` and sets them to NULL.
+void raon_schema_free(
+    const struct raon_schema *schema, void *target, struct vec_allocator allocator);
+
+// === Arrays ===
+
+// Number of items in an array, whether they're packed or not.
+size_t raon_array_len(const struct vector_of_raon_value *array);
+
+/*
+   Returns the item of an array at `index`, packed items are copied into a `raon_value`.
+
+   Returns: a value of type `raon_value_type_error` if `index` is out of bounds
+*/
+struct raon_value raon_array_get(const struct vector_of_raon_value *array, size_t index);
+
+/*
+   Views the items of an array of ints without copying them.
+   The parser packs every array of ints, floats or bools. Ints written in different bases are
+   packed as well, each with its own base, see `raon_packed_items.int_bases`.
+
+   Inputs:
+   - `items`: set to the first item, it stays valid as long as the array isn't modified
+   - `len`: set to the number of items
+
+   Returns: false if the array isn't packed or holds another type, empty arrays have no type and
+   are views of 0 items of any type
+
+   Example:
+
+   const intptr_t *items;
+   size_t len;
+   if (raon_array_as_ints(value.array_val, &items, &len)) {
+      for (size_t i = 0; i < len; i++) {
+         sum += items[i];
+      }
+   }
+*/
+bool raon_array_as_ints(
+    const struct vector_of_raon_value *array, const intptr_t **items, size_t *len);
+// Same as `raon_array_as_ints` for arrays of floats.
+bool raon_array_as_floats(
+    const struct vector_of_raon_value *array, const double **items, size_t *len);
+// Same as `raon_array_as_ints` for arrays of bools, bool `i` is bit `i % 8` of `bits[i / 8]`.
+bool raon_array_as_bools(
+    const struct vector_of_raon_value *array, const uint8_t **bits, size_t *len);
+
+// === Block Lookup ===
+
+// Blocks with at least this many entries get a hash index, smaller ones are scanned linearly.
+#define RAON_BLOCK_INDEX_THRESHOLD 16
+
+/*
+   Finds the value stored under a string key.
+
+   Inputs:
+   - `key`: key to look for, it doesn't have to be NUL terminated
+   - `len`: size of `key`
+
+   Returns: NULL if the block has no such key
+
+   Note: The parser indexes big blocks as it builds them. Blocks that were assembled by hand get
+   indexed on their first lookup, so that first lookup must not race with other lookups.
+   The index assumes entries are only ever appended to the block.
+*/
+struct raon_value *raon_block_get(struct vector_of_raon_entry *block, const char *key, size_t len);
+
+/*
+   Finds the value stored under a number key.
+
+   Returns: NULL if the block has no such key
+*/
+struct raon_value *raon_block_get_int(struct vector_of_raon_entry *block, intptr_t key);
+
+/*
+   Builds (or catches up) the key index of `block`, it's allocated with the block's allocator.
+
+   Returns: false if allocation failed, or if the block mixes key types, which only blocks built by
+   hand can do, lookups then scan the block instead
+*/
+bool raon_block_build_index(struct vector_of_raon_entry *block);
+
+// Frees the key index of `block`, it's rebuilt by the next lookup if needed.
+void raon_block_free_index(struct vector_of_raon_entry *block);
+
+// === Writer ===
+
+// Where `raon_write` sends its output, it is written in large blocks instead of token by token.
+struct raon_sink {
+   // returns false if the data couldn't be written, which makes `raon_write` fail
+   bool (*write)(void *ctx, const char *data, size_t len);
+   void *ctx;
+};
+
+// Growable memory buffer that a sink can write into, `data` has to be freed by the user.
+struct raon_buffer {
+   char *data;
+   size_t len, capacity;
+};
+
+struct raon_sink raon_sink_file(FILE *file);
+// Writes to a file descriptor, short writes are retried.
+struct raon_sink raon_sink_fd(int fd);
+struct raon_sink raon_sink_buffer(struct raon_buffer *buffer);
+
+struct raon_write_options {
+   // everything on a single line without any spaces, otherwise blocks are split over lines
+   bool compact;
+   // indentation used per level when not compact, defaults to three spaces
+   const char *indent;
+   // ints that were written as `0b`, `0o` or `0x` literals are written back in the same base
+   bool keep_int_base;
+};
+
+/*
+   Serializes entries so that parsing the output gives back the same entries.
+
+   Returns: false if the sink failed, or if something can't be represented in Raon, such as a
+   string containing a `"`, or a float that is infinite or NaN, or if a lazy value wasn't expanded
+
+   Note: dotted keys are written out as the blocks they were parsed into.
+*/
+bool raon_write(const struct vector_of_raon_entry *entries, struct raon_sink sink,
+    struct raon_write_options options);
+
 /*
    Passed to print functions so that they can figure out how to properly do indentation
    and which whitespace indentation is preferred.
@@ -185,11 +586,417 @@ struct raon_print_ctx {
    size_t indent_level;
 };
 
+// The print functions write to stdout with `raon_write`'s pretty format.
 void raon_print_entry(struct raon_print_ctx ctx, struct raon_entry entry);
 void raon_print_value(struct raon_print_ctx ctx, struct raon_value value);
 void raon_print_array(struct raon_print_ctx ctx, struct vector_of_raon_value *array);
 void raon_print_entries(struct raon_print_ctx ctx, struct vector_of_raon_entry *entries);
 
+// === Arena ===
+
+struct raon_arena_chunk;
+
+/*
+   Bump allocator that hands out memory from a few large chunks.
+   Individual allocations are never freed, everything is released at once by `raon_arena_free`.
+*/
+struct raon_arena {
+   struct raon_arena_chunk *chunks;
+   // size of the next chunk, it doubles every time a new chunk is needed
+   size_t chunk_size;
+};
+
+/*
+   Inputs:
+   - `chunk_size`: size of the first chunk, 0 picks a default
+*/
+struct raon_arena raon_arena_init(size_t chunk_size);
+
+/*
+   Returns: NULL if allocation failed, memory is aligned for any type
+*/
+void *raon_arena_alloc(struct raon_arena *self, size_t size);
+
+// Releases every chunk owned by the arena, the arena can be reused afterwards.
+void raon_arena_free(struct raon_arena *self);
+
+/*
+   Returns an allocator that can be passed to the parser and vectors so that everything they
+   allocate lives in the arena. Calling its `free` is a no-op.
+*/
+struct vec_allocator raon_arena_allocator(struct raon_arena *self);
+
+// === Document ===
+
+/*
+   A parsed document together with the arena that owns all of its memory.
+   String slices in the document point into the parsed buffer, so it must outlive the document.
+*/
+struct raon_document {
+   struct raon_arena arena;
+   struct vector_of_raon_entry *entries;
+   // read-only mapping of the parsed file that the strings point into, see `raon_parse_file`
+   void *mapping;
+   size_t mapping_len;
+   // arenas that the threads of `raon_parse_document_parallel` parsed into, they're freed with it
+   struct raon_arena *thread_arenas;
+   size_t thread_arena_count;
+};
+
+/*
+   Parses text into a document that's backed by an arena.
+
+   Inputs:
+   - `str`: string buffer that should be parsed, it doesn't have to be NUL terminated
+   - `len`: size of `str`
+
+   Returns: NULL if parsing failed
+
+   Note: The document must be freed with `raon_document_free`.
+*/
+struct raon_document *raon_parse_document(char *str, size_t len);
+
+/*
+   Parses text into a document on several threads.
+   The text is split right after top-level entries, every thread parses its part into an arena of
+   its own and the entries are put back together in their original order. The result is the same
+   as the one of `raon_parse_document`, including which documents fail and which blocks are
+   indexed, so the document can be read from several threads at once as well.
+
+   Inputs:
+   - `threads`: most threads to use, 0 uses one per CPU. Texts under a few megabytes don't get
+   split as far, the smallest ones are parsed on the calling thread alone.
+
+   Returns: NULL if parsing failed
+
+   Note: The document must be freed with `raon_document_free`.
+*/
+struct raon_document *raon_parse_document_parallel(char *str, size_t len, size_t threads);
+
+// === Lazy Documents ===
+
+/*
+   Parses text into a document that only holds its top-level entries at first.
+   Blocks and arrays are skipped over by matching their brackets and kept as text, each one is
+   parsed on its first access through `raon_value_block` or `raon_value_array`, which skips what is
+   nested inside of it in turn.
+
+   Returns: NULL if parsing the top level failed, errors inside of a skipped value only show up
+   once it's accessed
+
+   Note: The document must be freed with `raon_document_free`. Accessing a lazy value allocates
+   in the document's arena, so a lazy document must not be read from several threads at once.
+*/
+struct raon_document *raon_parse_document_lazy(char *str, size_t len);
+
+/*
+   Returns the entries of a block value, parsing them first if the value is lazy.
+
+   Returns: NULL if `value` isn't a block or parsing it failed
+*/
+struct vector_of_raon_entry *raon_value_block(struct raon_document *doc, struct raon_value *value);
+
+/*
+   Returns the items of an array value, parsing them first if the value is lazy.
+
+   Returns: NULL if `value` isn't an array or parsing it failed
+*/
+struct vector_of_raon_value *raon_value_array(struct raon_document *doc, struct raon_value *value);
+
+/*
+   Parses every lazy value left in the document, which the writer and encoders need since they
+   don't write lazy values.
+
+   Returns: false if a lazy value failed to parse
+*/
+bool raon_document_expand(struct raon_document *self);
+
+// === Batch Parsing ===
+
+// A document for `raon_parse_batch`, either a file or a buffer that's already in memory.
+struct raon_batch_input {
+   // file to parse with `raon_parse_file`, if NULL `str` and `len` are parsed instead
+   const char *path;
+   char *str;
+   size_t len;
+};
+
+struct raon_batch_options {
+   // threads to use, 0 uses one per CPU
+   size_t threads;
+   // start reading the next file of a thread while it parses the current one
+   bool prefetch;
+};
+
+/*
+   Parses many documents at once on a pool of threads.
+   Every thread starts with an even share of the inputs and, once it's done with them, takes the
+   last inputs of the threads that are still busy, so a few big documents don't leave the other
+   threads idle.
+
+   Inputs:
+   - `results`: array of `count` documents, each one is set to the document parsed from the input at
+   the same index, or to NULL if that one failed
+
+   Returns: the number of documents that failed
+
+   Note: Every document must be freed with `raon_document_free`.
+*/
+size_t raon_parse_batch(const struct raon_batch_input *inputs, size_t count,
+    struct raon_document **results, struct raon_batch_options options);
+
+/*
+   Parses a file into a document.
+   Regular files are mapped into memory and parsed in place, the mapping is kept alive by the
+   document since its strings point into it. Anything else, such as pipes, is read in chunks
+   through the incremental parser.
+
+   Returns: NULL if the file couldn't be read or parsing failed
+
+   Note: The document must be freed with `raon_document_free`.
+*/
+struct raon_document *raon_parse_file(const char *path);
+
+// Frees the whole document at once, no matter how big the tree is.
+void raon_document_free(struct raon_document *self);
+
+// === Incremental Parser ===
+
+/*
+   Parses a document that arrives in chunks, such as one read from a pipe or a socket.
+   Chunks can be split anywhere, including in the middle of a token or a multiline string.
+
+   Top-level entries are parsed as soon as their last byte arrives, the top-level entry that is
+   still incomplete is staged until then.
+
+   Note: this doesn't bound memory use. Values point into the text, so the whole input ends up
+   copied into the document's arena and memory grows with the document just like it does when
+   parsing it all at once. Entries are also never parsed across chunks, so a single big entry such
+   as `root = { ... }` that wraps the whole document is staged in full and only parsed by
+   `raon_parser_finish`, needing about twice its size until then.
+*/
+struct raon_parser {
+   struct raon_document *doc;
+   // text of the top-level entry that the chunks fed so far didn't complete
+   char *pending;
+   size_t pending_len, pending_capacity;
+   // nesting depth of blocks and arrays, entries only end at depth 0
+   size_t depth;
+   bool in_string, in_comment, failed;
+};
+
+struct raon_parser raon_parser_init(void);
+
+/*
+   Feeds the next chunk of the document to the parser.
+   The chunk is not referenced after the call returns so its buffer can be reused right away.
+
+   Returns: false if parsing failed, every following call fails too
+
+   Note: `raon_parser_finish` must still be called to release the parser after a failure.
+*/
+bool raon_parser_feed(struct raon_parser *self, const char *chunk, size_t len);
+
+/*
+   Parses whatever is left after the last chunk and releases the parser, which can be reused
+   afterwards.
+
+   Returns: NULL if parsing failed
+
+   Note: The document must be freed with `raon_document_free`.
+*/
+struct raon_document *raon_parser_finish(struct raon_parser *self);
+
+// === Binary Encoding ===
+
+/*
+   Encodes entries in Raon's binary format, which carries the same data as the text but can be
+   decoded without lexing. Ints are varints, floats are raw IEEE 754 doubles, strings are length
+   prefixed and arrays store their element type once followed by the packed elements.
+
+   Returns: false if the sink failed, if a block mixes key types or an array mixes value types, or
+   if a value is still lazy
+
+   Note: ints are always decoded as decimal, the base they were written in isn't kept.
+*/
+bool raon_encode_binary(const struct vector_of_raon_entry *entries, struct raon_sink sink);
+
+// deepest nesting of blocks and arrays that `raon_decode_binary` accepts
+#define RAON_BINARY_MAX_DEPTH 512
+
+/*
+   Decodes the output of `raon_encode_binary` into a document. The data doesn't have to be trusted,
+   anything that the encoder couldn't have produced is rejected.
+
+   Returns: NULL if the data is malformed, repeats a key in a block or nests blocks and arrays
+   deeper than `RAON_BINARY_MAX_DEPTH`
+
+   Note: strings point into `data` instead of being copied, so it has to outlive the document.
+   The document must be freed with `raon_document_free`.
+*/
+struct raon_document *raon_decode_binary(char *data, size_t len);
+
+// === Frozen Snapshots ===
+
+/*
+   Writes entries as a frozen snapshot, a flat layout that can be read where it lies without
+   being parsed or decoded. Blocks store their entries in order along with a hash table of their
+   keys, arrays are contiguous and everything refers to everything else by its offset.
+
+   Returns: false if the sink failed, if a block mixes key types or an array mixes value types,
+   if a string, block or array has more than UINT32_MAX bytes or items, or if a value is still lazy
+*/
+bool raon_freeze(const struct vector_of_raon_entry *entries, struct raon_sink sink);
+
+/*
+   A read-only view of a frozen snapshot. Opening one only checks its header and footer, so it
+   takes the same time no matter how big the snapshot is, and nothing is ever allocated.
+*/
+struct raon_frozen {
+   const char *data;
+   size_t len;
+   // mapping that's released by `raon_frozen_close`, NULL if the data belongs to the caller
+   void *mapping;
+};
+
+/*
+   A value inside of a snapshot, which is only valid while the snapshot is open.
+   Missing values, such as the result of a failed lookup, have a NULL `cell`.
+*/
+struct raon_frozen_value {
+   const struct raon_frozen *snapshot;
+   const char *cell;
+};
+
+// Views a snapshot that's already in memory, `data` has to outlive it. Returns false if `data`
+// isn't a snapshot.
+bool raon_frozen_init(struct raon_frozen *self, const char *data, size_t len);
+
+/*
+   Maps a snapshot file read-only. Processes that open the same file share its pages.
+
+   Returns: false if the file couldn't be mapped or isn't a snapshot
+*/
+bool raon_frozen_open(struct raon_frozen *self, const char *path);
+void raon_frozen_close(struct raon_frozen *self);
+
+// The top-level block.
+struct raon_frozen_value raon_frozen_root(const struct raon_frozen *self);
+
+/*
+   Accessors mirroring the fields of `raon_value`, they return 0, false or an empty slice when
+   the value has another type or is missing. The type of a missing value is
+   `raon_value_type_error`.
+
+   Note: offsets are bounds checked, so a corrupted snapshot can give wrong values but is never
+   read out of bounds.
+*/
+enum raon_value_type raon_frozen_type(struct raon_frozen_value value);
+intptr_t raon_frozen_int(struct raon_frozen_value value);
+// base the int was written in, see `raon_value.int_base`
+uint8_t raon_frozen_int_base(struct raon_frozen_value value);
+double raon_frozen_float(struct raon_frozen_value value);
+bool raon_frozen_bool(struct raon_frozen_value value);
+// Strings point into the snapshot and are followed by a NUL.
+struct raon_str_slice raon_frozen_string(struct raon_frozen_value value);
+
+// Number of entries in a block or items in an array.
+size_t raon_frozen_len(struct raon_frozen_value value);
+// The item of an array, or the value of a block's entry, at `index`.
+struct raon_frozen_value raon_frozen_at(struct raon_frozen_value value, size_t index);
+// The key of a block's entry at `index`.
+struct raon_key raon_frozen_key_at(struct raon_frozen_value block, size_t index);
+
+// Finds the value stored under a key, duplicated keys resolve to their first occurrence like
+// `raon_block_get` does.
+struct raon_frozen_value raon_frozen_get(
+    struct raon_frozen_value block, const char *key, size_t len);
+struct raon_frozen_value raon_frozen_get_int(struct raon_frozen_value block, intptr_t key);
+
+// === Compact Documents ===
+
+/*
+   A node of a compact document, 12 bytes no matter its type.
+   Strings are an offset into the parsed text and a length, blocks and arrays are the position of
+   their first child and their number of children, children of a node are stored next to each
+   other. Ints and floats are split in two 32-bit halves so that nodes only need 4-byte alignment.
+*/
+struct raon_compact_node {
+   // `raon_value_type` of the node
+   uint8_t type;
+   // base an int was written in, see `raon_value.int_base`
+   uint8_t int_base;
+   // `raon_key_type` of a block's keys, or `raon_value_type` of an array's items
+   uint8_t child_type;
+   // whether an array's items are packed into 64-bit words instead of being nodes, which is the
+   // case for the arrays that `raon_array_as_ints` and its siblings can view
+   uint8_t packed;
+   uint32_t payload[2];
+};
+
+// A read-only document made of compact nodes, see `raon_compact_parse`.
+struct raon_compact;
+
+/*
+   A value inside of a compact document, which is only valid while the document is alive.
+   Missing values, such as the result of a failed lookup, have the type `raon_value_type_error`.
+*/
+struct raon_compact_value {
+   const struct raon_compact *doc;
+   struct raon_compact_node node;
+};
+
+/*
+   Parses text into a compact document, which takes a fraction of the memory of a
+   `raon_document` and keeps the nodes of a block or array next to each other so that walking
+   the tree touches fewer cache lines. The text is parsed with `raon_parse_document` first and
+   the tree is then packed into arrays of nodes that are allocated once.
+
+   Inputs:
+   - `str`: text to parse, strings and keys point into it so it has to outlive the document
+   - `len`: size of `str`, at most UINT32_MAX bytes
+
+   Returns: NULL if parsing failed or the text is too big
+
+   Note: The document must be freed with `raon_compact_free`. Nothing is allocated when reading it,
+   so it can be read from several threads at once.
+   Only the memory held once parsing is done goes down: the tree is alive while the nodes are
+   built, so parsing peaks at the memory of `raon_parse_document` plus `raon_compact_size`.
+*/
+struct raon_compact *raon_compact_parse(char *str, size_t len);
+void raon_compact_free(struct raon_compact *self);
+
+// Number of bytes the document holds on to, the text it was parsed from isn't counted.
+size_t raon_compact_size(const struct raon_compact *self);
+
+// The top-level block.
+struct raon_compact_value raon_compact_root(const struct raon_compact *self);
+
+/*
+   Accessors mirroring the fields of `raon_value`, they return 0, false or an empty slice when
+   the value has another type or is missing, the same as the ones of frozen snapshots.
+*/
+enum raon_value_type raon_compact_type(struct raon_compact_value value);
+intptr_t raon_compact_int(struct raon_compact_value value);
+uint8_t raon_compact_int_base(struct raon_compact_value value);
+double raon_compact_float(struct raon_compact_value value);
+bool raon_compact_bool(struct raon_compact_value value);
+// Strings point into the text the document was parsed from.
+struct raon_str_slice raon_compact_string(struct raon_compact_value value);
+
+// Number of entries in a block or items in an array.
+size_t raon_compact_len(struct raon_compact_value value);
+// The item of an array, or the value of a block's entry, at `index`.
+struct raon_compact_value raon_compact_at(struct raon_compact_value value, size_t index);
+// The key of a block's entry at `index`.
+struct raon_key raon_compact_key_at(struct raon_compact_value block, size_t index);
+
+// Finds the value stored under a key, blocks with at least `RAON_BLOCK_INDEX_THRESHOLD` entries
+// are looked up through a hash table and smaller ones are scanned.
+struct raon_compact_value raon_compact_get(
+    struct raon_compact_value block, const char *key, size_t len);
+struct raon_compact_value raon_compact_get_int(struct raon_compact_value block, intptr_t key);
+
 #ifdef __cplusplus
 }
 #endif
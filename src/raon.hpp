@@ -0,0 +1,382 @@
+#ifndef RAON_HPP
+#define RAON_HPP
+
+/*
+   C++20 views over the C API. Blocks, arrays, entries and values are pointer-sized handles into a
+   document, so passing them around, iterating or looking things up never copies the tree, and
+   every call goes straight to the C function it wraps. Items of arrays are an array and an index,
+   since packed ints, floats and bools aren't stored as values, see `raon_array_get`.
+
+   Lookups never throw: a missing key, an out of bounds index or a value of the wrong type gives
+   back a value of type `raon_value_type_error`, or an empty block or array.
+*/
+
+#include "raon.h"
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string_view>
+#include <utility>
+
+namespace raon {
+
+class block;
+class array;
+class item;
+
+class value {
+public:
+   // views a value that's stored in a document
+   explicit value(const raon_value &stored) noexcept : ptr_(&stored) { }
+
+   // a value of type `raon_value_type_error`, which is what failed lookups return
+   static value missing() noexcept {
+      static const raon_value error = [] {
+         raon_value error_value {};
+         error_value.type = raon_value_type_error;
+         return error_value;
+      }();
+      return value(error);
+   }
+
+   raon_value_type type() const noexcept { return ptr_->type; }
+   explicit operator bool() const noexcept { return type() != raon_value_type_error; }
+
+   // these only make sense for values of the matching type, see `type`
+   std::string_view as_string() const noexcept {
+      return std::string_view(ptr_->str_val.ptr, ptr_->str_val.len);
+   }
+   intptr_t as_int() const noexcept { return ptr_->int_val; }
+   // base the int was written in: 2, 8, 16, or 0 for decimal
+   unsigned int_base() const noexcept { return ptr_->int_base; }
+   double as_float() const noexcept { return ptr_->float_val; }
+   bool as_bool() const noexcept { return ptr_->bool_val; }
+
+   // empty unless the value is a block or an array
+   block as_block() const noexcept;
+   array as_array() const noexcept;
+
+   value operator[](std::string_view key) const noexcept;
+   item operator[](std::size_t index) const noexcept;
+
+   const raon_value &c_value() const noexcept { return *ptr_; }
+
+private:
+   const raon_value *ptr_;
+};
+
+class entry {
+public:
+   explicit entry(const raon_entry &item) noexcept : ptr_(&item) { }
+
+   raon_key_type key_type() const noexcept { return ptr_->key_type; }
+   // empty for int keys
+   std::string_view key() const noexcept {
+      if (ptr_->key_type != raon_key_type_string) {
+         return {};
+      }
+      return std::string_view(ptr_->str_key.ptr, ptr_->str_key.len);
+   }
+   intptr_t int_key() const noexcept { return ptr_->int_key; }
+   raon::value value() const noexcept { return raon::value(ptr_->value); }
+
+   const raon_entry &c_entry() const noexcept { return *ptr_; }
+
+private:
+   const raon_entry *ptr_;
+};
+
+class block {
+public:
+   // entries are handed out by value, which makes this an input iterator to code that predates
+   // C++20 concepts but a forward iterator to `std::forward_iterator`
+   class iterator {
+   public:
+      using iterator_category = std::input_iterator_tag;
+      using iterator_concept = std::forward_iterator_tag;
+      using value_type = entry;
+      using difference_type = std::ptrdiff_t;
+      using reference = entry;
+
+      iterator() noexcept = default;
+      explicit iterator(const raon_entry *ptr) noexcept : ptr_(ptr) { }
+
+      entry operator*() const noexcept { return entry(*ptr_); }
+      iterator &operator++() noexcept {
+         ++ptr_;
+         return *this;
+      }
+      iterator operator++(int) noexcept {
+         iterator prev = *this;
+         ++ptr_;
+         return prev;
+      }
+      bool operator==(const iterator &) const noexcept = default;
+
+   private:
+      const raon_entry *ptr_ = nullptr;
+   };
+
+   block() noexcept = default;
+   explicit block(vector_of_raon_entry *entries) noexcept : ptr_(entries) { }
+
+   std::size_t size() const noexcept { return ptr_ ? ptr_->len : 0; }
+   bool empty() const noexcept { return size() == 0; }
+
+   iterator begin() const noexcept { return iterator(ptr_ ? ptr_->vec : nullptr); }
+   iterator end() const noexcept { return iterator(ptr_ ? ptr_->vec + ptr_->len : nullptr); }
+
+   value operator[](std::string_view key) const noexcept {
+      raon_value *found = raon_block_get(ptr_, key.data(), key.size());
+      return found ? value(*found) : value::missing();
+   }
+   value get(intptr_t key) const noexcept {
+      raon_value *found = raon_block_get_int(ptr_, key);
+      return found ? value(*found) : value::missing();
+   }
+
+   vector_of_raon_entry *c_entries() const noexcept { return ptr_; }
+
+private:
+   vector_of_raon_entry *ptr_ = nullptr;
+};
+
+class array {
+public:
+   class iterator {
+   public:
+      // items are handed out by value, see `block::iterator`
+      using iterator_category = std::input_iterator_tag;
+      using iterator_concept = std::forward_iterator_tag;
+      using value_type = item;
+      using difference_type = std::ptrdiff_t;
+      using reference = item;
+
+      iterator() noexcept = default;
+      iterator(const vector_of_raon_value *items, std::size_t index) noexcept
+          : items_(items), index_(index) { }
+
+      item operator*() const noexcept;
+      iterator &operator++() noexcept {
+         ++index_;
+         return *this;
+      }
+      iterator operator++(int) noexcept {
+         iterator prev = *this;
+         ++index_;
+         return prev;
+      }
+      bool operator==(const iterator &) const noexcept = default;
+
+   private:
+      const vector_of_raon_value *items_ = nullptr;
+      std::size_t index_ = 0;
+   };
+
+   array() noexcept = default;
+   explicit array(const vector_of_raon_value *items) noexcept : ptr_(items) { }
+
+   std::size_t size() const noexcept { return raon_array_len(ptr_); }
+   bool empty() const noexcept { return size() == 0; }
+
+   iterator begin() const noexcept { return iterator(ptr_, 0); }
+   iterator end() const noexcept { return iterator(ptr_, size()); }
+
+   // out of bounds indexes give back an item of type `raon_value_type_error`
+   item operator[](std::size_t index) const noexcept;
+
+   // the packed items of the array, or nothing if they aren't all of that type
+   std::optional<std::span<const intptr_t>> ints() const noexcept {
+      const intptr_t *items;
+      std::size_t len;
+      if (!raon_array_as_ints(ptr_, &items, &len)) {
+         return std::nullopt;
+      }
+      return std::span<const intptr_t>(items, len);
+   }
+   std::optional<std::span<const double>> floats() const noexcept {
+      const double *items;
+      std::size_t len;
+      if (!raon_array_as_floats(ptr_, &items, &len)) {
+         return std::nullopt;
+      }
+      return std::span<const double>(items, len);
+   }
+   // one bit per item starting from the lowest bit of the first byte, see `raon_array_as_bools`
+   std::optional<std::span<const uint8_t>> bool_bits() const noexcept {
+      const uint8_t *bits;
+      std::size_t len;
+      if (!raon_array_as_bools(ptr_, &bits, &len)) {
+         return std::nullopt;
+      }
+      return std::span<const uint8_t>(bits, (len + 7) / 8);
+   }
+
+   const vector_of_raon_value *c_values() const noexcept { return ptr_; }
+
+private:
+   const vector_of_raon_value *ptr_ = nullptr;
+};
+
+/*
+   An item of an array. Packed ints, floats and bools are read straight out of the array, other
+   items are viewed in place through `value`.
+*/
+class item {
+public:
+   item() noexcept = default;
+   item(const vector_of_raon_value *items, std::size_t index) noexcept
+       : items_(items), index_(index) { }
+
+   raon_value_type type() const noexcept {
+      if (!valid()) {
+         return raon_value_type_error;
+      }
+      return packed() ? items_->packed.type : items_->vec[index_].type;
+   }
+   explicit operator bool() const noexcept { return valid(); }
+
+   // these only make sense for items of the matching type, see `type`
+   intptr_t as_int() const noexcept {
+      if (!valid()) {
+         return 0;
+      }
+      return packed() ? items_->packed.ints[index_] : items_->vec[index_].int_val;
+   }
+   // base the int was written in: 2, 8, 16, or 0 for decimal
+   unsigned int_base() const noexcept {
+      if (!valid()) {
+         return 0;
+      }
+      if (!packed()) {
+         return items_->vec[index_].int_base;
+      }
+      const raon_packed_items &items = items_->packed;
+      return items.int_bases ? items.int_bases[index_] : items.int_base;
+   }
+   double as_float() const noexcept {
+      if (!valid()) {
+         return 0;
+      }
+      return packed() ? items_->packed.floats[index_] : items_->vec[index_].float_val;
+   }
+   bool as_bool() const noexcept {
+      if (!valid()) {
+         return false;
+      }
+      return packed() ? items_->packed.bools[index_ / 8] >> (index_ % 8) & 1
+                      : items_->vec[index_].bool_val;
+   }
+
+   // the item as a value, which packed items aren't stored as, so they give back `value::missing`
+   raon::value value() const noexcept {
+      return valid() && !packed() ? raon::value(items_->vec[index_]) : raon::value::missing();
+   }
+   std::string_view as_string() const noexcept { return value().as_string(); }
+   block as_block() const noexcept;
+   array as_array() const noexcept { return value().as_array(); }
+
+   raon::value operator[](std::string_view key) const noexcept { return value()[key]; }
+   item operator[](std::size_t index) const noexcept { return value()[index]; }
+
+   // copies the item out, see `raon_array_get`
+   raon_value c_value() const noexcept { return raon_array_get(items_, index_); }
+
+private:
+   bool packed() const noexcept { return items_->packed.len != 0; }
+   bool valid() const noexcept {
+      return items_ && index_ < (packed() ? items_->packed.len : items_->len);
+   }
+
+   const vector_of_raon_value *items_ = nullptr;
+   std::size_t index_ = 0;
+};
+
+inline item array::iterator::operator*() const noexcept { return item(items_, index_); }
+
+inline item array::operator[](std::size_t index) const noexcept { return item(ptr_, index); }
+
+inline block item::as_block() const noexcept { return value().as_block(); }
+
+inline block value::as_block() const noexcept {
+   return type() == raon_value_type_block ? block(ptr_->block_val) : block();
+}
+
+inline array value::as_array() const noexcept {
+   return type() == raon_value_type_array ? array(ptr_->array_val) : array();
+}
+
+inline value value::operator[](std::string_view key) const noexcept { return as_block()[key]; }
+
+inline item value::operator[](std::size_t index) const noexcept { return as_array()[index]; }
+
+/*
+   Owns a parsed document and the text its strings point into, it's freed when it goes out of
+   scope. Documents can be moved but not copied, views into one stay valid when it's moved.
+*/
+class document {
+public:
+   // the text is copied first, so it doesn't have to outlive the document
+   static std::optional<document> parse(std::string_view text) {
+      auto owned = std::make_unique_for_overwrite<char[]>(text.size());
+      std::copy(text.begin(), text.end(), owned.get());
+      return parse(std::move(owned), text.size());
+   }
+
+   // takes the text over without copying it
+   static std::optional<document> parse(std::unique_ptr<char[]> text, std::size_t len) {
+      raon_document *doc = raon_parse_document(text.get(), len);
+      if (!doc) {
+         return std::nullopt;
+      }
+      return document(doc, std::move(text));
+   }
+
+   // the file is mapped rather than read whenever possible, see `raon_parse_file`
+   static std::optional<document> parse_file(const char *path) {
+      raon_document *doc = raon_parse_file(path);
+      if (!doc) {
+         return std::nullopt;
+      }
+      return document(doc, nullptr);
+   }
+
+   document(const document &) = delete;
+   document &operator=(const document &) = delete;
+
+   document(document &&other) noexcept
+       : doc_(std::exchange(other.doc_, nullptr)), text_(std::move(other.text_)) { }
+
+   document &operator=(document &&other) noexcept {
+      if (this != &other) {
+         raon_document_free(doc_);
+         doc_ = std::exchange(other.doc_, nullptr);
+         text_ = std::move(other.text_);
+      }
+      return *this;
+   }
+
+   ~document() { raon_document_free(doc_); }
+
+   block root() const noexcept { return block(doc_ ? doc_->entries : nullptr); }
+   block::iterator begin() const noexcept { return root().begin(); }
+   block::iterator end() const noexcept { return root().end(); }
+   value operator[](std::string_view key) const noexcept { return root()[key]; }
+
+   raon_document *c_document() const noexcept { return doc_; }
+
+private:
+   document(raon_document *doc, std::unique_ptr<char[]> text) noexcept
+       : doc_(doc), text_(std::move(text)) { }
+
+   raon_document *doc_;
+   std::unique_ptr<char[]> text_;
+};
+
+} // namespace raon
+
+#endif
@@ -0,0 +1,241 @@
+#include "internal.h"
+#include <stdint.h>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+   #define RAON_SCAN_X86
+   #include <immintrin.h>
+#endif
+
+static enum raon_scan_level raon_scan_forced_level = raon_scan_level_auto;
+
+void raon_scan_force_level(enum raon_scan_level level) { raon_scan_forced_level = level; }
+
+static enum raon_scan_level raon_scan_supported_level(void) {
+#ifdef RAON_SCAN_X86
+   if (__builtin_cpu_supports("avx2")) {
+      return raon_scan_level_avx2;
+   }
+   if (__builtin_cpu_supports("sse2")) {
+      return raon_scan_level_sse2;
+   }
+#endif
+   return raon_scan_level_scalar;
+}
+
+enum raon_scan_level raon_scan_active_level(void) {
+   const enum raon_scan_level supported = raon_scan_supported_level();
+   if (raon_scan_forced_level != raon_scan_level_auto && raon_scan_forced_level < supported) {
+      return raon_scan_forced_level;
+   }
+   return supported;
+}
+
+static bool raon_scan_is_blank(char c) {
+   return c == ' ' || c == '\t' || c == '\r' || c == '\v' || c == '\f';
+}
+
+// === Scalar ===
+
+static size_t raon_scan_find2_scalar(const char *str, size_t len, char a, char b) {
+   for (size_t i = 0; i < len; i++) {
+      if (str[i] == a || str[i] == b) {
+         return i;
+      }
+   }
+   return len;
+}
+
+static size_t raon_scan_skip_blank_scalar(const char *str, size_t len) {
+   size_t i = 0;
+   while (i < len && raon_scan_is_blank(str[i])) {
+      i++;
+   }
+   return i;
+}
+
+static size_t raon_scan_count_newlines_scalar(const char *str, size_t len, size_t *last) {
+   size_t count = 0;
+   for (size_t i = 0; i < len; i++) {
+      if (str[i] == '\n') {
+         ++count;
+         *last = i;
+      }
+   }
+   return count;
+}
+
+#ifdef RAON_SCAN_X86
+
+// === SSE2 ===
+
+// bytes in `\t`..`\r` except `\n`, or a space
+__attribute__((target("sse2"))) static inline int raon_scan_blank_mask_sse2(__m128i chunk) {
+   const __m128i in_range = _mm_and_si128(_mm_cmpgt_epi8(chunk, _mm_set1_epi8('\t' - 1)),
+       _mm_cmplt_epi8(chunk, _mm_set1_epi8('\r' + 1)));
+   const __m128i blank
+       = _mm_or_si128(_mm_andnot_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')), in_range),
+           _mm_cmpeq_epi8(chunk, _mm_set1_epi8(' ')));
+   return _mm_movemask_epi8(blank);
+}
+
+__attribute__((target("sse2"))) static size_t raon_scan_find2_sse2(
+    const char *str, size_t len, char a, char b) {
+   const __m128i va = _mm_set1_epi8(a);
+   const __m128i vb = _mm_set1_epi8(b);
+   size_t i = 0;
+   for (; i + 16 <= len; i += 16) {
+      const __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+      const int mask = _mm_movemask_epi8(
+          _mm_or_si128(_mm_cmpeq_epi8(chunk, va), _mm_cmpeq_epi8(chunk, vb)));
+      if (mask) {
+         return i + __builtin_ctz(mask);
+      }
+   }
+   return i + raon_scan_find2_scalar(str + i, len - i, a, b);
+}
+
+__attribute__((target("sse2"))) static size_t raon_scan_skip_blank_sse2(
+    const char *str, size_t len) {
+   size_t i = 0;
+   for (; i + 16 <= len; i += 16) {
+      const __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+      const int not_blank = ~raon_scan_blank_mask_sse2(chunk) & 0xFFFF;
+      if (not_blank) {
+         return i + __builtin_ctz(not_blank);
+      }
+   }
+   return i + raon_scan_skip_blank_scalar(str + i, len - i);
+}
+
+__attribute__((target("sse2"))) static size_t raon_scan_count_newlines_sse2(
+    const char *str, size_t len, size_t *last) {
+   const __m128i newline = _mm_set1_epi8('\n');
+   size_t count = 0;
+   size_t i = 0;
+   for (; i + 16 <= len; i += 16) {
+      const __m128i chunk = _mm_loadu_si128((const __m128i *)(str + i));
+      const unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(chunk, newline));
+      if (mask) {
+         count += __builtin_popcount(mask);
+         *last = i + 31 - __builtin_clz(mask);
+      }
+   }
+   size_t tail_last = 0;
+   const size_t tail = raon_scan_count_newlines_scalar(str + i, len - i, &tail_last);
+   if (tail) {
+      *last = i + tail_last;
+   }
+   return count + tail;
+}
+
+// === AVX2 ===
+
+__attribute__((target("avx2"))) static size_t raon_scan_find2_avx2(
+    const char *str, size_t len, char a, char b) {
+   const __m256i va = _mm256_set1_epi8(a);
+   const __m256i vb = _mm256_set1_epi8(b);
+   size_t i = 0;
+   for (; i + 32 <= len; i += 32) {
+      const __m256i chunk = _mm256_loadu_si256((const __m256i *)(str + i));
+      const unsigned mask = _mm256_movemask_epi8(
+          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, va), _mm256_cmpeq_epi8(chunk, vb)));
+      if (mask) {
+         return i + __builtin_ctz(mask);
+      }
+   }
+   return i + raon_scan_find2_sse2(str + i, len - i, a, b);
+}
+
+__attribute__((target("avx2"))) static size_t raon_scan_skip_blank_avx2(
+    const char *str, size_t len) {
+   const __m256i tab_minus_one = _mm256_set1_epi8('\t' - 1);
+   const __m256i cr_plus_one = _mm256_set1_epi8('\r' + 1);
+   const __m256i newline = _mm256_set1_epi8('\n');
+   const __m256i space = _mm256_set1_epi8(' ');
+   size_t i = 0;
+   for (; i + 32 <= len; i += 32) {
+      const __m256i chunk = _mm256_loadu_si256((const __m256i *)(str + i));
+      const __m256i in_range = _mm256_and_si256(
+          _mm256_cmpgt_epi8(chunk, tab_minus_one), _mm256_cmpgt_epi8(cr_plus_one, chunk));
+      const __m256i blank = _mm256_or_si256(
+          _mm256_andnot_si256(_mm256_cmpeq_epi8(chunk, newline), in_range),
+          _mm256_cmpeq_epi8(chunk, space));
+      const unsigned not_blank = ~(unsigned)_mm256_movemask_epi8(blank);
+      if (not_blank) {
+         return i + __builtin_ctz(not_blank);
+      }
+   }
+   return i + raon_scan_skip_blank_sse2(str + i, len - i);
+}
+
+__attribute__((target("avx2"))) static size_t raon_scan_count_newlines_avx2(
+    const char *str, size_t len, size_t *last) {
+   const __m256i newline = _mm256_set1_epi8('\n');
+   size_t count = 0;
+   size_t i = 0;
+   for (; i + 32 <= len; i += 32) {
+      const __m256i chunk = _mm256_loadu_si256((const __m256i *)(str + i));
+      const unsigned mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(chunk, newline));
+      if (mask) {
+         count += __builtin_popcount(mask);
+         *last = i + 31 - __builtin_clz(mask);
+      }
+   }
+   size_t tail_last = 0;
+   const size_t tail = raon_scan_count_newlines_sse2(str + i, len - i, &tail_last);
+   if (tail) {
+      *last = i + tail_last;
+   }
+   return count + tail;
+}
+
+#endif
+
+// === Dispatch ===
+
+size_t raon_scan_find2(const char *str, size_t len, char a, char b) {
+   switch (raon_scan_active_level()) {
+#ifdef RAON_SCAN_X86
+   case raon_scan_level_avx2:
+      return raon_scan_find2_avx2(str, len, a, b);
+   case raon_scan_level_sse2:
+      return raon_scan_find2_sse2(str, len, a, b);
+#endif
+   default:
+      return raon_scan_find2_scalar(str, len, a, b);
+   }
+}
+
+size_t raon_scan_skip_blank(const char *str, size_t len) {
+   // most gaps between tokens are a single space, so don't pay for a vector load on them
+   if (len == 0 || !raon_scan_is_blank(str[0])) {
+      return 0;
+   }
+   if (len < 2 || !raon_scan_is_blank(str[1])) {
+      return 1;
+   }
+
+   switch (raon_scan_active_level()) {
+#ifdef RAON_SCAN_X86
+   case raon_scan_level_avx2:
+      return raon_scan_skip_blank_avx2(str, len);
+   case raon_scan_level_sse2:
+      return raon_scan_skip_blank_sse2(str, len);
+#endif
+   default:
+      return raon_scan_skip_blank_scalar(str, len);
+   }
+}
+
+size_t raon_scan_count_newlines(const char *str, size_t len, size_t *last) {
+   switch (raon_scan_active_level()) {
+#ifdef RAON_SCAN_X86
+   case raon_scan_level_avx2:
+      return raon_scan_count_newlines_avx2(str, len, last);
+   case raon_scan_level_sse2:
+      return raon_scan_count_newlines_sse2(str, len, last);
+#endif
+   default:
+      return raon_scan_count_newlines_scalar(str, len, last);
+   }
+}
@@ -0,0 +1,494 @@
+#include "internal.h"
+#include "raon.h"
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+// smallest number of items dynamic arrays allocate room for
+#define RAON_DECODE_MIN_CAPACITY 8
+
+/*
+   Key or array index leading to the value being decoded. Paths live on the C stack of the
+   recursive descent and are only turned into text when an error is reported.
+*/
+struct raon_decode_path {
+   const struct raon_decode_path *parent;
+   struct raon_str_slice key;
+   // used instead of `key` for the items of arrays
+   size_t index;
+   bool is_index;
+};
+
+// the decoder follows the same grammar as the event parser in events.c
+struct raon_decoder {
+   struct raon_lexer lexer;
+   struct vec_allocator allocator;
+   struct raon_decode_error *error;
+   // counts of the fixed arrays of structs in the caller's memory that this call filled, the
+   // items of the others are only freed once this call wrote them, see `raon_decode_array`
+   char **filled;
+   size_t filled_len, filled_capacity;
+};
+
+static bool raon_decode_entries(struct raon_decoder *self, const struct raon_decode_path *path,
+    const struct raon_schema *schema, char *base, enum raon_token_type end);
+
+static size_t raon_decode_write_path(const struct raon_decode_path *path, char *buf, size_t size) {
+   if (!path) {
+      return 0;
+   }
+   const size_t len = raon_decode_write_path(path->parent, buf, size);
+   if (len + 1 >= size) {
+      return len;
+   }
+   const int written = path->is_index
+       ? snprintf(&buf[len], size - len, "[%zu]", path->index)
+       : snprintf(&buf[len], size - len, "%s%.*s", len ? "." : "", (int)path->key.len,
+             path->key.ptr);
+   if (written < 0) {
+      return len;
+   }
+   return (size_t)written < size - len ? len + (size_t)written : size - 1;
+}
+
+static bool raon_decode_fail(struct raon_decoder *self, const struct raon_decode_path *path,
+    struct raon_token token, enum raon_error_kind kind) {
+   if (self->error) {
+      self->error->error = (struct raon_error) { .kind = kind, .offset = token.start };
+      self->error->path[0] = '\0';
+      raon_decode_write_path(path, self->error->path, sizeof(self->error->path));
+   }
+   return false;
+}
+
+// a token that isn't allowed where it is, which says more about the error when it's malformed
+static bool raon_decode_unexpected(
+    struct raon_decoder *self, const struct raon_decode_path *path, struct raon_token token) {
+   switch (token.type) {
+   case raon_token_type_error:
+      return raon_decode_fail(self, path, token, raon_error_kind_invalid_token);
+   case raon_token_type_eof:
+      return raon_decode_fail(self, path, token, raon_error_kind_unexpected_end);
+   default:
+      return raon_decode_fail(self, path, token, raon_error_kind_unexpected_token);
+   }
+}
+
+// a token that was expected to be a value of a field's type
+static bool raon_decode_mismatch(
+    struct raon_decoder *self, const struct raon_decode_path *path, struct raon_token token) {
+   switch (token.type) {
+   case raon_token_type_string:
+   case raon_token_type_int:
+   case raon_token_type_float:
+   case raon_token_type_bool:
+   case raon_token_type_block_open:
+   case raon_token_type_array_open:
+      return raon_decode_fail(self, path, token, raon_error_kind_type_mismatch);
+   default:
+      return raon_decode_unexpected(self, path, token);
+   }
+}
+
+static bool raon_decode_is_separator(struct raon_token token, enum raon_token_type end) {
+   return token.type == raon_token_type_newline || token.type == raon_token_type_comma
+       || token.type == end;
+}
+
+static const struct raon_field *raon_schema_field(
+    const struct raon_schema *schema, struct raon_str_slice key) {
+   if (!schema) {
+      return NULL;
+   }
+   for (size_t i = 0; i < schema->field_count; i++) {
+      const struct raon_field *field = &schema->fields[i];
+      if (strncmp(field->key, key.ptr, key.len) == 0 && field->key[key.len] == '\0') {
+         return field;
+      }
+   }
+   return NULL;
+}
+
+static size_t raon_field_item_size(const struct raon_field *field) {
+   switch (field->item_type) {
+   case raon_field_type_int:
+      return sizeof(intptr_t);
+   case raon_field_type_float:
+      return sizeof(double);
+   case raon_field_type_bool:
+      return sizeof(bool);
+   case raon_field_type_string:
+      return sizeof(struct raon_str_slice);
+   case raon_field_type_struct:
+      return field->schema->size;
+   default:
+      // arrays of arrays can't be described
+      return 0;
+   }
+}
+
+static void raon_schema_free_field(
+    const struct raon_field *field, char *base, struct vec_allocator allocator) {
+   char *dest = base + field->offset;
+   if (field->type == raon_field_type_struct) {
+      raon_schema_free(field->schema, dest, allocator);
+      return;
+   }
+   if (field->type != raon_field_type_fixed_array && field->type != raon_field_type_dynamic_array) {
+      return;
+   }
+
+   char *items = dest;
+   if (field->type == raon_field_type_dynamic_array) {
+      memcpy(&items, dest, sizeof(items));
+   }
+   if (items && field->item_type == raon_field_type_struct) {
+      size_t len;
+      memcpy(&len, base + field->len_offset, sizeof(len));
+      for (size_t i = 0; i < len; i++) {
+         raon_schema_free(field->schema, &items[i * field->schema->size], allocator);
+      }
+   }
+   if (field->type == raon_field_type_dynamic_array) {
+      if (items) {
+         allocator.free(allocator.ctx, items);
+      }
+      const size_t len = 0;
+      items = NULL;
+      memcpy(dest, &items, sizeof(items));
+      memcpy(base + field->len_offset, &len, sizeof(len));
+   }
+}
+
+void raon_schema_free(
+    const struct raon_schema *schema, void *target, struct vec_allocator allocator) {
+   for (size_t i = 0; i < schema->field_count; i++) {
+      raon_schema_free_field(&schema->fields[i], target, allocator);
+   }
+}
+
+// values of unknown keys are stepped over, nested ones without looking inside of them
+static bool raon_decode_skip(
+    struct raon_decoder *self, const struct raon_decode_path *path, struct raon_token token) {
+   switch (token.type) {
+   case raon_token_type_string:
+   case raon_token_type_int:
+   case raon_token_type_float:
+   case raon_token_type_bool:
+      return true;
+
+   case raon_token_type_block_open:
+   case raon_token_type_array_open: {
+      struct raon_str_slice text;
+      if (!raon_lexer_skip_nested(&self->lexer, &text)) {
+         return raon_decode_fail(self, path, token, raon_error_kind_unexpected_end);
+      }
+      return true;
+   }
+
+   default:
+      return raon_decode_unexpected(self, path, token);
+   }
+}
+
+// decodes a value that isn't an array into `dest`, which holds a field of type `type`
+static bool raon_decode_item(struct raon_decoder *self, const struct raon_decode_path *path,
+    enum raon_field_type type, const struct raon_schema *schema, char *dest,
+    struct raon_token token) {
+   switch (type) {
+   case raon_field_type_int:
+      if (token.type == raon_token_type_int) {
+         memcpy(dest, &token.int_val, sizeof(token.int_val));
+         return true;
+      }
+      break;
+
+   case raon_field_type_float:
+      if (token.type == raon_token_type_float) {
+         memcpy(dest, &token.float_val, sizeof(token.float_val));
+         return true;
+      }
+      break;
+
+   case raon_field_type_bool:
+      if (token.type == raon_token_type_bool) {
+         memcpy(dest, &token.bool_val, sizeof(token.bool_val));
+         return true;
+      }
+      break;
+
+   case raon_field_type_string:
+      if (token.type == raon_token_type_string) {
+         memcpy(dest, &token.str_val, sizeof(token.str_val));
+         return true;
+      }
+      break;
+
+   case raon_field_type_struct:
+      if (token.type == raon_token_type_block_open) {
+         return raon_decode_entries(self, path, schema, dest, raon_token_type_block_close);
+      }
+      break;
+
+   default:
+      break;
+   }
+   return raon_decode_mismatch(self, path, token);
+}
+
+// grows the items of a dynamic array, which are stored in the field as soon as they move
+static bool raon_decode_reserve(struct raon_decoder *self, const struct raon_field *field,
+    char *base, char **items, size_t *capacity) {
+   const size_t item_size = raon_field_item_size(field);
+   const size_t new_capacity = *capacity ? *capacity * 2 : RAON_DECODE_MIN_CAPACITY;
+   if (new_capacity > SIZE_MAX / item_size) {
+      return false;
+   }
+
+   char *grown = NULL;
+   if (self->allocator.realloc) {
+      grown = self->allocator.realloc(
+          self->allocator.ctx, *items, *capacity * item_size, new_capacity * item_size);
+   } else {
+      grown = self->allocator.alloc(self->allocator.ctx, new_capacity * item_size);
+      if (grown && *items) {
+         memcpy(grown, *items, *capacity * item_size);
+         self->allocator.free(self->allocator.ctx, *items);
+      }
+   }
+   if (!grown) {
+      return false;
+   }
+   *items = grown;
+   *capacity = new_capacity;
+   memcpy(base + field->offset, &grown, sizeof(grown));
+   return true;
+}
+
+// whether `path` leads into the item of an array, which the decoder zeroed before filling it
+static bool raon_decode_in_item(const struct raon_decode_path *path) {
+   for (; path; path = path->parent) {
+      if (path->is_index) {
+         return true;
+      }
+   }
+   return false;
+}
+
+/*
+   Tells whether the items of a fixed array of structs were written by this call, in which case
+   they may own dynamic arrays. Otherwise the array is remembered as written from now on, since
+   its count and items are still whatever the caller left in them.
+
+   Returns: false if remembering the array failed
+*/
+static bool raon_decode_fixed_filled(
+    struct raon_decoder *self, const struct raon_decode_path *path, char *count, bool *filled) {
+   *filled = true;
+   if (raon_decode_in_item(path)) {
+      return true;
+   }
+   for (size_t i = 0; i < self->filled_len; i++) {
+      if (self->filled[i] == count) {
+         return true;
+      }
+   }
+
+   *filled = false;
+   if (self->filled_len == self->filled_capacity) {
+      const size_t capacity = self->filled_capacity ? self->filled_capacity * 2 : 4;
+      char **grown = self->allocator.alloc(self->allocator.ctx, capacity * sizeof(*grown));
+      if (!grown) {
+         return false;
+      }
+      if (self->filled_len) {
+         memcpy(grown, self->filled, self->filled_len * sizeof(*grown));
+      }
+      self->allocator.free(self->allocator.ctx, self->filled);
+      self->filled = grown;
+      self->filled_capacity = capacity;
+   }
+   self->filled[self->filled_len++] = count;
+   return true;
+}
+
+static bool raon_decode_array(struct raon_decoder *self, const struct raon_decode_path *path,
+    const struct raon_field *field, char *base, struct raon_token open) {
+   const bool fixed = field->type == raon_field_type_fixed_array;
+   const size_t item_size = raon_field_item_size(field);
+   char *items = base + field->offset;
+   size_t capacity = field->capacity;
+   // a repeated key replaces the items decoded for it before, along with what they allocated
+   if (fixed && field->item_type == raon_field_type_struct) {
+      bool filled;
+      if (!raon_decode_fixed_filled(self, path, base + field->len_offset, &filled)) {
+         return raon_decode_fail(self, path, open, raon_error_kind_out_of_memory);
+      }
+      if (filled) {
+         raon_schema_free_field(field, base, self->allocator);
+      }
+   } else if (!fixed) {
+      raon_schema_free_field(field, base, self->allocator);
+      items = NULL;
+      capacity = 0;
+   }
+
+   // the number of items is kept up to date, so that a failed decode can still be freed
+   size_t len = 0;
+   memcpy(base + field->len_offset, &len, sizeof(len));
+   for (;;) {
+      struct raon_token token = raon_lexer_eat(&self->lexer);
+      if (token.type == raon_token_type_array_close) {
+         return true;
+      }
+
+      const struct raon_decode_path item_path = { .parent = path, .index = len, .is_index = true };
+      if (len == capacity) {
+         if (fixed) {
+            return raon_decode_fail(self, &item_path, token, raon_error_kind_too_many_items);
+         }
+         if (!raon_decode_reserve(self, field, base, &items, &capacity)) {
+            return raon_decode_fail(self, &item_path, token, raon_error_kind_out_of_memory);
+         }
+      }
+
+      char *item = &items[len * item_size];
+      if (field->item_type == raon_field_type_struct) {
+         // fields missing from the text stay zeroed, and there's an item to free if this fails
+         memset(item, 0, item_size);
+         ++len;
+         memcpy(base + field->len_offset, &len, sizeof(len));
+         if (!raon_decode_item(self, &item_path, field->item_type, field->schema, item, token)) {
+            return false;
+         }
+      } else {
+         if (!raon_decode_item(self, &item_path, field->item_type, field->schema, item, token)) {
+            return false;
+         }
+         ++len;
+         memcpy(base + field->len_offset, &len, sizeof(len));
+      }
+
+      token = raon_lexer_eat(&self->lexer);
+      if (!raon_decode_is_separator(token, raon_token_type_array_close)) {
+         return raon_decode_unexpected(self, path, token);
+      }
+      if (token.type == raon_token_type_array_close) {
+         return true;
+      }
+   }
+}
+
+static bool raon_decode_field(struct raon_decoder *self, const struct raon_decode_path *path,
+    const struct raon_field *field, char *base, struct raon_token token) {
+   if (field->type != raon_field_type_fixed_array && field->type != raon_field_type_dynamic_array) {
+      return raon_decode_item(self, path, field->type, field->schema, base + field->offset, token);
+   }
+   if (token.type != raon_token_type_array_open || raon_field_item_size(field) == 0) {
+      return raon_decode_mismatch(self, path, token);
+   }
+   return raon_decode_array(self, path, field, base, token);
+}
+
+// a NULL `schema` means that the entry belongs to an unknown key and is skipped
+static bool raon_decode_entry(struct raon_decoder *self, const struct raon_decode_path *parent,
+    const struct raon_schema *schema, char *base, struct raon_token first_token,
+    enum raon_key_type *key_type) {
+   struct raon_decode_path path = { .parent = parent };
+   const struct raon_field *field = NULL;
+   switch (first_token.type) {
+   case raon_token_type_key:
+   case raon_token_type_string:
+      *key_type = raon_key_type_string;
+      path.key = first_token.str_val;
+      field = raon_schema_field(schema, path.key);
+      break;
+
+   case raon_token_type_int:
+      // fields only have string keys, the literal is only kept to name the key in errors
+      *key_type = raon_key_type_num;
+      path.key = (struct raon_str_slice) {
+         .ptr = &self->lexer.str[first_token.start],
+         .len = first_token.end - first_token.start,
+      };
+      break;
+
+   default:
+      return raon_decode_unexpected(self, parent, first_token);
+   }
+
+   struct raon_token token = raon_lexer_eat(&self->lexer);
+   // `<key>.<subkey>` is a block holding a single entry
+   if (token.type == raon_token_type_dot) {
+      const struct raon_token sub_token = raon_lexer_eat(&self->lexer);
+      enum raon_key_type sub_key_type;
+      if (!field) {
+         return raon_decode_entry(self, &path, NULL, NULL, sub_token, &sub_key_type);
+      }
+      if (field->type != raon_field_type_struct) {
+         return raon_decode_fail(self, &path, first_token, raon_error_kind_type_mismatch);
+      }
+      return raon_decode_entry(
+          self, &path, field->schema, base + field->offset, sub_token, &sub_key_type);
+   }
+   if (token.type != raon_token_type_equal) {
+      return raon_decode_unexpected(self, &path, token);
+   }
+
+   token = raon_lexer_eat(&self->lexer);
+   if (!field) {
+      return raon_decode_skip(self, &path, token);
+   }
+   return raon_decode_field(self, &path, field, base, token);
+}
+
+// entries of a block up to `end`, which is the closing brace, or the end of the text at the top
+static bool raon_decode_entries(struct raon_decoder *self, const struct raon_decode_path *path,
+    const struct raon_schema *schema, char *base, enum raon_token_type end) {
+   // the first key decides the key type of the whole block
+   enum raon_key_type block_key_type = raon_key_type_error;
+   for (;;) {
+      struct raon_token token = raon_lexer_eat(&self->lexer);
+      if (token.type == end) {
+         return true;
+      }
+      if (token.type == raon_token_type_newline) {
+         continue;
+      }
+
+      enum raon_key_type key_type;
+      if (!raon_decode_entry(self, path, schema, base, token, &key_type)) {
+         return false;
+      }
+      if (block_key_type != raon_key_type_error && key_type != block_key_type) {
+         return raon_decode_fail(self, path, token, raon_error_kind_mixed_keys);
+      }
+      block_key_type = key_type;
+
+      token = raon_lexer_eat(&self->lexer);
+      if (!raon_decode_is_separator(token, end)) {
+         return raon_decode_unexpected(self, path, token);
+      }
+      if (token.type == end) {
+         return true;
+      }
+   }
+}
+
+bool raon_decode(char *str, size_t len, const struct raon_schema *schema, void *target,
+    struct vec_allocator allocator, struct raon_decode_error *error) {
+   struct raon_decoder self = {
+      .lexer = raon_lexer_init(str, len),
+      .allocator = allocator,
+      .error = error,
+   };
+   if (error) {
+      *error = (struct raon_decode_error) { 0 };
+   }
+   const bool decoded = raon_decode_entries(&self, NULL, schema, target, raon_token_type_eof);
+   if (self.filled) {
+      allocator.free(allocator.ctx, self.filled);
+   }
+   return decoded;
+}
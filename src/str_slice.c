@@ -4,7 +4,8 @@
 
 // returns a zero value if the slice cannot contain the len specified
 struct raon_str_slice raon_slice_from_str(char *str, size_t len) {
-   if (len > strlen(str)) {
+   // only the first `len` bytes are inspected so slicing is linear in the slice and not the string
+   if (memchr(str, '\0', len)) {
       return (struct raon_str_slice) { 0 };
    }
    return (struct raon_str_slice) {
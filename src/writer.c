@@ -0,0 +1,356 @@
+// write() is POSIX, not C11
+#define _POSIX_C_SOURCE 200809L
+
+#include "internal.h"
+#include "raon.h"
+#include <errno.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+   #include <unistd.h>
+#elif defined(_WIN32)
+   #include <io.h>
+#endif
+
+#define RAON_WRITER_DEFAULT_INDENT "   "
+
+// === Sinks ===
+
+static bool raon_sink_file_write(void *ctx, const char *data, size_t len) {
+   return fwrite(data, 1, len, ctx) == len;
+}
+
+struct raon_sink raon_sink_file(FILE *file) {
+   return (struct raon_sink) { .write = raon_sink_file_write, .ctx = file };
+}
+
+static bool raon_sink_fd_write(void *ctx, const char *data, size_t len) {
+   const int fd = (int)(intptr_t)ctx;
+   while (len > 0) {
+#if defined(_WIN32)
+      const int written = _write(fd, data, len > 0x40000000 ? 0x40000000 : (unsigned)len);
+#else
+      const ssize_t written = write(fd, data, len);
+#endif
+      if (written < 0) {
+         if (errno == EINTR) {
+            continue;
+         }
+         return false;
+      }
+      data += written;
+      len -= (size_t)written;
+   }
+   return true;
+}
+
+struct raon_sink raon_sink_fd(int fd) {
+   return (struct raon_sink) { .write = raon_sink_fd_write, .ctx = (void *)(intptr_t)fd };
+}
+
+static bool raon_sink_buffer_write(void *ctx, const char *data, size_t len) {
+   struct raon_buffer *buffer = ctx;
+   if (buffer->capacity - buffer->len < len) {
+      size_t capacity = buffer->capacity ? buffer->capacity : RAON_WRITER_BUFFER_SIZE;
+      while (capacity - buffer->len < len) {
+         capacity *= 2;
+      }
+      char *tmp = realloc(buffer->data, capacity);
+      if (!tmp) {
+         return false;
+      }
+      buffer->data = tmp;
+      buffer->capacity = capacity;
+   }
+   memcpy(&buffer->data[buffer->len], data, len);
+   buffer->len += len;
+   return true;
+}
+
+struct raon_sink raon_sink_buffer(struct raon_buffer *buffer) {
+   return (struct raon_sink) { .write = raon_sink_buffer_write, .ctx = buffer };
+}
+
+// === Buffering ===
+
+void raon_writer_init(
+    struct raon_writer *self, struct raon_sink sink, struct raon_write_options options) {
+   self->sink = sink;
+   self->compact = options.compact;
+   self->keep_int_base = options.keep_int_base;
+   self->indent = options.indent ? options.indent : RAON_WRITER_DEFAULT_INDENT;
+   self->indent_len = strlen(self->indent);
+   self->failed = false;
+   self->len = 0;
+}
+
+void raon_writer_flush(struct raon_writer *self) {
+   if (self->len && !self->failed && !self->sink.write(self->sink.ctx, self->buf, self->len)) {
+      self->failed = true;
+   }
+   self->len = 0;
+}
+
+void raon_writer_put(struct raon_writer *self, const char *data, size_t len) {
+   if (RAON_WRITER_BUFFER_SIZE - self->len < len) {
+      raon_writer_flush(self);
+      // anything that wouldn't fit in an empty buffer goes straight to the sink
+      if (len >= RAON_WRITER_BUFFER_SIZE) {
+         if (!self->failed && !self->sink.write(self->sink.ctx, data, len)) {
+            self->failed = true;
+         }
+         return;
+      }
+   }
+   memcpy(&self->buf[self->len], data, len);
+   self->len += len;
+}
+
+static void raon_writer_put_char(struct raon_writer *self, char c) {
+   if (self->len == RAON_WRITER_BUFFER_SIZE) {
+      raon_writer_flush(self);
+   }
+   self->buf[self->len++] = c;
+}
+
+static void raon_writer_put_str(struct raon_writer *self, const char *str) {
+   raon_writer_put(self, str, strlen(str));
+}
+
+static void raon_writer_indent(struct raon_writer *self, size_t level) {
+   for (size_t i = 0; i < level; i++) {
+      raon_writer_put(self, self->indent, self->indent_len);
+   }
+}
+
+// === Formatting ===
+
+static void raon_writer_put_int(struct raon_writer *self, intptr_t value, unsigned base) {
+   char digits[66];
+   size_t len = 0;
+   if (value < 0) {
+      digits[len++] = '-';
+   }
+   // the magnitude is computed unsigned so that INTPTR_MIN doesn't overflow
+   const uint64_t magnitude = value < 0 ? 0 - (uint64_t)value : (uint64_t)value;
+   if (base == 16 || base == 8 || base == 2) {
+      digits[len++] = '0';
+      digits[len++] = base == 16 ? 'x' : base == 8 ? 'o' : 'b';
+   } else {
+      base = 10;
+   }
+   len += raon_format_uint(magnitude, base, &digits[len]);
+   raon_writer_put(self, digits, len);
+}
+
+static void raon_writer_put_float(struct raon_writer *self, double value) {
+   if (!isfinite(value)) {
+      self->failed = true;
+      return;
+   }
+   char digits[RAON_FORMAT_FLOAT_MAX];
+   raon_writer_put(self, digits, raon_format_float(value, digits));
+}
+
+// strings can't escape anything, so a quote or a NUL can't be written at all
+static void raon_writer_put_quoted(struct raon_writer *self, struct raon_str_slice str) {
+   if (raon_scan_find2(str.ptr, str.len, '"', '\0') != str.len) {
+      self->failed = true;
+      return;
+   }
+   raon_writer_put_char(self, '"');
+   raon_writer_put(self, str.ptr, str.len);
+   raon_writer_put_char(self, '"');
+}
+
+// keys that would lex as an identifier are written bare, everything else is quoted
+static bool raon_is_ident(struct raon_str_slice str) {
+   if (str.len == 0 || !raon_char_is(str.ptr[0], raon_char_class_ident_start)) {
+      return false;
+   }
+   for (size_t i = 1; i < str.len; i++) {
+      if (!raon_char_is(str.ptr[i], raon_char_class_ident)) {
+         return false;
+      }
+   }
+   return !(str.len == 4 && memcmp(str.ptr, "true", 4) == 0)
+       && !(str.len == 5 && memcmp(str.ptr, "false", 5) == 0);
+}
+
+static void raon_writer_put_key(struct raon_writer *self, const struct raon_entry *entry) {
+   switch (entry->key_type) {
+   case raon_key_type_string:
+      if (raon_is_ident(entry->str_key)) {
+         raon_writer_put(self, entry->str_key.ptr, entry->str_key.len);
+      } else {
+         raon_writer_put_quoted(self, entry->str_key);
+      }
+      break;
+
+   case raon_key_type_num:
+      raon_writer_put_int(self, entry->int_key, 10);
+      break;
+
+   case raon_key_type_error:
+      self->failed = true;
+      break;
+   }
+}
+
+static void raon_writer_put_entries(
+    struct raon_writer *self, const struct vector_of_raon_entry *entries, size_t level);
+
+static void raon_writer_put_value(struct raon_writer *self, struct raon_value value, size_t level) {
+   // lazy values have to be expanded first, see `raon_document_expand`
+   if (value.lazy) {
+      self->failed = true;
+      return;
+   }
+   switch (value.type) {
+   case raon_value_type_string:
+      raon_writer_put_quoted(self, value.str_val);
+      break;
+
+   case raon_value_type_int:
+      // the lexer only reads based literals without a sign
+      raon_writer_put_int(self, value.int_val,
+          self->keep_int_base && value.int_val >= 0 ? value.int_base : 10);
+      break;
+
+   case raon_value_type_bool:
+      raon_writer_put_str(self, value.bool_val ? "true" : "false");
+      break;
+
+   case raon_value_type_float:
+      raon_writer_put_float(self, value.float_val);
+      break;
+
+   case raon_value_type_block:
+      if (!value.block_val || vec_is_empty_raon_entry(value.block_val)) {
+         raon_writer_put(self, "{}", 2);
+      } else if (self->compact) {
+         raon_writer_put_char(self, '{');
+         raon_writer_put_entries(self, value.block_val, level + 1);
+         raon_writer_put_char(self, '}');
+      } else {
+         raon_writer_put(self, "{\n", 2);
+         raon_writer_put_entries(self, value.block_val, level + 1);
+         raon_writer_indent(self, level);
+         raon_writer_put_char(self, '}');
+      }
+      break;
+
+   case raon_value_type_array: {
+      // arrays stay on one line, the parser doesn't allow a newline right after `[`
+      raon_writer_put_char(self, '[');
+      const size_t len = raon_array_len(value.array_val);
+      for (size_t i = 0; i < len; i++) {
+         if (i > 0) {
+            raon_writer_put(self, ", ", self->compact ? 1 : 2);
+         }
+         raon_writer_put_value(self, raon_array_get(value.array_val, i), level);
+      }
+      raon_writer_put_char(self, ']');
+   } break;
+
+   case raon_value_type_error:
+      self->failed = true;
+      break;
+   }
+}
+
+static void raon_writer_put_entry(
+    struct raon_writer *self, const struct raon_entry *entry, size_t level) {
+   if (self->compact) {
+      raon_writer_put_key(self, entry);
+      raon_writer_put_char(self, '=');
+      raon_writer_put_value(self, entry->value, level);
+      return;
+   }
+   raon_writer_indent(self, level);
+   raon_writer_put_key(self, entry);
+   raon_writer_put(self, " = ", 3);
+   raon_writer_put_value(self, entry->value, level);
+   raon_writer_put_char(self, '\n');
+}
+
+static void raon_writer_put_entries(
+    struct raon_writer *self, const struct vector_of_raon_entry *entries, size_t level) {
+   for (size_t i = 0; i < entries->len && !self->failed; i++) {
+      if (self->compact && i > 0) {
+         raon_writer_put_char(self, ',');
+      }
+      raon_writer_put_entry(self, &entries->vec[i], level);
+   }
+}
+
+bool raon_write(const struct vector_of_raon_entry *entries, struct raon_sink sink,
+    struct raon_write_options options) {
+   struct raon_writer *self = malloc(sizeof(*self));
+   if (!self) {
+      return false;
+   }
+   raon_writer_init(self, sink, options);
+
+   raon_writer_put_entries(self, entries, 0);
+   if (self->compact && entries->len) {
+      raon_writer_put_char(self, '\n');
+   }
+   raon_writer_flush(self);
+
+   const bool success = !self->failed;
+   free(self);
+   return success;
+}
+
+// === Printing ===
+
+// the print functions are pretty writes to stdout that start at the context's indentation level
+static struct raon_writer *raon_print_begin(struct raon_print_ctx ctx) {
+   struct raon_writer *self = malloc(sizeof(*self));
+   if (self) {
+      raon_writer_init(self, raon_sink_file(stdout),
+          (struct raon_write_options) { .indent = ctx.indent });
+   }
+   return self;
+}
+
+static void raon_print_end(struct raon_writer *self) {
+   raon_writer_flush(self);
+   free(self);
+}
+
+void raon_print_entry(struct raon_print_ctx ctx, struct raon_entry entry) {
+   struct raon_writer *self = raon_print_begin(ctx);
+   if (self) {
+      raon_writer_put_entry(self, &entry, ctx.indent_level);
+      raon_print_end(self);
+   }
+}
+
+void raon_print_value(struct raon_print_ctx ctx, struct raon_value value) {
+   struct raon_writer *self = raon_print_begin(ctx);
+   if (self) {
+      raon_writer_put_value(self, value, ctx.indent_level);
+      raon_print_end(self);
+   }
+}
+
+void raon_print_array(struct raon_print_ctx ctx, struct vector_of_raon_value *array) {
+   raon_print_value(ctx, (struct raon_value) { .type = raon_value_type_array, .array_val = array });
+}
+
+void raon_print_entries(struct raon_print_ctx ctx, struct vector_of_raon_entry *entries) {
+   if (!entries) {
+      printf("(null)");
+      return;
+   }
+   struct raon_writer *self = raon_print_begin(ctx);
+   if (self) {
+      raon_writer_put_entries(self, entries, ctx.indent_level);
+      raon_print_end(self);
+   }
+}
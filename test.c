@@ -1,13 +1,22 @@
+// pipe() and friends are used to test parsing files that can't be mapped
+#define _POSIX_C_SOURCE 200809L
+
+#include "src/internal.h"
 #include "src/raon.h"
 #include "vendor/ht.h"
 #include <assert.h>
+#include <float.h>
+#include <math.h>
+#include <stdarg.h>
+#include <stddef.h>
 #include <stdio.h>
+#ifdef __linux__
+   #include <unistd.h>
+#endif
 
 #define HT_IMPLEMENTATION
 #include "vendor/ht.h"
 
-#define BUF_SIZE 20 * 1024 * 1024
-
 struct unit_test {
    char *type;
    char *input;
@@ -30,11 +39,149 @@ void test_num_values() {
       { "int trailing separator", "10_000_", false },
       { "int starting separator", "_10_000", false }, { "positive float", "0.5", true },
       { "negative float", "-0.5", true }, { "double float", "0.5.1", false },
-      { "negative double float", "-0.5.1", false }, { "float separator", "5_430.1_2", true } };
+      { "negative double float", "-0.5.1", false }, { "float separator", "5_430.1_2", true },
+      { "scientific float", "6.022e23", true }, { "scientific negative exponent", "2.5E-3", true },
+      { "scientific without dot", "1e+10", true }, { "scientific missing exponent", "1e", false },
+      { "float missing fraction", "1.", false }, { "float overflow", "1e400", false },
+      { "int max", "9223372036854775807", true }, { "int min", "-9223372036854775808", true },
+      { "int overflow", "9223372036854775808", false },
+      { "long int overflow", "100000000000000000000", false },
+      { "hex overflow", "0x1_0000_0000_0000_0000", false }, { "binary digit", "0b102", false },
+      { "empty hex", "0x", false }, { "int running into ident", "12abc", false } };
 
    run_lexer_test(raon_lexer_lex_num);
 }
 
+static struct raon_token lex_num_str(char *str) {
+   struct raon_lexer lexer = raon_lexer_init(str, strlen(str));
+   return raon_lexer_lex_num(&lexer);
+}
+
+void test_num_conversion(void) {
+   printf("Testing lexer int values: ");
+   assert(lex_num_str("0b1010_1010").int_val == 0xAA);
+   assert(lex_num_str("0o7_7").int_val == 077);
+   assert(lex_num_str("0xdead_BEEF").int_val == 0xdeadbeef);
+   assert(lex_num_str("-1_000").int_val == -1000);
+   assert(lex_num_str("-0").int_val == 0);
+   assert(lex_num_str("9223372036854775807").int_val == INTPTR_MAX);
+   assert(lex_num_str("-9223372036854775808").int_val == INTPTR_MIN);
+   printf("OK\n");
+
+   // hard cases for float parsers: halfway points, subnormals, the extremes and more than 19 digits
+   char *hard_cases[] = { "0.1", "-0.0", "1e23", "8.98846567431158e307", "1.7976931348623157e308",
+      "2.2250738585072011e-308", "2.2250738585072012e-308", "4.9406564584124654e-324",
+      "2.4703282292062327e-324", "2.4703282292062328e-324", "1e-400", "9007199254740993.0",
+      "9007199254740992.5000000000000000000000000000001", "7.2057594037927933e+16",
+      "123456789012345678901234567890.123456789e-10", "0.000000000000000000000000000001e30",
+      "179769313486231580793728971405303415079934132710037826936173778980444968292764750946649"
+      "017977587207096330286416692887910946555547851940402630657488671505820681908902000708383"
+      "676273854845817711531764475730270069855571366959622842914819860834936475292719074168444"
+      "365510704342711559699508093042880177904174497791.9999999999999999999999999999999999999"
+      "999999999999999999999999999999999999999999999999999999999999999999999999999999999999" };
+   printf("Testing lexer float edge cases: ");
+   for (size_t i = 0; i < sizeof(hard_cases) / sizeof(hard_cases[0]); i++) {
+      struct raon_token token = lex_num_str(hard_cases[i]);
+      const double expected = strtod(hard_cases[i], NULL);
+      assert(token.type == raon_token_type_float);
+      assert(memcmp(&token.float_val, &expected, sizeof(expected)) == 0);
+   }
+   printf("OK\n");
+
+   // random digit strings and exponents compared bit for bit against the C library
+   printf("Testing lexer floats against strtod: ");
+   uint64_t state = 0x9E3779B97F4A7C15u;
+   char literal[64];
+   for (size_t i = 0; i < 200000; i++) {
+      state = state * 6364136223846793005u + 1442695040888963407u;
+      const uint64_t random = state >> 11;
+      const int int_digits = 1 + random % 20;
+      const int frac_digits = 1 + (random >> 5) % 20;
+      const int exponent = (int)((random >> 10) % 700) - 350;
+      size_t len = 0;
+      uint64_t digits = state;
+      for (int d = 0; d < int_digits + frac_digits; d++) {
+         if (d == int_digits) {
+            literal[len++] = '.';
+         }
+         digits = digits * 6364136223846793005u + 1442695040888963407u;
+         literal[len++] = '0' + (digits >> 33) % 10;
+      }
+      snprintf(&literal[len], sizeof(literal) - len, "e%d", exponent);
+
+      struct raon_token token = lex_num_str(literal);
+      const double expected = strtod(literal, NULL);
+      if (expected > DBL_MAX) {
+         assert(token.type == raon_token_type_error);
+         continue;
+      }
+      assert(token.type == raon_token_type_float);
+      assert(memcmp(&token.float_val, &expected, sizeof(expected)) == 0);
+   }
+   printf("OK\n");
+}
+
+static bool formats_as(double value, const char *expected) {
+   char buf[RAON_FORMAT_FLOAT_MAX];
+   const size_t len = raon_format_float(value, buf);
+   return len == strlen(expected) && memcmp(buf, expected, len) == 0;
+}
+
+void test_num_formatting(void) {
+   printf("Testing shortest float formatting: ");
+   assert(formats_as(0.1, "0.1"));
+   assert(formats_as(5.2, "5.2"));
+   assert(formats_as(-0.0, "-0.0"));
+   assert(formats_as(100.0, "100.0"));
+   assert(formats_as(1e21, "1e21"));
+   assert(formats_as(1e23, "1e23"));
+   assert(formats_as(0.000025, "0.000025"));
+   assert(formats_as(1e-7, "1e-7"));
+   assert(formats_as(5e-324, "5e-324"));
+   assert(formats_as(DBL_MAX, "1.7976931348623157e308"));
+   assert(formats_as(9007199254740992.0, "9007199254740992.0"));
+   printf("OK\n");
+
+   // random bit patterns, half of them subnormal or with an empty mantissa, have to read back exactly
+   printf("Testing float formatting round trips: ");
+   uint64_t state = 0x2545F4914F6CDD1Du;
+   char buf[RAON_FORMAT_FLOAT_MAX + 1];
+   for (size_t i = 0; i < 200000; i++) {
+      state = state * 6364136223846793005u + 1442695040888963407u;
+      uint64_t bits = state;
+      if (i % 4 == 1) {
+         bits &= 0x800FFFFFFFFFFFFFu;
+      } else if (i % 4 == 2) {
+         bits &= 0xFFF0000000000000u;
+      }
+      double value;
+      memcpy(&value, &bits, sizeof(value));
+      if (!isfinite(value)) {
+         continue;
+      }
+      buf[raon_format_float(value, buf)] = '\0';
+      assert(strchr(buf, '.') || strchr(buf, 'e'));
+      const double parsed = strtod(buf, NULL);
+      assert(memcmp(&parsed, &value, sizeof(value)) == 0);
+   }
+   printf("OK\n");
+
+   printf("Testing int formatting: ");
+   const uint64_t ints[] = { 0, 9, 10, 99, 100, 12345, UINT64_MAX };
+   for (size_t i = 0; i < sizeof(ints) / sizeof(ints[0]); i++) {
+      buf[raon_format_uint(ints[i], 10, buf)] = '\0';
+      assert(strtoull(buf, NULL, 10) == ints[i]);
+      buf[raon_format_uint(ints[i], 16, buf)] = '\0';
+      assert(strtoull(buf, NULL, 16) == ints[i]);
+   }
+   char bin[65];
+   bin[raon_format_uint(0xA5, 2, bin)] = '\0';
+   assert(strcmp(bin, "10100101") == 0);
+   bin[raon_format_uint(0777, 8, bin)] = '\0';
+   assert(strcmp(bin, "777") == 0);
+   printf("OK\n");
+}
+
 void test_string_values(void) {
    struct unit_test inputs[] = { { "string literal", "\"whatever string\"", true },
       { "multiline string", "\"whatever\nstring\nwith newlines\n\"", true },
@@ -57,6 +204,116 @@ void test_ident_values(void) {
    run_lexer_test(raon_lexer_lex_ident);
 }
 
+void test_token_dispatch(void) {
+   // prefixes and extensions of the boolean literals are ordinary keys
+   char doc[] = "t tru truex true false falsey\n{ } [ ] . , = 1 \"s\" # comment\n @ x";
+   const enum raon_token_type expected[] = {
+      raon_token_type_key,
+      raon_token_type_key,
+      raon_token_type_key,
+      raon_token_type_bool,
+      raon_token_type_bool,
+      raon_token_type_key,
+      raon_token_type_newline,
+      raon_token_type_block_open,
+      raon_token_type_block_close,
+      raon_token_type_array_open,
+      raon_token_type_array_close,
+      raon_token_type_dot,
+      raon_token_type_comma,
+      raon_token_type_equal,
+      raon_token_type_int,
+      raon_token_type_string,
+      raon_token_type_newline,
+      raon_token_type_error,
+      raon_token_type_key,
+      raon_token_type_eof,
+   };
+
+   printf("Testing token dispatch: ");
+   struct raon_lexer lexer = raon_lexer_init(doc, strlen(doc));
+   for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+      assert(raon_lexer_eat(&lexer).type == expected[i]);
+   }
+   printf("OK\n");
+
+   char invalid[] = "x = 1\ny = $";
+   printf("Testing invalid characters are rejected: ");
+   assert(raon_parse(VEC_DEFAULT_ALLOCATOR, invalid, strlen(invalid)) == NULL);
+   printf("OK\n");
+}
+
+void test_token_positions(void) {
+   char doc[] = "a = 1\nb = \"x\ny\"\n\n  c = [true]";
+   struct raon_lexer lexer = raon_lexer_init(doc, strlen(doc));
+   struct raon_line_table table = raon_line_table_init(doc, strlen(doc));
+
+   printf("Testing token offsets: ");
+   struct raon_token token = raon_lexer_eat(&lexer);
+   assert(token.start == 0 && token.end == 1);
+   raon_lexer_eat(&lexer);
+   token = raon_lexer_eat(&lexer);
+   assert(token.type == raon_token_type_int && token.start == 4 && token.end == 5);
+   token = raon_lexer_eat(&lexer);
+   assert(token.type == raon_token_type_newline && token.start == 5 && token.end == 6);
+   raon_lexer_eat(&lexer);
+   raon_lexer_eat(&lexer);
+   token = raon_lexer_eat(&lexer);
+   assert(token.type == raon_token_type_string && token.start == 10 && token.end == 15);
+   printf("OK\n");
+
+   printf("Testing line and column lookup: ");
+   // every offset, out of order, including the end of the text and past it
+   for (size_t i = 0; i <= sizeof(doc); i++) {
+      const size_t offset = (i * 7) % (sizeof(doc) + 1);
+      size_t line = 1, col = 0;
+      for (size_t j = 0; j < offset && j < strlen(doc); j++) {
+         line += doc[j] == '\n';
+         col = doc[j] == '\n' ? 0 : col + 1;
+      }
+      const struct raon_position position = raon_lexer_position(&lexer, offset);
+      assert(position.line == line && position.col == col);
+      const struct raon_position cached = raon_line_table_position(&table, offset);
+      assert(cached.line == line && cached.col == col);
+   }
+   const struct raon_position c = raon_line_table_position(&table, 19);
+   assert(c.line == 5 && c.col == 2);
+   raon_line_table_free(&table);
+   printf("OK\n");
+}
+
+void test_unterminated_buffers(void) {
+   // only the first `len` bytes belong to the document, the rest must never be looked at
+   char num_buf[] = { '1', '2', '3', '4', '5' };
+   struct raon_lexer lexer = raon_lexer_init(num_buf, 3);
+   struct raon_token token = raon_lexer_lex_num(&lexer);
+   printf("Testing length bounded number: ");
+   assert(token.type == raon_token_type_int && token.int_val == 123);
+   printf("OK\n");
+
+   char ident_buf[] = { 'k', 'e', 'y', 's' };
+   lexer = raon_lexer_init(ident_buf, 3);
+   token = raon_lexer_lex_ident(&lexer);
+   printf("Testing length bounded identifier: ");
+   assert(token.type == raon_token_type_key && token.str_val.len == 3);
+   printf("OK\n");
+
+   char str_buf[] = { '"', 'a', 'b', '"', 'c' };
+   lexer = raon_lexer_init(str_buf, 3);
+   token = raon_lexer_lex_string(&lexer);
+   printf("Testing length bounded unterminated string: ");
+   assert(token.type == raon_token_type_error);
+   printf("OK\n");
+
+   char doc[] = "x = 1\ny = \"two\", z = 3";
+   struct vector_of_raon_entry *entries
+       = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, strlen("x = 1\ny = \"two\""));
+   printf("Testing parsing a sub-range of a buffer: ");
+   assert(entries && vec_len_raon_entry(entries) == 2);
+   printf("OK\n");
+   raon_free_entries(entries);
+}
+
 #define run_parser_test(parser_type, parser_func, value_assertion)                                 \
    for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {                               \
       struct raon_lexer lexer = raon_lexer_init(inputs[i].input, strlen(inputs[i].input));         \
@@ -101,45 +358,1558 @@ void test_blocks(void) {
    run_parser_test(struct vector_of_raon_entry *, raon_parse_block, value != NULL);
 }
 
+void test_vectors(void) {
+   struct vector_of_raon_value *values = vec_new_raon_value(VEC_DEFAULT_ALLOCATOR);
+   assert(values);
+
+   printf("Testing vector reserve: ");
+   assert(vec_reserve_raon_value(values, 100));
+   assert(vec_capacity_raon_value(values) >= 100);
+   struct raon_value *buffer = values->vec;
+   for (intptr_t i = 0; i < 100; i++) {
+      assert(vec_push_raon_value(
+          values, (struct raon_value) { .type = raon_value_type_int, .int_val = i }));
+   }
+   assert(values->vec == buffer);
+   printf("OK\n");
+
+   printf("Testing vector pop keeps capacity: ");
+   size_t capacity = vec_capacity_raon_value(values);
+   struct raon_value value;
+   for (size_t i = 0; i < 50; i++) {
+      assert(vec_pop_raon_value(values, &value));
+   }
+   assert(value.int_val == 50 && vec_capacity_raon_value(values) == capacity);
+   printf("OK\n");
+
+   printf("Testing vector shrink to fit: ");
+   assert(vec_shrink_to_fit_raon_value(values));
+   assert(vec_capacity_raon_value(values) == 50);
+   vec_get_raon_value(values, 49, &value);
+   assert(value.int_val == 49);
+   printf("OK\n");
+
+   printf("Testing vector insert: ");
+   assert(vec_insert_raon_value(
+       values, 0, (struct raon_value) { .type = raon_value_type_int, .int_val = -1 }));
+   vec_get_raon_value(values, 0, &value);
+   assert(value.int_val == -1 && vec_len_raon_value(values) == 51);
+   vec_get_raon_value(values, 50, &value);
+   assert(value.int_val == 49);
+   printf("OK\n");
+
+   vec_free_raon_value(values);
+}
+
+void test_arena(void) {
+   struct raon_arena arena = raon_arena_init(128);
+
+   printf("Testing arena alignment: ");
+   for (size_t i = 1; i < 64; i++) {
+      void *ptr = raon_arena_alloc(&arena, i);
+      assert(ptr && (uintptr_t)ptr % _Alignof(max_align_t) == 0);
+   }
+   printf("OK\n");
+
+   printf("Testing arena oversized allocation: ");
+   char *big = raon_arena_alloc(&arena, 4096);
+   assert(big);
+   memset(big, 0xAB, 4096);
+   printf("OK\n");
+
+   raon_arena_free(&arena);
+   assert(arena.chunks == NULL);
+}
+
+void test_documents(void) {
+   char valid[] = "x = 5\nblock = { a = [1, 2, 3], b = { c = \"d\" } }\nlist = [{ y = true }]";
+   printf("Testing document parsing: ");
+   struct raon_document *doc = raon_parse_document(valid, strlen(valid));
+   assert(doc && vec_len_raon_entry(doc->entries) == 3);
+   raon_document_free(doc);
+   printf("OK\n");
+
+   char invalid[] = "x = 5\nblock = { a = [1, true] }";
+   printf("Testing invalid document parsing: ");
+   assert(raon_parse_document(invalid, strlen(invalid)) == NULL);
+   printf("OK\n");
+}
+
+static bool entries_equal(struct vector_of_raon_entry *a, struct vector_of_raon_entry *b);
+
+static bool slices_equal(struct raon_str_slice a, struct raon_str_slice b) {
+   return a.len == b.len && (a.len == 0 || memcmp(a.ptr, b.ptr, a.len) == 0);
+}
+
+static bool values_equal(struct raon_value a, struct raon_value b) {
+   if (a.type != b.type) {
+      return false;
+   }
+   switch (a.type) {
+   case raon_value_type_string:
+      return slices_equal(a.str_val, b.str_val);
+   case raon_value_type_int:
+      return a.int_val == b.int_val;
+   case raon_value_type_bool:
+      return a.bool_val == b.bool_val;
+   case raon_value_type_float:
+      return a.float_val == b.float_val;
+   case raon_value_type_block:
+      return entries_equal(a.block_val, b.block_val);
+   case raon_value_type_array:
+      if (raon_array_len(a.array_val) != raon_array_len(b.array_val)) {
+         return false;
+      }
+      for (size_t i = 0; i < raon_array_len(a.array_val); i++) {
+         if (!values_equal(raon_array_get(a.array_val, i), raon_array_get(b.array_val, i))) {
+            return false;
+         }
+      }
+      return true;
+   default:
+      return false;
+   }
+}
+
+static bool entries_equal(struct vector_of_raon_entry *a, struct vector_of_raon_entry *b) {
+   if (a->len != b->len) {
+      return false;
+   }
+   for (size_t i = 0; i < a->len; i++) {
+      struct raon_entry *x = &a->vec[i], *y = &b->vec[i];
+      if (x->key_type != y->key_type
+          || (x->key_type == raon_key_type_string ? !slices_equal(x->str_key, y->str_key)
+                                                  : x->int_key != y->int_key)
+          || !values_equal(x->value, y->value)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static struct raon_document *parse_in_chunks(char *str, size_t len, size_t chunk_len) {
+   struct raon_parser parser = raon_parser_init();
+   for (size_t i = 0; i < len; i += chunk_len) {
+      if (!raon_parser_feed(&parser, &str[i], len - i < chunk_len ? len - i : chunk_len)) {
+         break;
+      }
+   }
+   return raon_parser_finish(&parser);
+}
+
+void test_packed_arrays(void) {
+   char doc[] = "ints = [1, -2, 3]\n"
+                "floats = [0.5, -1.25]\n"
+                "bools = [true, false, true, true, false, false, false, false, true, true]\n"
+                "based = [0x1, 0x2]\n"
+                "mixed = [1, 0x2, 3]\n"
+                "grown = [1, 0x2, 3, 4, 5, 6, 7, 8, 9, 10, 0b1011]\n"
+                "strings = [\"a\", \"b\"]\n"
+                "empty = []\n";
+   struct raon_document *parsed = raon_parse_document(doc, strlen(doc));
+   assert(parsed);
+
+   printf("Testing packed array views: ");
+   const intptr_t *ints;
+   const double *floats;
+   const uint8_t *bools;
+   size_t len;
+   struct vector_of_raon_value *array = raon_block_get(parsed->entries, "ints", 4)->array_val;
+   assert(array->len == 0 && raon_array_len(array) == 3);
+   assert(raon_array_as_ints(array, &ints, &len) && len == 3);
+   assert(ints[0] == 1 && ints[1] == -2 && ints[2] == 3);
+   assert(!raon_array_as_floats(array, &floats, &len));
+
+   array = raon_block_get(parsed->entries, "floats", 6)->array_val;
+   assert(raon_array_as_floats(array, &floats, &len) && len == 2);
+   assert(floats[0] == 0.5 && floats[1] == -1.25);
+
+   array = raon_block_get(parsed->entries, "bools", 5)->array_val;
+   assert(raon_array_as_bools(array, &bools, &len) && len == 10);
+   assert(bools[0] == 0x0D && bools[1] == 0x03);
+   const struct raon_value last = raon_array_get(array, 9);
+   assert(last.type == raon_value_type_bool && last.bool_val);
+   assert(raon_array_get(array, 10).type == raon_value_type_error);
+
+   array = raon_block_get(parsed->entries, "empty", 5)->array_val;
+   assert(raon_array_as_ints(array, &ints, &len) && len == 0);
+   assert(raon_array_as_bools(array, &bools, &len) && len == 0);
+   printf("OK\n");
+
+   printf("Testing packed int bases: ");
+   array = raon_block_get(parsed->entries, "based", 5)->array_val;
+   assert(raon_array_as_ints(array, &ints, &len) && len == 2);
+   assert(raon_array_get(array, 1).int_base == 16 && !array->packed.int_bases);
+
+   // ints written in different bases are packed all the same, with a base for each of them
+   array = raon_block_get(parsed->entries, "mixed", 5)->array_val;
+   assert(raon_array_as_ints(array, &ints, &len) && len == 3 && array->len == 0);
+   assert(raon_array_get(array, 0).int_base == 0 && raon_array_get(array, 1).int_base == 16);
+   assert(raon_array_get(array, 2).int_val == 3 && raon_array_get(array, 2).int_base == 0);
+   array = raon_block_get(parsed->entries, "grown", 5)->array_val;
+   assert(raon_array_as_ints(array, &ints, &len) && len == 11 && ints[10] == 11);
+   assert(raon_array_get(array, 10).int_base == 2 && raon_array_get(array, 9).int_base == 0);
+   printf("OK\n");
+
+   printf("Testing unpacked arrays: ");
+
+   array = raon_block_get(parsed->entries, "strings", 7)->array_val;
+   assert(array->len == 2 && !raon_array_as_ints(array, &ints, &len));
+   printf("OK\n");
+
+   printf("Testing packed arrays with the default allocator: ");
+   struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, strlen(doc));
+   assert(entries && entries_equal(entries, parsed->entries));
+   raon_free_entries(entries);
+   printf("OK\n");
+
+   raon_document_free(parsed);
+}
+
+void test_incremental_parser(void) {
+   char doc[] = "# header comment, with a comma\n"
+                "name = \"multi\nline, string # not a comment\"\n"
+                "nested = { a = [[1, 2], [3, 4]], b = { c = \"}\" } }, inline = 0x_ff\n"
+                "float = 6.022e23\n"
+                "dotted.key = -12_345 # trailing\n"
+                "last = true";
+
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   assert(expected);
+
+   printf("Testing incremental parsing at every chunk size: ");
+   for (size_t chunk_len = 1; chunk_len <= strlen(doc); chunk_len++) {
+      struct raon_document *chunked = parse_in_chunks(doc, strlen(doc), chunk_len);
+      assert(chunked && entries_equal(expected->entries, chunked->entries));
+      raon_document_free(chunked);
+   }
+   printf("OK\n");
+   raon_document_free(expected);
+
+   printf("Testing incremental parsing staging: ");
+   // many small entries fed a few bytes at a time never stage more than the smallest buffer
+   struct raon_parser parser = raon_parser_init();
+   for (int i = 0; i < 100000; i++) {
+      char entry[32];
+      const int len = snprintf(entry, sizeof(entry), "key%d = %d\n", i, i);
+      for (int j = 0; j < len; j += 5) {
+         assert(raon_parser_feed(&parser, &entry[j], len - j < 5 ? (size_t)(len - j) : 5));
+         assert(parser.pending_capacity <= 4096);
+      }
+   }
+   // a big entry is staged whole, the staging buffer only shrinks back once it's complete
+   char big[64 * 1024];
+   memset(big, 'a', sizeof(big));
+   assert(raon_parser_feed(&parser, "big = \"", 7));
+   assert(raon_parser_feed(&parser, big, sizeof(big)) && parser.pending_capacity > sizeof(big));
+   assert(raon_parser_feed(&parser, "\"\nafter = 1\n", 12) && parser.pending_capacity <= 4096);
+   struct raon_document *streamed = raon_parser_finish(&parser);
+   assert(streamed && vec_len_raon_entry(streamed->entries) == 100002);
+   raon_document_free(streamed);
+   printf("OK\n");
+
+   printf("Testing incremental parsing of an empty input: ");
+   parser = raon_parser_init();
+   struct raon_document *empty = raon_parser_finish(&parser);
+   assert(empty && vec_len_raon_entry(empty->entries) == 0);
+   raon_document_free(empty);
+   printf("OK\n");
+
+   printf("Testing incremental parsing failures: ");
+   char unterminated[] = "x = 1\ny = \"never closed\nz = 2\n";
+   assert(parse_in_chunks(unterminated, strlen(unterminated), 4) == NULL);
+   char invalid[] = "x = 1\ny = [1, true]\nz = 2\n";
+   parser = raon_parser_init();
+   assert(raon_parser_feed(&parser, invalid, strlen(invalid)) == false);
+   assert(raon_parser_feed(&parser, "w = 3\n", 6) == false);
+   assert(raon_parser_finish(&parser) == NULL);
+   printf("OK\n");
+}
+
+// writes every event as a short tag so whole parses can be compared as strings
+struct event_log {
+   char buf[512];
+   size_t len;
+   // the callback that returns false once this many events were logged, 0 never stops
+   size_t stop_after;
+};
+
+static bool log_event(struct event_log *log, const char *fmt, ...) {
+   va_list args;
+   va_start(args, fmt);
+   log->len += vsnprintf(&log->buf[log->len], sizeof(log->buf) - log->len, fmt, args);
+   va_end(args);
+   return log->stop_after == 0 || --log->stop_after > 0;
+}
+
+static bool log_key(void *ctx, struct raon_key key) {
+   if (key.type == raon_key_type_string) {
+      return log_event(ctx, "k:%.*s ", (int)key.str_key.len, key.str_key.ptr);
+   }
+   return log_event(ctx, "k:%ld ", (long)key.int_key);
+}
+
+static bool log_value(void *ctx, struct raon_value value) {
+   switch (value.type) {
+   case raon_value_type_string:
+      return log_event(ctx, "s:%.*s ", (int)value.str_val.len, value.str_val.ptr);
+   case raon_value_type_int:
+      return log_event(ctx, "i:%ld ", (long)value.int_val);
+   case raon_value_type_bool:
+      return log_event(ctx, "b:%d ", value.bool_val);
+   default:
+      return log_event(ctx, "f:%g ", value.float_val);
+   }
+}
+
+static bool log_block_begin(void *ctx) { return log_event(ctx, "{ "); }
+static bool log_block_end(void *ctx) { return log_event(ctx, "} "); }
+static bool log_array_begin(void *ctx) { return log_event(ctx, "[ "); }
+static bool log_array_end(void *ctx) { return log_event(ctx, "] "); }
+
+void test_block_merging(void) {
+   printf("Testing merging of repeated blocks: ");
+   char doc[] = "a.b = 1\n"
+                "c = 2\n"
+                "a.d = { e = 1 }\n"
+                "a.d.f = 2\n"
+                "a = { g = 3 }\n"
+                "m = { 1 = { x = 1 }, 1 = { y = 2 } }\n";
+   char merged[] = "a = { b = 1, d = { e = 1, f = 2 }, g = 3 }\n"
+                   "c = 2\n"
+                   "m = { 1 = { x = 1, y = 2 } }\n";
+   struct raon_document *parsed = raon_parse_document(doc, strlen(doc));
+   struct raon_document *expected = raon_parse_document(merged, strlen(merged));
+   assert(parsed && expected && entries_equal(parsed->entries, expected->entries));
+
+   struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, doc, strlen(doc));
+   assert(entries && entries_equal(entries, expected->entries));
+   raon_free_entries(entries);
+
+   for (size_t chunk_len = 1; chunk_len <= strlen(doc); chunk_len++) {
+      struct raon_document *chunked = parse_in_chunks(doc, strlen(doc), chunk_len);
+      assert(chunked && entries_equal(chunked->entries, expected->entries));
+      raon_document_free(chunked);
+   }
+   raon_document_free(expected);
+   raon_document_free(parsed);
+
+   // enough dotted keys to go through the key index
+   char big[64 * 1024] = "";
+   for (int i = 0; i < 2000; i++) {
+      snprintf(big + strlen(big), sizeof(big) - strlen(big), "big.key_%d = %d\n", i, i);
+   }
+   parsed = raon_parse_document(big, strlen(big));
+   assert(parsed && parsed->entries->len == 1);
+   struct vector_of_raon_entry *block = parsed->entries->vec[0].value.block_val;
+   assert(block->len == 2000);
+   for (int i = 0; i < 2000; i++) {
+      assert(block->vec[i].value.int_val == i);
+   }
+   assert(raon_block_get(block, "key_1999", 8)->int_val == 1999);
+   raon_document_free(parsed);
+   printf("OK\n");
+}
+
+// keeps track of how many allocations are still alive, to check that failed parses free everything
+static void *counting_alloc(void *ctx, size_t size) {
+   void *ptr = malloc(size);
+   *(size_t *)ctx += ptr != NULL;
+   return ptr;
+}
+
+static void counting_free(void *ctx, void *ptr) {
+   *(size_t *)ctx -= ptr != NULL;
+   free(ptr);
+}
+
+static struct vec_allocator counting_allocator(size_t *live) {
+   return (struct vec_allocator) { .alloc = counting_alloc, .free = counting_free, .ctx = live };
+}
+
+void test_duplicate_keys(void) {
+   printf("Testing duplicated keys: ");
+   // the rejected entries hold blocks and arrays of their own, which have to be freed with them
+   char *duplicated[] = { "x = 1\nx = 2", "x = 1\nx.y = 2", "x.y = 1\nx = 2",
+      "a = { b = 1, b = 2 }", "a.b = 1\na.b = 2", "a.b.c = 1\na = { b = { c = 2 } }",
+      "m = { 1 = 1, 1 = 2 }", "\"x\" = 1\nx = 2", "a = { b = [1], c = { d = [2] }, c = [3] }",
+      "a = { b = { c = [1] } }\na = [{ d = 1 }]", "a.b = { c = [1] }\na.b.c.d = 2" };
+   size_t live = 0;
+   for (size_t i = 0; i < sizeof(duplicated) / sizeof(duplicated[0]); i++) {
+      const size_t len = strlen(duplicated[i]);
+      assert(raon_parse_document(duplicated[i], len) == NULL);
+      assert(raon_parse(counting_allocator(&live), duplicated[i], len) == NULL && live == 0);
+      assert(parse_in_chunks(duplicated[i], len, 1) == NULL);
+   }
+
+   // big blocks are checked through the key index
+   char big[64 * 1024] = "b = { ";
+   for (int i = 0; i < 100; i++) {
+      snprintf(big + strlen(big), sizeof(big) - strlen(big), "k%d = %d, ", i, i);
+   }
+   strcat(big, "}\n");
+   struct raon_document *doc = raon_parse_document(big, strlen(big));
+   assert(doc);
+   raon_document_free(doc);
+   strcpy(&big[strlen(big) - 2], "k42 = 0 }\n");
+   assert(raon_parse_document(big, strlen(big)) == NULL);
+
+   // a merge that fails on a nested key leaves both blocks as they were
+   char earlier[] = "a = { b = { c = 1 } }";
+   char later[] = "a = { d = [1], b = { e = 2, c = 2 } }";
+   struct vector_of_raon_entry *entries
+       = raon_parse(counting_allocator(&live), earlier, strlen(earlier));
+   struct raon_lexer lexer = raon_lexer_init(later, strlen(later));
+   struct raon_entry entry
+       = raon_parse_entry(counting_allocator(&live), &lexer, raon_lexer_eat(&lexer));
+   assert(entries && entry.key_type == raon_key_type_string);
+   assert(!raon_push_entry(entries, entry));
+   struct raon_value *a = raon_block_get(entries, "a", 1);
+   assert(a->block_val->len == 1 && raon_block_get(a->block_val, "b", 1)->block_val->len == 1);
+   assert(entry.value.block_val->len == 2);
+   raon_free_entries(entry.value.block_val);
+   raon_free_entries(entries);
+   assert(live == 0);
+   printf("OK\n");
+
+   printf("Testing mixed types: ");
+   char *mixed[] = { "x = [1, 2, true]", "x = [[1], 2]", "x = { a = 1, 2 = 3 }", "a = 1\n5 = 2",
+      "x = [{ a = 1 }, [1]]", "x.y = [{ a = 1 }, [2]]", "x = { a = [1] }\n5 = { b = [2] }",
+      "x = { a = { b = [1] }, 2 = { c = [2] } }" };
+   for (size_t i = 0; i < sizeof(mixed) / sizeof(mixed[0]); i++) {
+      assert(raon_parse_document(mixed[i], strlen(mixed[i])) == NULL);
+      assert(raon_parse(counting_allocator(&live), mixed[i], strlen(mixed[i])) == NULL);
+      assert(live == 0);
+   }
+   printf("OK\n");
+}
+
+void test_lazy_parsing(void) {
+   printf("Testing lazy parsing: ");
+   char doc[] = "a = { b = [[1, 2], [3]], c = \"} ] #\", d = {\n"
+                "   e = true # } not the end\n"
+                "} }\n"
+                "f = [{ g = \"[\" }, { g = \"{\n\" }]\n"
+                "h = 1\n"
+                "a.i = 2\n"
+                "j = []\n";
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   struct raon_document *lazy = raon_parse_document_lazy(doc, strlen(doc));
+   assert(expected && lazy && lazy->entries->len == 4);
+
+   // merging `a.i` into `a` had to parse `a`, but only its first level
+   struct raon_value *a = raon_block_get(lazy->entries, "a", 1);
+   assert(!a->lazy && raon_block_get(a->block_val, "i", 1)->int_val == 2);
+   struct raon_value *b = raon_block_get(a->block_val, "b", 1);
+   assert(b->lazy && b->lazy_text.len == strlen("[[1, 2], [3]]"));
+   struct vector_of_raon_value *rows = raon_value_array(lazy, b);
+   assert(rows && rows->len == 2 && rows->vec[1].lazy);
+   assert(raon_array_get(raon_value_array(lazy, &rows->vec[1]), 0).int_val == 3);
+   assert(raon_value_block(lazy, b) == NULL);
+
+   struct raon_value *f = raon_block_get(lazy->entries, "f", 1);
+   assert(f->lazy && raon_block_get(lazy->entries, "h", 1)->int_val == 1);
+   struct vector_of_raon_entry *second = raon_value_block(lazy, &raon_value_array(lazy, f)->vec[1]);
+   struct raon_value *g = raon_block_get(second, "g", 1);
+   assert(g && g->str_val.len == 2);
+
+   // lazy values can't be written until they're parsed
+   struct raon_buffer buffer = { 0 };
+   assert(!raon_write(lazy->entries, raon_sink_buffer(&buffer), (struct raon_write_options) { 0 }));
+   assert(raon_document_expand(lazy) && entries_equal(lazy->entries, expected->entries));
+   buffer.len = 0;
+   assert(raon_write(lazy->entries, raon_sink_buffer(&buffer), (struct raon_write_options) { 0 }));
+   free(buffer.data);
+   raon_document_free(lazy);
+   raon_document_free(expected);
+
+   // skipping leaves the lexer on the same byte as parsing does
+   char lines[] = "a = {\n b = \"\n\" }, c = 1";
+   struct raon_lexer eager_lexer = raon_lexer_init(lines, strlen(lines));
+   struct raon_lexer lazy_lexer = raon_lexer_init(lines, strlen(lines));
+   lazy_lexer.lazy = true;
+   struct raon_entry eager_entry = raon_parse_entry(
+       VEC_DEFAULT_ALLOCATOR, &eager_lexer, raon_lexer_eat(&eager_lexer));
+   raon_parse_entry(VEC_DEFAULT_ALLOCATOR, &lazy_lexer, raon_lexer_eat(&lazy_lexer));
+   raon_free_entries(eager_entry.value.block_val);
+   assert(eager_lexer.idx == lazy_lexer.idx);
+
+   // errors inside of a skipped value only show up once it's accessed
+   char *broken[] = { "a = { b = }", "a = { b = 1 ]", "a = [1, true]", "a = [[1], { b = 1 }]" };
+   for (size_t i = 0; i < sizeof(broken) / sizeof(broken[0]); i++) {
+      lazy = raon_parse_document_lazy(broken[i], strlen(broken[i]));
+      assert(lazy && !raon_document_expand(lazy));
+      raon_document_free(lazy);
+   }
+   // expanding parses deep nesting in one go, and half accessed values are still expanded
+   const size_t levels = 2000;
+   char *deep = malloc(20 + 2 * levels);
+   assert(deep);
+   memcpy(deep, "a = [", 5);
+   memset(deep + 5, '[', levels);
+   memset(deep + 5 + levels, ']', levels);
+   memcpy(deep + 5 + 2 * levels, ", [[1]]]", 8);
+   lazy = raon_parse_document_lazy(deep, 13 + 2 * levels);
+   struct raon_value *outer = raon_block_get(lazy->entries, "a", 1);
+   struct vector_of_raon_value *halves = raon_value_array(lazy, outer);
+   assert(halves && halves->vec[0].lazy && halves->vec[1].lazy);
+   assert(raon_document_expand(lazy) && !halves->vec[0].lazy && !halves->vec[1].lazy);
+   struct raon_value innermost = halves->vec[0];
+   for (size_t i = 1; i < levels; i++) {
+      assert(innermost.array_val->len == 1 && !innermost.array_val->vec[0].lazy);
+      innermost = innermost.array_val->vec[0];
+   }
+   assert(innermost.array_val->len == 0);
+   assert(raon_array_get(halves->vec[1].array_val->vec[0].array_val, 0).int_val == 1);
+   raon_document_free(lazy);
+   free(deep);
+
+   char *unbalanced[] = { "a = {", "a = { b = \"}", "a = [1, # ]",
+      "a = {}\na = { b = 1 }\na = { b = 2 }" };
+   for (size_t i = 0; i < sizeof(unbalanced) / sizeof(unbalanced[0]); i++) {
+      assert(!raon_parse_document_lazy(unbalanced[i], strlen(unbalanced[i])));
+   }
+   printf("OK\n");
+}
+
+// the entries are shaped so that splits land inside of multiline strings, comments and blocks
+static char *generate_split_document(size_t capacity, bool merged, size_t *len) {
+   char *doc = malloc(capacity + 64);
+   assert(doc);
+   *len = 0;
+   for (int i = 0; *len < capacity - 256; i++) {
+      *len += snprintf(&doc[*len], capacity - *len,
+          "k%d = { s = \"a,\n# not a comment\n}, [\", n = [1, 2], m = {\n x = [3],\n y = 1 } }\n"
+          "# a comment with a \" and a {\n"
+          "%s%d = %d, \"q%d\" = \"}\"\n",
+          i, merged ? "shared.k" : "u", i, i, i);
+   }
+   return doc;
+}
+
+void test_parallel_parsing(void) {
+   printf("Testing parallel parsing: ");
+   for (int merged = 0; merged < 2; merged++) {
+      size_t len = 0;
+      char *doc = generate_split_document(8 * 1024 * 1024, merged, &len);
+      struct raon_document *expected = raon_parse_document(doc, len);
+      assert(expected);
+      for (size_t threads = 0; threads <= 8; threads++) {
+         struct raon_document *parsed = raon_parse_document_parallel(doc, len, threads);
+         assert(parsed && entries_equal(parsed->entries, expected->entries));
+         // the top level is indexed up front, lookups from several threads would race to build it
+         assert(parsed->entries->index);
+         assert(raon_block_get(parsed->entries, "q12345", 6)->str_val.len == 1);
+         // the blocks repeated under `shared` are merged across the threads' parts too
+         const struct raon_value *shared = raon_block_get(parsed->entries, "shared", 6);
+         assert(merged ? shared->block_val->len > 1000 : shared == NULL);
+         raon_document_free(parsed);
+      }
+
+      // a key repeated in another part, and an error at the very end
+      memcpy(&doc[len], "k0 = 1\n", 7);
+      assert(!raon_parse_document_parallel(doc, len + 7, 4));
+      memcpy(&doc[len], "x = {\n", 6);
+      assert(!raon_parse_document_parallel(doc, len + 6, 4));
+      memcpy(&doc[len], "5 = 1\n", 6);
+      assert(!raon_parse_document_parallel(doc, len + 6, 4));
+
+      // the lexer stops at a NUL, so nothing after it may be parsed
+      memcpy(&doc[len], "x = 1\n", 6);
+      doc[len / 2] = '\0';
+      struct raon_document *truncated = raon_parse_document(doc, len + 6);
+      struct raon_document *parsed = raon_parse_document_parallel(doc, len + 6, 4);
+      assert(!truncated == !parsed);
+      assert(!parsed || entries_equal(parsed->entries, truncated->entries));
+      raon_document_free(truncated);
+      raon_document_free(parsed);
+
+      raon_document_free(expected);
+      free(doc);
+   }
+   printf("OK\n");
+}
+
+void test_events(void) {
+   struct event_log log = { 0 };
+   const struct raon_handler handler = {
+      .ctx = &log,
+      .on_key = log_key,
+      .on_value = log_value,
+      .on_block_begin = log_block_begin,
+      .on_block_end = log_block_end,
+      .on_array_begin = log_array_begin,
+      .on_array_end = log_array_end,
+   };
+
+   char doc[] = "x = 5\nblock = { a = [1.5, 2.5], \"b c\" = { 1 = \"d\" } }\n"
+                "list = [{ y = true }]\ndotted.key = false";
+   printf("Testing event parsing: ");
+   assert(raon_parse_events(doc, strlen(doc), &handler) == raon_parse_status_ok);
+   assert(strcmp(log.buf,
+              "k:x i:5 k:block { k:a [ f:1.5 f:2.5 ] k:b c { k:1 s:d } } "
+              "k:list [ { k:y b:1 } ] k:dotted { k:key b:0 } ")
+       == 0);
+   printf("OK\n");
+
+   printf("Testing stopping event parsing early: ");
+   log = (struct event_log) { .stop_after = 4 };
+   assert(raon_parse_events(doc, strlen(doc), &handler) == raon_parse_status_stopped);
+   assert(strcmp(log.buf, "k:x i:5 k:block { ") == 0);
+   printf("OK\n");
+
+   printf("Testing event parsing with no callbacks: ");
+   const struct raon_handler empty = { 0 };
+   assert(raon_parse_events(doc, strlen(doc), &empty) == raon_parse_status_ok);
+   printf("OK\n");
+
+   // the event parser has to accept and reject exactly what the AST parser does, apart from
+   // duplicated keys
+   char *inputs[] = { "x = [1, true]", "x = { a = 1, 2 = 3 }", "a = 1\n5 = 2", "x = { a = 1",
+      "x = [1, 2", "x = 1 y = 2", "x = $", "x.y.z = [[1], [2]]", "x = {}\ny = []", "\n\nx = 1,\n",
+      "x = 1,, y = 2" };
+   printf("Testing event parsing matches raon_parse: ");
+   for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+      struct vector_of_raon_entry *entries
+          = raon_parse(VEC_DEFAULT_ALLOCATOR, inputs[i], strlen(inputs[i]));
+      const enum raon_parse_status status = raon_parse_events(inputs[i], strlen(inputs[i]), &empty);
+      assert((entries != NULL) == (status == raon_parse_status_ok));
+      if (entries) {
+         raon_free_entries(entries);
+      }
+   }
+   printf("OK\n");
+}
+
+void test_validation(void) {
+   struct validation_test {
+      char *input;
+      enum raon_error_kind kind;
+      size_t offset;
+   } inputs[] = {
+      { "x = 5\nblock = { a = [1.5, 2.5], \"b c\" = { 1 = \"d\" } }\ndotted.key = false",
+          raon_error_kind_none, 0 },
+      { "x = [1, true]", raon_error_kind_mixed_array, 8 },
+      { "x = { a = 1, 2 = 3 }", raon_error_kind_mixed_keys, 13 },
+      { "a = 1\n5 = 2", raon_error_kind_mixed_keys, 6 },
+      { "x = { a = 1", raon_error_kind_unexpected_end, 11 },
+      { "x = [1, 2", raon_error_kind_unexpected_end, 9 },
+      { "x = 1 y = 2", raon_error_kind_unexpected_token, 6 },
+      { "x = 1,, y = 2", raon_error_kind_unexpected_token, 6 },
+      { "x.y = [{ a = 1 }, [2]]", raon_error_kind_mixed_array, 18 },
+      { "x = $", raon_error_kind_invalid_token, 4 },
+      { "x = 12ab", raon_error_kind_invalid_token, 4 },
+      { "x = 1\ny = \"never closed", raon_error_kind_invalid_token, 10 },
+      { "a.b", raon_error_kind_unexpected_end, 3 },
+      { "a.", raon_error_kind_unexpected_end, 2 },
+      { "a.b\n", raon_error_kind_unexpected_token, 3 },
+      { "a.b.c = 1\nx.", raon_error_kind_unexpected_end, 12 },
+   };
+
+   printf("Testing validation errors: ");
+   for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+      struct raon_error error;
+      const bool valid = raon_validate(inputs[i].input, strlen(inputs[i].input), &error);
+      assert(valid == (inputs[i].kind == raon_error_kind_none));
+      assert(error.kind == inputs[i].kind && error.offset == inputs[i].offset);
+
+      struct vector_of_raon_entry *entries
+          = raon_parse(VEC_DEFAULT_ALLOCATOR, inputs[i].input, strlen(inputs[i].input));
+      assert((entries != NULL) == valid);
+      if (entries) {
+         raon_free_entries(entries);
+      }
+   }
+   printf("OK\n");
+
+   printf("Testing validation without an error: ");
+   char example[4096];
+   FILE *file = fopen("./example.raon", "rb");
+   assert(file);
+   const size_t len = fread(example, 1, sizeof(example), file);
+   fclose(file);
+   assert(raon_validate(example, len, NULL));
+   // repeated keys would need every key to be kept, so only parsing rejects them, and the same goes
+   // for mixed keys across blocks that dotted keys merge
+   assert(raon_validate("a = 1\na = 2", 11, NULL));
+   char merged_keys[] = "a.b = 1\na.2 = 3";
+   assert(raon_validate(merged_keys, strlen(merged_keys), NULL));
+   assert(!raon_parse_document(merged_keys, strlen(merged_keys)));
+   printf("OK\n");
+
+   printf("Testing validation of deep nesting: ");
+   const size_t levels = 50000;
+   char *deep = malloc(4 + 2 * levels);
+   assert(deep);
+   memcpy(deep, "a = ", 4);
+   memset(deep + 4, '[', levels);
+   memset(deep + 4 + levels, ']', levels);
+   struct raon_error error;
+   assert(!raon_validate(deep, 4 + 2 * levels, &error));
+   assert(error.kind == raon_error_kind_too_deep && error.offset == 4 + RAON_EVENTS_MAX_DEPTH);
+   const struct raon_handler no_callbacks = { 0 };
+   assert(raon_parse_events(deep, 4 + 2 * levels, &no_callbacks) == raon_parse_status_error);
+
+   // right at the limit is still fine
+   memmove(deep + 4 + RAON_EVENTS_MAX_DEPTH, deep + 4 + levels, RAON_EVENTS_MAX_DEPTH);
+   assert(raon_validate(deep, 4 + 2 * RAON_EVENTS_MAX_DEPTH, NULL));
+
+   // every dot of a dotted key opens a block as well
+   deep[0] = 'a';
+   for (size_t i = 0; i < levels; i++) {
+      memcpy(deep + 1 + 2 * i, ".a", 2);
+   }
+   memcpy(deep + 1 + 2 * levels, " =", 2);
+   deep[3 + 2 * levels] = '1';
+   assert(!raon_validate(deep, 4 + 2 * levels, &error));
+   assert(error.kind == raon_error_kind_too_deep && error.offset == 1 + 2 * RAON_EVENTS_MAX_DEPTH);
+   free(deep);
+   printf("OK\n");
+}
+
+struct test_endpoint {
+   struct raon_str_slice host;
+   intptr_t port;
+};
+
+struct test_config {
+   struct raon_str_slice name;
+   intptr_t workers;
+   double ratio;
+   bool debug;
+   struct test_endpoint primary;
+   intptr_t retries[4];
+   size_t retry_count;
+   struct test_endpoint *replicas;
+   size_t replica_count;
+};
+
+static const struct raon_field test_endpoint_fields[] = {
+   {
+       .key = "host",
+       .type = raon_field_type_string,
+       .offset = offsetof(struct test_endpoint, host),
+   },
+   { .key = "port", .type = raon_field_type_int, .offset = offsetof(struct test_endpoint, port) },
+};
+
+static const struct raon_schema test_endpoint_schema = {
+   .fields = test_endpoint_fields,
+   .field_count = sizeof(test_endpoint_fields) / sizeof(test_endpoint_fields[0]),
+   .size = sizeof(struct test_endpoint),
+};
+
+static const struct raon_field test_config_fields[] = {
+   { .key = "name", .type = raon_field_type_string, .offset = offsetof(struct test_config, name) },
+   {
+       .key = "workers",
+       .type = raon_field_type_int,
+       .offset = offsetof(struct test_config, workers),
+   },
+   { .key = "ratio", .type = raon_field_type_float, .offset = offsetof(struct test_config, ratio) },
+   { .key = "debug", .type = raon_field_type_bool, .offset = offsetof(struct test_config, debug) },
+   {
+       .key = "primary",
+       .type = raon_field_type_struct,
+       .offset = offsetof(struct test_config, primary),
+       .schema = &test_endpoint_schema,
+   },
+   {
+       .key = "retries",
+       .type = raon_field_type_fixed_array,
+       .offset = offsetof(struct test_config, retries),
+       .item_type = raon_field_type_int,
+       .capacity = 4,
+       .len_offset = offsetof(struct test_config, retry_count),
+   },
+   {
+       .key = "replicas",
+       .type = raon_field_type_dynamic_array,
+       .offset = offsetof(struct test_config, replicas),
+       .schema = &test_endpoint_schema,
+       .item_type = raon_field_type_struct,
+       .len_offset = offsetof(struct test_config, replica_count),
+   },
+};
+
+static const struct raon_schema test_config_schema = {
+   .fields = test_config_fields,
+   .field_count = sizeof(test_config_fields) / sizeof(test_config_fields[0]),
+   .size = sizeof(struct test_config),
+};
+
+struct test_cluster {
+   struct test_config nodes[2];
+   size_t node_count;
+};
+
+static const struct raon_field test_cluster_fields[] = {
+   {
+       .key = "nodes",
+       .type = raon_field_type_fixed_array,
+       .offset = offsetof(struct test_cluster, nodes),
+       .schema = &test_config_schema,
+       .item_type = raon_field_type_struct,
+       .capacity = 2,
+       .len_offset = offsetof(struct test_cluster, node_count),
+   },
+};
+
+static const struct raon_schema test_cluster_schema = {
+   .fields = test_cluster_fields,
+   .field_count = 1,
+   .size = sizeof(struct test_cluster),
+};
+
+static bool slice_is(struct raon_str_slice slice, const char *str) {
+   return slice.len == strlen(str) && memcmp(slice.ptr, str, slice.len) == 0;
+}
+
+void test_schema_decoding(void) {
+   char doc[] = "name = \"svc\"\nworkers = 8, ratio = 0.5\n"
+                "unknown = { deep = [1, { x = \"}\" }] }\n"
+                "primary.host = \"a\"\nprimary.port = 80\n"
+                "retries = [1, 2, 3]\n"
+                "replicas = [{ host = \"b\", port = 1 }, { host = \"c\", extra = 6 }]\n"
+                "skipped.deeper = 5";
+   printf("Testing decoding into a struct: ");
+   struct test_config config = { .debug = true };
+   struct raon_decode_error error;
+   assert(raon_decode(
+       doc, strlen(doc), &test_config_schema, &config, VEC_DEFAULT_ALLOCATOR, &error));
+   assert(error.error.kind == raon_error_kind_none);
+   assert(slice_is(config.name, "svc") && config.workers == 8 && config.ratio == 0.5);
+   assert(config.debug);
+   assert(slice_is(config.primary.host, "a") && config.primary.port == 80);
+   assert(config.retry_count == 3 && config.retries[0] == 1 && config.retries[2] == 3);
+   assert(config.replica_count == 2 && slice_is(config.replicas[1].host, "c"));
+   assert(config.replicas[0].port == 1 && config.replicas[1].port == 0);
+   raon_schema_free(&test_config_schema, &config, VEC_DEFAULT_ALLOCATOR);
+   assert(config.replicas == NULL && config.replica_count == 0);
+   printf("OK\n");
+
+   printf("Testing decoding repeated arrays: ");
+   // the items of a fixed array that's decoded again are freed before they're overwritten
+   char repeated[] = "nodes = [{ replicas = [{ host = \"a\" }] }, { replicas = [{ port = 1 }] }]\n"
+                     "nodes = [{ replicas = [{ host = \"b\" }, { host = \"c\" }] }]";
+   size_t live = 0;
+   struct test_cluster cluster = { 0 };
+   assert(raon_decode(repeated, strlen(repeated), &test_cluster_schema, &cluster,
+       counting_allocator(&live), NULL));
+   assert(cluster.node_count == 1 && cluster.nodes[0].replica_count == 2);
+   assert(slice_is(cluster.nodes[0].replicas[1].host, "c"));
+   raon_schema_free(&test_cluster_schema, &cluster, counting_allocator(&live));
+   assert(live == 0);
+   // fixed arrays that this call didn't fill yet are left alone, whatever their count says
+   memset(&cluster, 0xAB, sizeof(cluster));
+   assert(raon_decode(repeated, strlen(repeated), &test_cluster_schema, &cluster,
+       counting_allocator(&live), NULL));
+   assert(cluster.node_count == 1 && cluster.nodes[0].replica_count == 2);
+   raon_schema_free(&test_cluster_schema, &cluster, counting_allocator(&live));
+   assert(live == 0);
+   printf("OK\n");
+
+   struct decode_test {
+      char *input;
+      enum raon_error_kind kind;
+      size_t offset;
+      const char *path;
+   } inputs[] = {
+      { "workers = \"many\"", raon_error_kind_type_mismatch, 10, "workers" },
+      { "replicas = [{ host = 1 }]", raon_error_kind_type_mismatch, 21, "replicas[0].host" },
+      { "retries = [1, 2, 3, 4, 5]", raon_error_kind_too_many_items, 23, "retries[4]" },
+      { "primary.port.x = 1", raon_error_kind_type_mismatch, 8, "primary.port" },
+      { "primary = { host = \"a\", 1 = 2 }", raon_error_kind_mixed_keys, 24, "primary" },
+      { "unknown = { a = [", raon_error_kind_unexpected_end, 10, "unknown" },
+      { "name = \"a\" workers = 1", raon_error_kind_unexpected_token, 11, "" },
+      { "replicas = [{ host = \"b\" }, { port = \"x\" }]", raon_error_kind_type_mismatch, 37,
+          "replicas[1].port" },
+   };
+   printf("Testing decoding errors: ");
+   for (size_t i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+      config = (struct test_config) { 0 };
+      assert(!raon_decode(inputs[i].input, strlen(inputs[i].input), &test_config_schema, &config,
+          VEC_DEFAULT_ALLOCATOR, &error));
+      assert(error.error.kind == inputs[i].kind && error.error.offset == inputs[i].offset);
+      assert(strcmp(error.path, inputs[i].path) == 0);
+      raon_schema_free(&test_config_schema, &config, VEC_DEFAULT_ALLOCATOR);
+   }
+   printf("OK\n");
+}
+
+void test_parse_file(void) {
+   FILE *file = fopen("./example.raon", "rb");
+   assert(file);
+   char buf[4096];
+   const size_t len = fread(buf, 1, sizeof(buf), file);
+   fclose(file);
+   struct raon_document *expected = raon_parse_document(buf, len);
+   assert(expected);
+
+   printf("Testing parsing a mapped file: ");
+   struct raon_document *doc = raon_parse_file("./example.raon");
+   assert(doc && doc->mapping && doc->mapping_len == len);
+   assert(entries_equal(expected->entries, doc->entries));
+   raon_document_free(doc);
+   printf("OK\n");
+
+   printf("Testing parsing a missing file: ");
+   assert(raon_parse_file("./does-not-exist.raon") == NULL);
+   printf("OK\n");
+
+#ifdef __linux__
+   // a pipe can't be mapped, so it goes through the chunked fallback
+   printf("Testing parsing a pipe: ");
+   int fds[2];
+   assert(pipe(fds) == 0);
+   assert(write(fds[1], buf, len) == (ssize_t)len);
+   close(fds[1]);
+   char path[64];
+   snprintf(path, sizeof(path), "/proc/self/fd/%d", fds[0]);
+   doc = raon_parse_file(path);
+   close(fds[0]);
+   assert(doc && !doc->mapping && entries_equal(expected->entries, doc->entries));
+   raon_document_free(doc);
+   printf("OK\n");
+#endif
+
+   raon_document_free(expected);
+}
+
+void test_parse_batch(void) {
+   printf("Testing batch parsing: ");
+   // sizes are uneven on purpose, a few documents are far bigger than the rest
+   enum { count = 500 };
+   static char bufs[count][512];
+   struct raon_batch_input inputs[count];
+   size_t expected_failures = 0;
+   for (size_t i = 0; i < count; i++) {
+      size_t len = 0;
+      for (size_t j = 0; j < (i % 50 == 0 ? 20 : 1); j++) {
+         len += snprintf(&bufs[i][len], sizeof(bufs[i]) - len, "k%zu = [%zu, %zu]\n", j, i, j);
+      }
+      inputs[i] = (struct raon_batch_input) { .str = bufs[i], .len = len };
+      if (i % 7 == 0) {
+         inputs[i].len += snprintf(&bufs[i][len], sizeof(bufs[i]) - len, "k0 = 1\n");
+         ++expected_failures;
+      } else if (i % 5 == 0) {
+         inputs[i] = (struct raon_batch_input) { .path = "./example.raon" };
+      } else if (i == 1) {
+         inputs[i] = (struct raon_batch_input) { .path = "./does-not-exist.raon" };
+         ++expected_failures;
+      }
+   }
+
+   for (size_t threads = 0; threads <= 4; threads++) {
+      struct raon_document *results[count];
+      const struct raon_batch_options options = { .threads = threads, .prefetch = threads % 2 };
+      assert(raon_parse_batch(inputs, count, results, options) == expected_failures);
+      for (size_t i = 0; i < count; i++) {
+         struct raon_document *expected = inputs[i].path
+             ? raon_parse_file(inputs[i].path)
+             : raon_parse_document(inputs[i].str, inputs[i].len);
+         assert(!expected == !results[i]);
+         assert(!expected || entries_equal(expected->entries, results[i]->entries));
+         raon_document_free(expected);
+         raon_document_free(results[i]);
+      }
+   }
+   assert(raon_parse_batch(inputs, 0, NULL, (struct raon_batch_options) { 0 }) == 0);
+   printf("OK\n");
+}
+
+static struct raon_document *reparse(struct raon_buffer *buffer) {
+   return raon_parse_document(buffer->data, buffer->len);
+}
+
+static bool failing_write(void *ctx, const char *data, size_t len) {
+   (void)ctx;
+   (void)data;
+   (void)len;
+   return false;
+}
+
+void test_writer(void) {
+   char doc[] = "plain = 1\n"
+                "\"needs quotes\" = \"multi\nline\"\n"
+                "\"true\" = true\n"
+                "\"5x\" = false\n"
+                "floats = [0.1, -0.0, 1e300, 5e-324, 2.0, 123456789.125]\n"
+                "ints = { -9223372036854775808 = 9223372036854775807, 0 = -1 }\n"
+                "nested = { a.b = [[1], []], c = {}, d = [{ e = \"f\" }] }\n";
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   assert(expected);
+
+   const struct raon_write_options modes[] = { { .compact = false }, { .compact = true },
+      { .indent = "\t" } };
+   printf("Testing writer round trips: ");
+   for (size_t i = 0; i < sizeof(modes) / sizeof(modes[0]); i++) {
+      struct raon_buffer buffer = { 0 };
+      assert(raon_write(expected->entries, raon_sink_buffer(&buffer), modes[i]));
+      struct raon_document *written = reparse(&buffer);
+      assert(written && entries_equal(expected->entries, written->entries));
+      raon_document_free(written);
+      free(buffer.data);
+   }
+   printf("OK\n");
+
+   printf("Testing writer formatting: ");
+   char small[] = "a = { b = [1, 2], \"c d\" = 1.5 }\n";
+   struct raon_document *small_doc = raon_parse_document(small, strlen(small));
+   struct raon_buffer buffer = { 0 };
+   assert(raon_write(
+       small_doc->entries, raon_sink_buffer(&buffer), (struct raon_write_options) { 0 }));
+   assert(buffer.len == strlen("a = {\n   b = [1, 2]\n   \"c d\" = 1.5\n}\n"));
+   assert(memcmp(buffer.data, "a = {\n   b = [1, 2]\n   \"c d\" = 1.5\n}\n", buffer.len) == 0);
+   buffer.len = 0;
+   assert(raon_write(small_doc->entries, raon_sink_buffer(&buffer),
+       (struct raon_write_options) { .compact = true }));
+   assert(buffer.len == strlen("a={b=[1,2],\"c d\"=1.5}\n"));
+   assert(memcmp(buffer.data, "a={b=[1,2],\"c d\"=1.5}\n", buffer.len) == 0);
+   free(buffer.data);
+   raon_document_free(small_doc);
+
+   char based[] = "a = [0x1f, 0o17, 0b101, 10, -7]\n";
+   struct raon_document *based_doc = raon_parse_document(based, strlen(based));
+   buffer = (struct raon_buffer) { 0 };
+   assert(raon_write(based_doc->entries, raon_sink_buffer(&buffer),
+       (struct raon_write_options) { .keep_int_base = true }));
+   assert(buffer.len == strlen("a = [0x1f, 0o17, 0b101, 10, -7]\n"));
+   assert(memcmp(buffer.data, "a = [0x1f, 0o17, 0b101, 10, -7]\n", buffer.len) == 0);
+   free(buffer.data);
+   raon_document_free(based_doc);
+   printf("OK\n");
+
+   printf("Testing writer file and fd sinks: ");
+   FILE *file = tmpfile();
+   assert(file);
+   assert(raon_write(expected->entries, raon_sink_file(file), (struct raon_write_options) { 0 }));
+   assert(raon_write(
+       expected->entries, raon_sink_fd(fileno(file)), (struct raon_write_options) { 0 }));
+   fclose(file);
+   printf("OK\n");
+
+   printf("Testing writer failures: ");
+   assert(!raon_write(expected->entries, (struct raon_sink) { .write = failing_write },
+       (struct raon_write_options) { 0 }));
+   struct raon_entry unwritable[] = {
+      { .key_type = raon_key_type_string, .str_key = { "k", 1 },
+          .value = { .type = raon_value_type_string, .str_val = { "a \" quote", 9 } } },
+      { .key_type = raon_key_type_string, .str_key = { "k", 1 },
+          .value = { .type = raon_value_type_float, .float_val = NAN } },
+   };
+   for (size_t i = 0; i < sizeof(unwritable) / sizeof(unwritable[0]); i++) {
+      struct vector_of_raon_entry *entries = vec_new_raon_entry(VEC_DEFAULT_ALLOCATOR);
+      vec_push_raon_entry(entries, unwritable[i]);
+      buffer = (struct raon_buffer) { 0 };
+      assert(!raon_write(entries, raon_sink_buffer(&buffer), (struct raon_write_options) { 0 }));
+      free(buffer.data);
+      vec_free_raon_entry(entries);
+   }
+   printf("OK\n");
+
+   raon_document_free(expected);
+}
+
+void test_binary_encoding(void) {
+   char doc[] = "name = \"raon\"\n"
+                "ints = { -9223372036854775808 = 9223372036854775807, 0 = -1, 64 = 0x7f }\n"
+                "floats = [0.1, -0.0, 1e300, 5e-324]\n"
+                "flags = [true, false, true]\n"
+                "nested = { a.b = [[1], []], c = {}, d = [{ e = \"f\" }] }\n";
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   assert(expected);
+
+   printf("Testing binary round trips: ");
+   struct raon_buffer binary = { 0 };
+   assert(raon_encode_binary(expected->entries, raon_sink_buffer(&binary)));
+   struct raon_document *decoded = raon_decode_binary(binary.data, binary.len);
+   assert(decoded && entries_equal(expected->entries, decoded->entries));
+   assert(raon_block_get_int(raon_block_get(decoded->entries, "ints", 4)->block_val, 64)->int_val
+       == 0x7f);
+
+   // and back to text again
+   struct raon_buffer text = { 0 };
+   assert(raon_write(decoded->entries, raon_sink_buffer(&text), (struct raon_write_options) { 0 }));
+   struct raon_document *reparsed = reparse(&text);
+   assert(reparsed && entries_equal(expected->entries, reparsed->entries));
+   raon_document_free(reparsed);
+   raon_document_free(decoded);
+   free(text.data);
+   printf("OK\n");
+
+   printf("Testing malformed binary: ");
+   for (size_t len = 0; len < binary.len; len++) {
+      assert(raon_decode_binary(binary.data, len) == NULL);
+   }
+   // corrupted bytes must be rejected or decoded without reading out of bounds
+   for (size_t i = 0; i < binary.len; i++) {
+      binary.data[i] ^= 0xFF;
+      raon_document_free(raon_decode_binary(binary.data, binary.len));
+      binary.data[i] ^= 0xFF;
+   }
+   free(binary.data);
+
+   // data that the encoder couldn't have produced is rejected, since it can come from anywhere
+   char repeated[] = "RAON\x01\x02\x01\x01" "a\x02\x02\x01" "a\x02\x04";
+   assert(raon_decode_binary(repeated, sizeof(repeated) - 1) == NULL);
+   char big_block[128] = "RAON\x01\x14\x02";
+   size_t big_len = 7;
+   for (int i = 0; i < 20; i++) {
+      // the last key repeats the first one, which is only found through the block's index
+      big_block[big_len++] = (char)(i < 19 ? 2 * i : 0);
+      big_block[big_len++] = 2;
+      big_block[big_len++] = 0;
+   }
+   assert(raon_decode_binary(big_block, big_len) == NULL);
+   big_block[big_len - 3] = 2 * 19;
+   struct raon_document *unique = raon_decode_binary(big_block, big_len);
+   assert(unique && raon_block_get_int(unique->entries, 19) != NULL);
+   raon_document_free(unique);
+
+   // `a = [[...[]...]]` nested as deep as it's allowed to go, and one level deeper
+   char *deep = malloc(2 * RAON_BINARY_MAX_DEPTH + 16);
+   assert(deep);
+   for (size_t depth = RAON_BINARY_MAX_DEPTH; depth <= RAON_BINARY_MAX_DEPTH + 1; depth++) {
+      memcpy(deep, "RAON\x01\x01\x01\x01" "a\x06", 10);
+      size_t deep_len = 10;
+      for (size_t i = 1; i < depth; i++) {
+         deep[deep_len++] = 1;
+         deep[deep_len++] = 6;
+      }
+      deep[deep_len++] = 0;
+      struct raon_document *nested = raon_decode_binary(deep, deep_len);
+      assert((nested != NULL) == (depth == RAON_BINARY_MAX_DEPTH));
+      raon_document_free(nested);
+   }
+   free(deep);
+
+   struct raon_value mixed[] = { { .type = raon_value_type_int, .int_val = 1 },
+      { .type = raon_value_type_bool, .bool_val = true } };
+   struct vector_of_raon_value *array = vec_from_raon_value(
+       VEC_DEFAULT_ALLOCATOR, mixed, sizeof(mixed) / sizeof(mixed[0]), sizeof(mixed[0]));
+   struct vector_of_raon_entry *entries = vec_new_raon_entry(VEC_DEFAULT_ALLOCATOR);
+   vec_push_raon_entry(entries, (struct raon_entry) { .key_type = raon_key_type_string,
+       .str_key = { "k", 1 }, .value = { .type = raon_value_type_array, .array_val = array } });
+   binary = (struct raon_buffer) { 0 };
+   assert(!raon_encode_binary(entries, raon_sink_buffer(&binary)));
+   free(binary.data);
+   raon_free_entries(entries);
+   printf("OK\n");
+
+   raon_document_free(expected);
+}
+
+static bool frozen_matches(struct raon_frozen_value frozen, struct raon_value value);
+
+static bool frozen_block_matches(
+    struct raon_frozen_value frozen, struct vector_of_raon_entry *entries) {
+   if (raon_frozen_len(frozen) != entries->len) {
+      return false;
+   }
+   for (size_t i = 0; i < entries->len; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      const struct raon_key key = raon_frozen_key_at(frozen, i);
+      if (key.type != entry->key_type
+          || (key.type == raon_key_type_string ? !slices_equal(key.str_key, entry->str_key)
+                                               : key.int_key != entry->int_key)
+          || !frozen_matches(raon_frozen_at(frozen, i), entry->value)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool frozen_matches(struct raon_frozen_value frozen, struct raon_value value) {
+   if (raon_frozen_type(frozen) != value.type) {
+      return false;
+   }
+   switch (value.type) {
+   case raon_value_type_string:
+      return slices_equal(raon_frozen_string(frozen), value.str_val);
+   case raon_value_type_int:
+      return raon_frozen_int(frozen) == value.int_val
+          && raon_frozen_int_base(frozen) == value.int_base;
+   case raon_value_type_bool:
+      return raon_frozen_bool(frozen) == value.bool_val;
+   case raon_value_type_float:
+      return raon_frozen_float(frozen) == value.float_val;
+   case raon_value_type_block:
+      return frozen_block_matches(frozen, value.block_val);
+   case raon_value_type_array:
+      if (raon_frozen_len(frozen) != raon_array_len(value.array_val)) {
+         return false;
+      }
+      for (size_t i = 0; i < raon_array_len(value.array_val); i++) {
+         if (!frozen_matches(raon_frozen_at(frozen, i), raon_array_get(value.array_val, i))) {
+            return false;
+         }
+      }
+      return true;
+   default:
+      return false;
+   }
+}
+
+void test_frozen_snapshots(void) {
+   char doc[] = "name = \"raon\"\n"
+                "ints = { 30 = 0x1f, -5 = -1, 7 = 7 }\n"
+                "floats = [0.1, -0.0, 1e300, 5e-324]\n"
+                "flags = [true, false]\n"
+                "nested = { a.b = [[1], []], c = {}, d = [{ e = \"f\" }] }\n"
+                "empty = \"\"\n";
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   assert(expected);
+
+   printf("Testing frozen snapshot contents: ");
+   struct raon_buffer buffer = { 0 };
+   assert(raon_freeze(expected->entries, raon_sink_buffer(&buffer)));
+   struct raon_frozen snapshot;
+   assert(raon_frozen_init(&snapshot, buffer.data, buffer.len));
+   const struct raon_frozen_value root = raon_frozen_root(&snapshot);
+   assert(frozen_block_matches(root, expected->entries));
+   printf("OK\n");
+
+   printf("Testing frozen snapshot lookups: ");
+   struct raon_str_slice name = raon_frozen_string(raon_frozen_get(root, "name", 4));
+   assert(slices_equal(name, (struct raon_str_slice) { "raon", 4 }) && name.ptr[name.len] == '\0');
+   const struct raon_frozen_value ints = raon_frozen_get(root, "ints", 4);
+   assert(raon_frozen_int(raon_frozen_get_int(ints, 30)) == 0x1f);
+   assert(raon_frozen_int(raon_frozen_get_int(ints, -5)) == -1);
+   assert(raon_frozen_get_int(ints, 8).cell == NULL);
+   assert(raon_frozen_get(ints, "30", 2).cell == NULL);
+   assert(raon_frozen_get(root, "nam", 3).cell == NULL);
+   assert(raon_frozen_get(root, "names", 5).cell == NULL);
+   assert(raon_frozen_type(raon_frozen_get(root, "missing", 7)) == raon_value_type_error);
+   const struct raon_frozen_value e = raon_frozen_get(
+       raon_frozen_at(raon_frozen_get(raon_frozen_get(root, "nested", 6), "d", 1), 0), "e", 1);
+   assert(slices_equal(raon_frozen_string(e), (struct raon_str_slice) { "f", 1 }));
+   assert(raon_frozen_string(raon_frozen_get(root, "empty", 5)).len == 0);
+   printf("OK\n");
+
+   printf("Testing frozen snapshot files: ");
+   const char *path = "./raon_test_frozen.tmp";
+   FILE *file = fopen(path, "wb");
+   assert(file && fwrite(buffer.data, 1, buffer.len, file) == buffer.len);
+   fclose(file);
+   struct raon_frozen mapped;
+   assert(raon_frozen_open(&mapped, path));
+   assert(frozen_block_matches(raon_frozen_root(&mapped), expected->entries));
+   raon_frozen_close(&mapped);
+   remove(path);
+   assert(!raon_frozen_open(&mapped, path));
+   printf("OK\n");
+
+   printf("Testing corrupted frozen snapshots: ");
+   assert(!raon_frozen_init(&snapshot, buffer.data, buffer.len - 1));
+   assert(!raon_frozen_init(&snapshot, buffer.data, 8));
+   // whatever the corruption, walking the snapshot must stay inside of it
+   for (size_t i = 0; i < buffer.len; i++) {
+      buffer.data[i] ^= 0xA5;
+      if (raon_frozen_init(&snapshot, buffer.data, buffer.len)) {
+         frozen_block_matches(raon_frozen_root(&snapshot), expected->entries);
+         raon_frozen_get(raon_frozen_root(&snapshot), "nested", 6);
+      }
+      buffer.data[i] ^= 0xA5;
+   }
+   printf("OK\n");
+
+   free(buffer.data);
+   raon_document_free(expected);
+}
+
+static bool compact_matches(struct raon_compact_value compact, struct raon_value value);
+
+static bool compact_block_matches(
+    struct raon_compact_value compact, struct vector_of_raon_entry *entries) {
+   if (raon_compact_len(compact) != entries->len) {
+      return false;
+   }
+   for (size_t i = 0; i < entries->len; i++) {
+      const struct raon_entry *entry = &entries->vec[i];
+      const struct raon_key key = raon_compact_key_at(compact, i);
+      if (key.type != entry->key_type
+          || (key.type == raon_key_type_string ? !slices_equal(key.str_key, entry->str_key)
+                                               : key.int_key != entry->int_key)
+          || !compact_matches(raon_compact_at(compact, i), entry->value)) {
+         return false;
+      }
+   }
+   return true;
+}
+
+static bool compact_matches(struct raon_compact_value compact, struct raon_value value) {
+   if (raon_compact_type(compact) != value.type) {
+      return false;
+   }
+   switch (value.type) {
+   case raon_value_type_string:
+      return slices_equal(raon_compact_string(compact), value.str_val);
+   case raon_value_type_int:
+      return raon_compact_int(compact) == value.int_val
+          && raon_compact_int_base(compact) == value.int_base;
+   case raon_value_type_bool:
+      return raon_compact_bool(compact) == value.bool_val;
+   case raon_value_type_float:
+      return raon_compact_float(compact) == value.float_val;
+   case raon_value_type_block:
+      return compact_block_matches(compact, value.block_val);
+   case raon_value_type_array:
+      if (raon_compact_len(compact) != raon_array_len(value.array_val)) {
+         return false;
+      }
+      for (size_t i = 0; i < raon_array_len(value.array_val); i++) {
+         if (!compact_matches(raon_compact_at(compact, i), raon_array_get(value.array_val, i))) {
+            return false;
+         }
+      }
+      return true;
+   default:
+      return false;
+   }
+}
+
+void test_compact_documents(void) {
+   char doc[4096] = "name = \"raon\"\n"
+                    "ints = { 30 = 0x1f, -5 = -1, 7 = 7, 9223372036854775807 = 1 }\n"
+                    "floats = [0.1, -0.0, 1e300, 5e-324]\n"
+                    "flags = [true, false, true, true, true, true, true, true, true, false, true]\n"
+                    "based = [1, 0x2, 0b11]\n"
+                    "nested = { a.b = [[1], []], c = {}, d = [{ e = \"f\" }] }\n"
+                    "nested.a.g = \"merged\"\n"
+                    "empty = \"\"\n";
+   // enough keys for the top level and `big` to be looked up through their tables
+   strcat(doc, "big = { ");
+   for (int i = 0; i < 40; i++) {
+      snprintf(doc + strlen(doc), sizeof(doc) - strlen(doc), "k%d = %d, ", i, i);
+   }
+   strcat(doc, "}\n");
+   for (int i = 0; i < 20; i++) {
+      snprintf(doc + strlen(doc), sizeof(doc) - strlen(doc), "top%d = %d\n", i, i);
+   }
+   struct raon_document *expected = raon_parse_document(doc, strlen(doc));
+   assert(expected);
+
+   printf("Testing compact document contents: ");
+   struct raon_compact *compact = raon_compact_parse(doc, strlen(doc));
+   assert(compact);
+   const struct raon_compact_value root = raon_compact_root(compact);
+   assert(compact_block_matches(root, expected->entries));
+   printf("OK\n");
+
+   printf("Testing compact document lookups: ");
+   const struct raon_str_slice name = raon_compact_string(raon_compact_get(root, "name", 4));
+   assert(slices_equal(name, (struct raon_str_slice) { "raon", 4 }) && name.ptr == &doc[8]);
+   const struct raon_compact_value ints = raon_compact_get(root, "ints", 4);
+   assert(raon_compact_int(raon_compact_get_int(ints, -5)) == -1);
+   assert(raon_compact_int(raon_compact_get_int(ints, INTPTR_MAX)) == 1);
+   assert(raon_compact_type(raon_compact_get_int(ints, 8)) == raon_value_type_error);
+   assert(raon_compact_type(raon_compact_get(ints, "30", 2)) == raon_value_type_error);
+   assert(raon_compact_type(raon_compact_get(root, "nam", 3)) == raon_value_type_error);
+   const struct raon_compact_value big = raon_compact_get(root, "big", 3);
+   for (int i = 0; i < 40; i++) {
+      char key[8];
+      const int len = snprintf(key, sizeof(key), "k%d", i);
+      assert(raon_compact_int(raon_compact_get(big, key, len)) == i);
+   }
+   assert(raon_compact_type(raon_compact_get(big, "k40", 3)) == raon_value_type_error);
+   assert(raon_compact_int(raon_compact_get(root, "top19", 5)) == 19);
+   const struct raon_compact_value nested = raon_compact_get(root, "nested", 6);
+   const struct raon_str_slice merged
+       = raon_compact_string(raon_compact_get(raon_compact_get(nested, "a", 1), "g", 1));
+   assert(slices_equal(merged, (struct raon_str_slice) { "merged", 6 }));
+   assert(raon_compact_type(raon_compact_at(raon_compact_get(root, "flags", 5), 11))
+       == raon_value_type_error);
+   assert(raon_compact_string(raon_compact_get(root, "empty", 5)).len == 0);
+   printf("OK\n");
+
+   printf("Testing compact document failures: ");
+   char broken[] = "a = [1, \"b\"]\n";
+   assert(!raon_compact_parse(broken, strlen(broken)));
+   printf("OK\n");
+
+   raon_compact_free(compact);
+   raon_document_free(expected);
+}
+
+void test_block_lookup(void) {
+   // big enough to be indexed at parse time
+   char buf[4096] = "small = { a = 1, b = 2 }\nnums = { ";
+   for (int i = 0; i < 40; i++) {
+      snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "%d = %d, ", i * 3, i);
+   }
+   strcat(buf, "}\n");
+   for (int i = 0; i < 40; i++) {
+      snprintf(buf + strlen(buf), sizeof(buf) - strlen(buf), "key_%d = %d\n", i, i);
+   }
+
+   struct raon_document *doc = raon_parse_document(buf, strlen(buf));
+   assert(doc);
+
+   printf("Testing indexed string key lookup: ");
+   assert(doc->entries->index != NULL);
+   for (int i = 0; i < 40; i++) {
+      char key[16];
+      int key_len = snprintf(key, sizeof(key), "key_%d", i);
+      struct raon_value *value = raon_block_get(doc->entries, key, key_len);
+      assert(value && value->type == raon_value_type_int && value->int_val == i);
+   }
+   assert(raon_block_get(doc->entries, "key_40", 6) == NULL);
+   assert(raon_block_get(doc->entries, "key_1", 4) == NULL);
+   printf("OK\n");
+
+   printf("Testing indexed int key lookup: ");
+   struct raon_value *nums = raon_block_get(doc->entries, "nums", 4);
+   assert(nums && nums->type == raon_value_type_block && nums->block_val->index != NULL);
+   for (int i = 0; i < 40; i++) {
+      struct raon_value *value = raon_block_get_int(nums->block_val, i * 3);
+      assert(value && value->int_val == i);
+   }
+   assert(raon_block_get_int(nums->block_val, 1) == NULL);
+   assert(raon_block_get(nums->block_val, "0", 1) == NULL);
+   printf("OK\n");
+
+   printf("Testing small block lookup: ");
+   struct raon_value *small = raon_block_get(doc->entries, "small", 5);
+   assert(small && small->block_val->index == NULL);
+   assert(raon_block_get(small->block_val, "b", 1)->int_val == 2);
+   assert(raon_block_get(small->block_val, "c", 1) == NULL);
+   printf("OK\n");
+
+   printf("Testing lookups in blocks with mixed keys: ");
+   // blocks built by hand can mix key types, they're scanned instead of indexed
+   struct vector_of_raon_entry *mixed = vec_new_raon_entry(VEC_DEFAULT_ALLOCATOR);
+   static char names[RAON_BLOCK_INDEX_THRESHOLD][4];
+   for (int i = 0; i < RAON_BLOCK_INDEX_THRESHOLD; i++) {
+      snprintf(names[i], sizeof(names[i]), "k%d", i);
+      vec_push_raon_entry(mixed, (struct raon_entry) { .key_type = raon_key_type_string,
+          .str_key = { names[i], strlen(names[i]) },
+          .value = { .type = raon_value_type_int, .int_val = i } });
+   }
+   assert(raon_block_build_index(mixed) && mixed->index != NULL);
+   vec_push_raon_entry(mixed, (struct raon_entry) { .key_type = raon_key_type_num, .int_key = 7,
+       .value = { .type = raon_value_type_int, .int_val = -7 } });
+   assert(!raon_block_build_index(mixed) && mixed->index == NULL);
+   assert(raon_block_get(mixed, "k7", 2)->int_val == 7);
+   assert(raon_block_get_int(mixed, 7)->int_val == -7);
+   assert(raon_block_get_int(mixed, 0) == NULL && raon_block_get(mixed, "k99", 3) == NULL);
+   raon_free_entries(mixed);
+   printf("OK\n");
+
+   raon_document_free(doc);
+}
+
+static bool tokens_equal(struct raon_token a, struct raon_token b) {
+   if (a.type != b.type || a.start != b.start || a.end != b.end) {
+      return false;
+   }
+   if (a.type == raon_token_type_string || a.type == raon_token_type_key) {
+      return a.str_val.ptr == b.str_val.ptr && a.str_val.len == b.str_val.len;
+   }
+   return memcmp(&a.float_val, &b.float_val, sizeof(a.float_val)) == 0;
+}
+
+void test_simd_scanning(void) {
+   // long strings, comments and runs of blanks that cross 16 and 32 byte boundaries
+   char doc[8192] = "";
+   const char *pieces[] = {
+      "key = \"short\"\n",
+      "# a comment that is long enough to span more than one vector register worth of bytes\n",
+      "       \t\t   \r  \v\f   value = 5\n",
+      "multi = \"line one\nline two is a bit longer than a register\n\nline four\"\n",
+      "x = \"0123456789abcdef0123456789abcdef0123456789abcdef\" # tail\n",
+      "a = [1,    2,                                   3]\n",
+   };
+   for (size_t i = 0; strlen(doc) < sizeof(doc) - 256; i++) {
+      strcat(doc, pieces[(i * 7 + i / 3) % (sizeof(pieces) / sizeof(pieces[0]))]);
+   }
+   strcat(doc, "unterminated = \"no closing quote\n at all");
+
+   const enum raon_scan_level levels[] = { raon_scan_level_sse2, raon_scan_level_avx2 };
+   for (size_t level = 0; level < sizeof(levels) / sizeof(levels[0]); level++) {
+      printf("Testing scan level %d primitives: ", levels[level]);
+      for (size_t start = 0; start < 40; start++) {
+         for (size_t len = 0; start + len < 200; len += 3) {
+            const char *str = &doc[start];
+            raon_scan_force_level(raon_scan_level_scalar);
+            size_t expected_last = 0, last = 0;
+            size_t expected_lines = raon_scan_count_newlines(str, len, &expected_last);
+            size_t expected_find = raon_scan_find2(str, len, '"', '#');
+            size_t expected_blank = raon_scan_skip_blank(str, len);
+            raon_scan_force_level(levels[level]);
+            assert(raon_scan_count_newlines(str, len, &last) == expected_lines);
+            assert(last == expected_last);
+            assert(raon_scan_find2(str, len, '"', '#') == expected_find);
+            assert(raon_scan_skip_blank(str, len) == expected_blank);
+         }
+      }
+      printf("OK\n");
+
+      printf("Testing scan level %d matches scalar: ", levels[level]);
+      struct raon_lexer scalar = raon_lexer_init(doc, strlen(doc));
+      struct raon_lexer simd = scalar;
+      for (;;) {
+         raon_scan_force_level(raon_scan_level_scalar);
+         struct raon_token expected = raon_lexer_eat(&scalar);
+         raon_scan_force_level(levels[level]);
+         struct raon_token token = raon_lexer_eat(&simd);
+         assert(tokens_equal(expected, token));
+         assert(scalar.idx == simd.idx);
+         const struct raon_position position = raon_lexer_position(&simd, token.start);
+         raon_scan_force_level(raon_scan_level_scalar);
+         const struct raon_position expected_position = raon_lexer_position(&scalar, token.start);
+         assert(position.line == expected_position.line && position.col == expected_position.col);
+         if (token.type == raon_token_type_eof) {
+            break;
+         }
+      }
+      printf("OK\n");
+   }
+   raon_scan_force_level(raon_scan_level_auto);
+}
+
 int main(void) {
    test_num_values();
+   test_num_conversion();
+   test_num_formatting();
    test_string_values();
    test_ident_values();
+   test_token_dispatch();
+   test_token_positions();
+   test_unterminated_buffers();
+   test_simd_scanning();
    test_entries();
    test_blocks();
    test_arrays();
+   test_vectors();
+   test_arena();
+   test_documents();
+   test_packed_arrays();
+   test_incremental_parser();
+   test_block_merging();
+   test_duplicate_keys();
+   test_parallel_parsing();
+   test_lazy_parsing();
+   test_events();
+   test_validation();
+   test_schema_decoding();
+   test_parse_file();
+   test_parse_batch();
+   test_writer();
+   test_binary_encoding();
+   test_frozen_snapshots();
+   test_compact_documents();
+   test_block_lookup();
 
-   char *buf = malloc(BUF_SIZE);
-   if (!buf) {
-      perror("Failed to preallocate buffer");
-      goto cleanup;
-   }
-   memset(buf, 0, BUF_SIZE);
-
-   FILE *fd = fopen("./example.raon", "r");
-   if (!fd) {
-      perror("Failed to open file.");
-      goto cleanup;
-   }
-
-   fread(buf, 1, BUF_SIZE - 1, fd);
-   if (ferror(fd)) {
-      perror("Failed to read file.");
-      fclose(fd);
-      goto cleanup;
-   }
-
-   struct vector_of_raon_entry *entries = raon_parse(VEC_DEFAULT_ALLOCATOR, buf, strlen(buf));
+   struct raon_document *doc = raon_parse_file("./example.raon");
    printf("\n\n");
-   printf("Ret: %p\n\n", (void *)entries);
+   printf("Ret: %p\n\n", (void *)doc);
+   assert(doc);
 
    struct raon_print_ctx ctx = { 0 };
-   raon_print_entries(ctx, entries);
+   raon_print_entries(ctx, doc->entries);
    puts("\nAll tests passed.");
 
-cleanup:
-   raon_free_entries(entries);
-   fclose(fd);
-   free(buf);
+   raon_document_free(doc);
    return 0;
 }
@@ -1,25 +1,78 @@
-#include "src/raon.h"
-#include <fstream>
+#include "src/raon.hpp"
+#include <cassert>
 #include <iostream>
-#include <sstream>
+#include <iterator>
+#include <string>
 
-int main(void) {
-  std::ifstream file{"./example.raon"};
-  if (!file.is_open()) {
-    std::cerr << "Failed to open raon file\n";
-    return 1;
+// views are handles into the document, they never carry a copy of what they point at
+static_assert(sizeof(raon::value) == sizeof(void *));
+static_assert(sizeof(raon::block) == sizeof(void *));
+static_assert(sizeof(raon::entry) == sizeof(void *));
+static_assert(sizeof(raon::array) == sizeof(void *));
+static_assert(sizeof(raon::item) == sizeof(void *) + sizeof(std::size_t));
+static_assert(std::forward_iterator<raon::block::iterator>);
+static_assert(std::forward_iterator<raon::array::iterator>);
+
+static void test_document_views() {
+  std::string text = "name = \"raon\"\nversion = 0x2A\nratio = 0.5\n"
+                     "ports = [80, 0x1BB]\nflags = [true, false, true]\n"
+                     "servers = [{ host = \"a\" }, { host = \"b\" }]\nids = { 1 = \"one\" }";
+  std::optional<raon::document> parsed = raon::document::parse(text);
+  assert(parsed);
+  // the document holds its own copy of the text
+  text.assign(text.size(), '?');
+  raon::document doc = std::move(*parsed);
+
+  assert(doc["name"].as_string() == "raon");
+  assert(doc["version"].as_int() == 42 && doc["version"].int_base() == 16);
+  assert(doc["ratio"].as_float() == 0.5);
+  assert(doc["servers"][1]["host"].as_string() == "b");
+  assert(doc["ids"].as_block().get(1).as_string() == "one");
+
+  // failed lookups give back values of the error type instead of throwing
+  assert(!doc["missing"] && !doc["servers"][5] && !doc["name"]["nested"]);
+  assert(doc["name"].as_array().empty());
+
+  size_t count = 0;
+  for (raon::entry entry : doc) {
+    assert(!entry.key().empty() && entry.value());
+    ++count;
   }
+  assert(count == 7);
 
-  std::stringstream strbuf;
-  strbuf << file.rdbuf();
+  std::string hosts;
+  for (raon::item server : doc["servers"].as_array()) {
+    hosts += server["host"].as_string();
+  }
+  assert(hosts == "ab");
 
-  std::string contents = strbuf.str();
+  std::optional<std::span<const intptr_t>> ports = doc["ports"].as_array().ints();
+  assert(ports && ports->size() == 2 && (*ports)[1] == 443);
+  assert(!doc["ports"].as_array().floats());
+  // packed items are read out of the array, they aren't stored as values
+  intptr_t sum = 0;
+  for (raon::item port : doc["ports"].as_array()) {
+    assert(port.type() == raon_value_type_int);
+    sum += port.as_int();
+  }
+  assert(sum == 523 && doc["ports"][0].int_base() == 0 && doc["ports"][1].int_base() == 16);
+  assert(!doc["ports"][1].value() && !doc["ports"][2] && doc["ports"][2].as_int() == 0);
+  assert(doc["flags"][2].as_bool() && !doc["flags"][1].as_bool());
 
-  auto ast = raon_parse(VEC_DEFAULT_ALLOCATOR, contents.data(), contents.size());
-  if (!ast) {
+  std::optional<std::span<const uint8_t>> flags = doc["flags"].as_array().bool_bits();
+  assert(flags && flags->size() == 1 && (*flags)[0] == 0b101);
+}
+
+int main(void) {
+  // the file is mapped and parsed in place, there's no need to read it into a string first
+  std::optional<raon::document> doc = raon::document::parse_file("./example.raon");
+  if (!doc) {
     std::cerr << "Failed to parse raon file\n";
     return 1;
   }
+  assert(!doc->root().empty());
+  assert(!raon::document::parse("x = [1, true]"));
 
+  test_document_views();
   std::cout << "C++ test ran sucessfully.\n";
 }